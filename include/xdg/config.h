@@ -2,6 +2,7 @@
 #ifndef XDG_CONFIG_H
 #define XDG_CONFIG_H
 
+#include <array>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -24,6 +25,14 @@ extern const libMesh::Parallel::Communicator* external_libmesh_comm;
 #endif
 
 } // namespace config
+
+//! Settings used to build the acceleration structures of one class of tree
+struct TreeBuildSettings {
+  BuildQuality quality {BuildQuality::HIGH}; //!< Quality of the tree
+  bool robust {true}; //!< Use robust traversal, avoiding missed hits at primitive edges
+  bool compact {false}; //!< Use a compact tree layout, trading query speed for memory
+};
+
 class XDGConfig {
 public:
   // Get the singleton instance
@@ -39,6 +48,7 @@ public:
   void reset() {
     initialized_ = false;
     n_threads_ = -1;
+    tree_build_settings_ = {};
     reset_libmesh_init();
   }
 
@@ -58,6 +68,16 @@ public:
 
   void set_n_threads(int n_threads);
 
+  //! \brief Settings used to build trees of the given class. Ray tracers
+  //! read these settings when they are created.
+  const TreeBuildSettings& tree_build_settings(TreeClass tree_class) const {
+    return tree_build_settings_.at(static_cast<size_t>(tree_class));
+  }
+
+  void set_tree_build_settings(TreeClass tree_class, const TreeBuildSettings& settings) {
+    tree_build_settings_.at(static_cast<size_t>(tree_class)) = settings;
+  }
+
   bool ray_tracer_enabled(RTLibrary rt_lib) const;
 
   bool mesh_manager_enabled(MeshLibrary mesh_lib) const;
@@ -104,6 +124,7 @@ private:
   // Data members
   int n_threads_ {-1};
   bool initialized_ {false};
+  std::array<TreeBuildSettings, 3> tree_build_settings_; //!< Build settings for each TreeClass
 };
 
 } // namespace xdg
@@ -29,6 +29,10 @@ constexpr double DILATION_FACTOR {std::pow(10, -std::numeric_limits<float>::digi
 // TODO : Consider this as an option for managing missed hits?
 constexpr double PLUCKER_ZERO_TOL {20 * std::numeric_limits<double>::epsilon()};
 
+// Relative tolerance on the Plucker coordinates of single precision hit
+// candidates that the double precision test rejects near a triangle edge
+constexpr double PLUCKER_EDGE_TOL {4 * std::numeric_limits<float>::epsilon()};
+
 constexpr double TINY_BIT {1e-10};
 
 // Whether information pertains to a surface or volume
@@ -57,6 +61,21 @@ enum class RTLibrary {
   GPRT
 };
 
+// Quality of the acceleration structures built by a ray tracer. Lower
+// quality trees build faster at the cost of slower queries.
+enum class BuildQuality {
+  LOW,
+  MEDIUM,
+  HIGH
+};
+
+// Classes of acceleration structures, each of which may be built with its own settings
+enum class TreeClass {
+  VOLUME_SURFACE, // surfaces of a single volume
+  GLOBAL_SURFACE, // surfaces of all volumes
+  ELEMENT // volumetric elements, both per volume and global
+};
+
 static const std::map<MeshLibrary, std::string> MESH_LIB_TO_STR =
 {
   {MeshLibrary::MOCK, "MOCK"},
@@ -70,6 +89,20 @@ static const std::map<RTLibrary, std::string> RT_LIB_TO_STR =
   {RTLibrary::GPRT, "GPRT"}
 };
 
+static const std::map<BuildQuality, std::string> BUILD_QUALITY_TO_STR =
+{
+  {BuildQuality::LOW, "LOW"},
+  {BuildQuality::MEDIUM, "MEDIUM"},
+  {BuildQuality::HIGH, "HIGH"}
+};
+
+static const std::map<TreeClass, std::string> TREE_CLASS_TO_STR =
+{
+  {TreeClass::VOLUME_SURFACE, "VOLUME_SURFACE"},
+  {TreeClass::GLOBAL_SURFACE, "GLOBAL_SURFACE"},
+  {TreeClass::ELEMENT, "ELEMENT"}
+};
+
 // Mesh identifer type
 using MeshID = int32_t;
 
@@ -143,6 +176,20 @@ struct formatter<xdg::MeshLibrary> : fmt::formatter<std::string> {
   }
 };
 
+template <>
+struct formatter<xdg::BuildQuality> : fmt::formatter<std::string> {
+  auto format(xdg::BuildQuality quality, fmt::format_context& ctx) const {
+    return fmt::formatter<std::string>::format(xdg::BUILD_QUALITY_TO_STR.at(quality), ctx);
+  }
+};
+
+template <>
+struct formatter<xdg::TreeClass> : fmt::formatter<std::string> {
+  auto format(xdg::TreeClass tree_class, fmt::format_context& ctx) const {
+    return fmt::formatter<std::string>::format(xdg::TREE_CLASS_TO_STR.at(tree_class), ctx);
+  }
+};
+
 
 }
 
@@ -0,0 +1,144 @@
+#ifndef _XDG_DENSE_MAP_H
+#define _XDG_DENSE_MAP_H
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xdg {
+
+/*! Map from integer IDs (MeshIDs and TreeIDs) to values, used for the lookup
+    tables consulted on every query.
+
+    Entries are stored contiguously in insertion order and found through a
+    vector indexed directly by ID, so a lookup is a bounds check and two
+    loads. TreeIDs are handed out densely by the ray tracers and the volume
+    and surface IDs of most models are nearly contiguous. IDs that are
+    negative or far larger than the number of entries (e.g. sparse IDs
+    assigned by a CAD tool) are translated through a hash table instead so
+    that the index stays proportional to the size of the map.
+
+    As with std::vector, inserting an entry may invalidate references to the
+    values of existing entries.
+ */
+template<typename Key, typename Value>
+class DenseMap {
+public:
+  using value_type = std::pair<Key, Value>;
+  using iterator = typename std::vector<value_type>::iterator;
+  using const_iterator = typename std::vector<value_type>::const_iterator;
+
+  //! Keys below this value are always indexed directly
+  static constexpr int64_t MIN_DIRECT_KEYS {1024};
+  //! Keys are also indexed directly while below this multiple of the number of entries
+  static constexpr int64_t DIRECT_KEYS_PER_ENTRY {8};
+
+  // Methods
+
+  //! \brief Number of entries with the given key (zero or one)
+  size_t count(Key key) const { return slot(key) != NONE ? 1 : 0; }
+
+  //! \brief Whether or not an entry with the given key exists
+  bool contains(Key key) const { return slot(key) != NONE; }
+
+  //! \brief Value for the given key
+  //! \throws std::out_of_range if the key is not in the map
+  const Value& at(Key key) const {
+    int32_t s = slot(key);
+    if (s == NONE) throw std::out_of_range("DenseMap has no entry for key " + std::to_string(key));
+    return entries_[s].second;
+  }
+
+  //! \brief Value for the given key
+  //! \throws std::out_of_range if the key is not in the map
+  Value& at(Key key) {
+    return const_cast<Value&>(static_cast<const DenseMap&>(*this).at(key));
+  }
+
+  //! \brief Value for the given key, inserting a default constructed value
+  //! if the key is not present
+  Value& operator[](Key key) {
+    int32_t s = slot(key);
+    if (s == NONE) s = insert_slot(key);
+    return entries_[s].second;
+  }
+
+  //! \brief Iterator to the entry with the given key, or end() if not present
+  const_iterator find(Key key) const {
+    int32_t s = slot(key);
+    return s == NONE ? entries_.end() : entries_.begin() + s;
+  }
+
+  //! \brief Remove all entries
+  void clear() {
+    entries_.clear();
+    index_.clear();
+    sparse_index_.clear();
+  }
+
+  // Accessors
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  //! \brief Entries in insertion order
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+private:
+  static constexpr int32_t NONE {-1};
+
+  //! \brief Position of the key in the entries, or NONE if not present
+  int32_t slot(Key key) const {
+    int64_t k = static_cast<int64_t>(key);
+    // keys within the direct index are never held by the sparse index
+    if (k >= 0 && k < static_cast<int64_t>(index_.size())) return index_[k];
+    if (sparse_index_.empty()) return NONE;
+    auto it = sparse_index_.find(key);
+    return it == sparse_index_.end() ? NONE : it->second;
+  }
+
+  //! \brief Add a default constructed entry for a key that is not present
+  int32_t insert_slot(Key key) {
+    int32_t s = static_cast<int32_t>(entries_.size());
+    entries_.emplace_back(key, Value());
+
+    int64_t k = static_cast<int64_t>(key);
+    int64_t direct_limit = std::max(MIN_DIRECT_KEYS, DIRECT_KEYS_PER_ENTRY * static_cast<int64_t>(entries_.size()));
+    if (k < 0 || k >= direct_limit) {
+      sparse_index_[key] = s;
+      return s;
+    }
+
+    if (k >= static_cast<int64_t>(index_.size())) {
+      // grow geometrically, moving any sparse keys that are now in range
+      size_t new_size = std::min<int64_t>(direct_limit, std::max<int64_t>(k + 1, 2 * index_.size()));
+      index_.resize(new_size, NONE);
+      for (auto it = sparse_index_.begin(); it != sparse_index_.end();) {
+        int64_t sparse_key = static_cast<int64_t>(it->first);
+        if (sparse_key >= 0 && sparse_key < static_cast<int64_t>(index_.size())) {
+          index_[sparse_key] = it->second;
+          it = sparse_index_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    index_[k] = s;
+    return s;
+  }
+
+  // Data members
+  std::vector<value_type> entries_; //!< Entries in insertion order
+  std::vector<int32_t> index_; //!< Position of each directly indexed key in the entries
+  std::unordered_map<Key, int32_t> sparse_index_; //!< Position of keys outside of the direct index
+};
+
+} // namespace xdg
+
+#endif // include guard
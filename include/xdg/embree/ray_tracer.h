@@ -1,11 +1,15 @@
 #ifndef _XDG_EMBREE_RAY_TRACING_INTERFACE_H
 #define _XDG_EMBREE_RAY_TRACING_INTERFACE_H
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 
+#include "xdg/config.h"
 #include "xdg/constants.h"
+#include "xdg/dense_map.h"
 #include "xdg/embree_interface.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/primitive_ref.h"
@@ -19,15 +23,39 @@ namespace xdg {
 class EmbreeRayTracer : public RayTracer {
   // constructors
 public:
+  //! Memory held by the ray tracer for each structure [bytes]
+  struct MemoryUsage {
+    size_t volume_surface_trees {0}; //!< Embree BVHs of the per-volume surface scenes
+    size_t global_surface_tree {0}; //!< Embree BVH of the global surface scene
+    size_t element_trees {0}; //!< Embree BVHs of the per-volume and global element scenes
+    size_t geometry {0}; //!< Embree geometries, including native triangle vertex buffers
+    size_t primitive_refs {0}; //!< Primitive reference buffers
+    size_t baked_triangles {0}; //!< Cached triangle vertices and normals
+    size_t baked_elements {0}; //!< Cached tetrahedron barycentric transforms
+
+    size_t total() const {
+      return volume_surface_trees + global_surface_tree + element_trees + geometry + primitive_refs +
+             baked_triangles + baked_elements;
+    }
+  };
+
   EmbreeRayTracer();
   ~EmbreeRayTracer();
   RTLibrary library() const override { return RTLibrary::EMBREE; }
 
+  //! Queries do not modify the ray tracer and are safe to issue concurrently
+  bool concurrent_queries() const override { return true; }
+
   void init() override;
-  RTCScene create_embree_scene();
+
+  //! \brief Create a new scene with the build settings of a tree class
+  RTCScene create_embree_scene(TreeClass tree_class);
 
   std::pair<TreeID, TreeID> register_volume(const std::shared_ptr<MeshManager>& mesh_manager, MeshID volume) override;
 
+  std::vector<std::pair<TreeID, TreeID>> register_volumes(const std::shared_ptr<MeshManager>& mesh_manager,
+                                                          const std::vector<MeshID>& volumes) override;
+
   TreeID create_surface_tree(const std::shared_ptr<MeshManager>& mesh_manager, MeshID volume) override;
 
   TreeID create_element_tree(const std::shared_ptr<MeshManager>& mesh_manager, MeshID volume) override;
@@ -40,12 +68,20 @@ public:
 
   MeshID find_element(TreeID tree, const Position& point) const override;
 
+  using RayTracer::locate;
+  ElementLocation locate(TreeID tree, const Position& point) const override;
+
+  MeshID find_volume(const Position& point, const Direction& direction) const override;
+
 
   // Query Methods
+  using RayTracer::point_in_volume;
+  using RayTracer::ray_fire;
+
   bool point_in_volume(TreeID scene,
                       const Position& point,
                       const Direction* direction = nullptr,
-                      const std::vector<MeshID>* exclude_primitives = nullptr) const override;
+                      const ExclusionSet* exclude_primitives = nullptr) const override;
 
 
   std::pair<double, MeshID> ray_fire(TreeID scene,
@@ -53,16 +89,93 @@ public:
                                      const Direction& direction,
                                      const double dist_limit = INFTY,
                                      HitOrientation orientation = HitOrientation::EXITING,
-                                     std::vector<MeshID>* const exclude_primitives = nullptr) override;
+                                     ExclusionSet* const exclude_primitives = nullptr) const override;
+
+  void ray_fire(TreeID scene,
+                const Position* origins,
+                const Direction* directions,
+                size_t n_rays,
+                std::pair<double, MeshID>* hits,
+                const double dist_limit = INFTY,
+                HitOrientation orientation = HitOrientation::EXITING,
+                ExclusionSet* const exclude_primitives = nullptr) const override;
 
   std::pair<double, MeshID> closest(TreeID scene,
-                                    const Position& origin) override;
+                                    const Position& origin) const override;
 
   bool occluded(TreeID scene,
                 const Position& origin,
                 const Direction& direction,
                 double& dist) const override;
 
+  //! \brief Set the ray packet size used for batched ray fire queries
+  //! \param packet_size One of 1 (single ray queries), 4, 8 or 16
+  void set_packet_size(int packet_size);
+
+  //! \brief Ray packet size used for batched ray fire queries
+  int packet_size() const { return packet_size_; }
+
+  //! \brief Enable or disable caching of triangle vertices and normals in
+  //! the ray tracer for surfaces registered after this call. Cached triangles
+  //! are read directly by the Embree callbacks instead of being queried from
+  //! the mesh manager at the cost of additional memory.
+  void set_bake_triangles(bool bake) { bake_triangles_ = bake; }
+
+  //! \brief Whether or not triangle data is cached for new surfaces
+  bool bake_triangles() const { return bake_triangles_; }
+
+  //! \brief Enable or disable caching of a barycentric transform for each
+  //! tetrahedron in the element trees of volumes registered after this call.
+  //! Point location then tests each candidate element with a single
+  //! matrix-vector product instead of reading its vertices from the mesh
+  //! manager and inverting a matrix, at the cost of 96 bytes per element.
+  void set_bake_elements(bool bake) { bake_elements_ = bake; }
+
+  //! \brief Whether or not element transforms are cached for new volumes
+  bool bake_elements() const { return bake_elements_; }
+
+  //! \brief Register surfaces as native Embree triangle geometry. Embree's
+  //! single precision triangle BVH and intersectors are used for traversal and
+  //! candidate hits are refined in double precision before being accepted.
+  //! Must be set before any volumes are registered.
+  void set_native_triangles(bool native);
+
+  //! \brief Whether or not surfaces are registered as native triangle geometry
+  bool native_triangles() const { return native_triangles_; }
+
+  //! \brief Set the build quality and scene flags used for trees of the given
+  //! class. Applies to trees created after this call. The initial settings
+  //! are taken from XDGConfig when the ray tracer is created.
+  void set_tree_build_settings(TreeClass tree_class, const TreeBuildSettings& settings) {
+    tree_build_settings_.at(static_cast<size_t>(tree_class)) = settings;
+  }
+
+  //! \brief Build settings used for trees of the given class
+  const TreeBuildSettings& tree_build_settings(TreeClass tree_class) const {
+    return tree_build_settings_.at(static_cast<size_t>(tree_class));
+  }
+
+  //! \brief Enable or disable a separate surface tree for each volume. When
+  //! disabled, the surfaces of all volumes are built into the global surface
+  //! scene only and the tree of each volume refers to that scene, skipping
+  //! surfaces that do not bound the volume during queries. This avoids
+  //! building each surface into as many as three trees at the cost of slower
+  //! queries on large models. Must be set before any volumes are registered.
+  void set_volume_trees(bool volume_trees);
+
+  //! \brief Whether or not a separate surface tree is built for each volume
+  bool volume_trees() const { return volume_trees_; }
+
+  //! \brief Configure the ray tracer for the smallest memory footprint: all
+  //! trees use the compact scene layout, surfaces share the global surface
+  //! scene (see set_volume_trees) and triangle and element data is read from
+  //! the mesh manager rather than copied. Must be set before any volumes are registered.
+  void set_low_memory(bool low_memory);
+
+  //! \brief Memory held by the ray tracer for each structure. Tree and
+  //! geometry memory is measured as it is allocated by Embree.
+  MemoryUsage memory_usage() const;
+
   // Embree members
   RTCDevice device_;
   std::vector<RTCGeometry> geometries_; //<! All geometries created by this ray tracer
@@ -74,21 +187,64 @@ public:
   std::unordered_map<RTCGeometry, std::shared_ptr<SurfaceUserData>> surface_user_data_map_;
   std::unordered_map<RTCGeometry, std::shared_ptr<VolumeElementsUserData>> volume_user_data_map_;
 
-  std::unordered_map<SurfaceTreeID, RTCScene> surface_volume_tree_to_scene_map_; // Map from SurfaceVolumeTreeID to specific embree scene/tree
-  std::unordered_map<ElementTreeID, RTCScene> element_volume_tree_to_scene_map_; // Map from ElementVolumeTreeID to specific embree scene/tree
+  DenseMap<SurfaceTreeID, RTCScene> surface_volume_tree_to_scene_map_; // Map from SurfaceVolumeTreeID to specific embree scene/tree
+  DenseMap<ElementTreeID, RTCScene> element_volume_tree_to_scene_map_; // Map from ElementVolumeTreeID to specific embree scene/tree
 
   // storage
-  std::unordered_map<RTCScene, std::vector<PrimitiveRef>> primitive_ref_storage_;
+  std::vector<std::vector<PrimitiveRef>> primitive_ref_storage_; //<! Blocks of primitive references for the registered geometries
 
 private:
-  std::pair<RTCGeometry, std::shared_ptr<SurfaceUserData>> register_surface(const std::shared_ptr<MeshManager>& mesh_manager,
-                                                                             MeshID surface,
-                                                                             RTCScene& volume_scene,
-                                                                             int& storage_offset);
+  //! \brief Set up the surface scenes of a set of volumes without building them
+  //! \param scenes Vector the new scenes are appended to, in volume order
+  //! \return The surface tree of each volume
+  std::vector<SurfaceTreeID> create_surface_trees(const std::shared_ptr<MeshManager>& mesh_manager,
+                                                  const std::vector<MeshID>& volumes,
+                                                  std::vector<RTCScene>& scenes);
+
+  //! \brief Set up the element scene of a volume without building it
+  //! \param volume_element_scene Set to the new scene, or nullptr if the volume has no elements
+  //! \return The element tree of the volume, or TREE_NONE if the volume has no elements
+  ElementTreeID setup_element_tree(const std::shared_ptr<MeshManager>& mesh_manager,
+                                   MeshID volume,
+                                   RTCScene& volume_element_scene);
+
+  //! \brief Build a set of scenes of the same class concurrently
+  void commit_scenes(const std::vector<RTCScene>& scenes, TreeClass tree_class);
+
+  //! \brief Class of the scenes holding the surfaces of each volume
+  TreeClass surface_tree_class() const {
+    return volume_trees_ ? TreeClass::VOLUME_SURFACE : TreeClass::GLOBAL_SURFACE;
+  }
+
+  //! \brief Whether or not queries on a surface tree must skip the surfaces of other volumes
+  bool volume_filter(TreeID tree) const { return !volume_trees_ && tree != global_surface_tree_; }
+
+  //! \brief Embree memory monitor callback tracking the bytes allocated by the device
+  static bool memory_monitor(void* ray_tracer, ssize_t bytes, bool post);
+
+  //! \brief Create the Embree geometry and user data for a surface. Does not
+  //! modify the ray tracer, so surfaces may be created concurrently.
+  std::pair<RTCGeometry, std::shared_ptr<SurfaceUserData>> create_surface_geometry(const std::shared_ptr<MeshManager>& mesh_manager,
+                                                                                    MeshID surface,
+                                                                                    const std::vector<MeshID>& surface_faces,
+                                                                                    PrimitiveRef* primitive_refs) const;
+
   // Global Tree IDs
   RTCScene global_surface_scene_ {nullptr};
   RTCScene global_element_scene_ {nullptr};
 
+  int packet_size_ {8}; //!< Ray packet size used for batched ray fire queries
+  bool bake_triangles_ {false}; //!< Cache triangle data for new surfaces
+  bool bake_elements_ {false}; //!< Cache element transforms for new volumes
+  bool native_triangles_ {false}; //!< Use native Embree triangle geometry for surfaces
+  std::array<TreeBuildSettings, 3> tree_build_settings_; //!< Build settings for each TreeClass
+  bool volume_trees_ {true}; //!< Build a separate surface tree for each volume
+
+  // Memory accounting
+  std::atomic<int64_t> device_bytes_ {0}; //!< Bytes currently allocated by the Embree device
+  std::array<int64_t, 3> tree_bytes_ {}; //!< Bytes allocated by the tree builds of each TreeClass
+  int64_t geometry_bytes_ {0}; //!< Bytes allocated for surface geometries
+
 };
 
 } // namespace xdg
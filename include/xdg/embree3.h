@@ -22,4 +22,33 @@ inline void rtcOccluded1(RTCScene scene, RTCRay* ray) {
   }
 }
 
+// embree v4 renamed the intersection context passed through to geometry
+// callbacks; alias it here so callbacks can be written against one name
+typedef RTCIntersectContext RTCRayQueryContext;
+
+inline void rtcInitRayQueryContext(RTCRayQueryContext* context) {
+  rtcInitIntersectContext(context);
+}
+
+// queries with the argument order used by embree > v4
+inline void rtcIntersect1(RTCScene scene, RTCRayHit* rayhit, RTCRayQueryContext* context) {
+  rtcIntersect1(scene, context, rayhit);
+}
+
+inline void rtcOccluded1(RTCScene scene, RTCRay* ray, RTCRayQueryContext* context) {
+  rtcOccluded1(scene, context, ray);
+}
+
+inline void rtcIntersect4(const int* valid, RTCScene scene, RTCRayHit4* rayhit, RTCRayQueryContext* context) {
+  rtcIntersect4(valid, scene, context, rayhit);
+}
+
+inline void rtcIntersect8(const int* valid, RTCScene scene, RTCRayHit8* rayhit, RTCRayQueryContext* context) {
+  rtcIntersect8(valid, scene, context, rayhit);
+}
+
+inline void rtcIntersect16(const int* valid, RTCScene scene, RTCRayHit16* rayhit, RTCRayQueryContext* context) {
+  rtcIntersect16(valid, scene, context, rayhit);
+}
+
 #endif // include guard
\ No newline at end of file
@@ -1,3 +1,44 @@
-
 #include "embree4/rtcore.h"
-#include "embree4/rtcore_ray.h"
\ No newline at end of file
+#include "embree4/rtcore_ray.h"
+
+#ifndef XDG_EMBREE4_WRAPPERS
+#define XDG_EMBREE4_WRAPPERS
+
+// queries that carry a user-provided query context, matching the
+// signatures provided for embree v3 in embree3.h
+inline void rtcIntersect1(RTCScene scene, RTCRayHit* rayhit, RTCRayQueryContext* context) {
+  RTCIntersectArguments args;
+  rtcInitIntersectArguments(&args);
+  args.context = context;
+  rtcIntersect1(scene, rayhit, &args);
+}
+
+inline void rtcIntersect4(const int* valid, RTCScene scene, RTCRayHit4* rayhit, RTCRayQueryContext* context) {
+  RTCIntersectArguments args;
+  rtcInitIntersectArguments(&args);
+  args.context = context;
+  rtcIntersect4(valid, scene, rayhit, &args);
+}
+
+inline void rtcIntersect8(const int* valid, RTCScene scene, RTCRayHit8* rayhit, RTCRayQueryContext* context) {
+  RTCIntersectArguments args;
+  rtcInitIntersectArguments(&args);
+  args.context = context;
+  rtcIntersect8(valid, scene, rayhit, &args);
+}
+
+inline void rtcIntersect16(const int* valid, RTCScene scene, RTCRayHit16* rayhit, RTCRayQueryContext* context) {
+  RTCIntersectArguments args;
+  rtcInitIntersectArguments(&args);
+  args.context = context;
+  rtcIntersect16(valid, scene, rayhit, &args);
+}
+
+inline void rtcOccluded1(RTCScene scene, RTCRay* ray, RTCRayQueryContext* context) {
+  RTCOccludedArguments args;
+  rtcInitOccludedArguments(&args);
+  args.context = context;
+  rtcOccluded1(scene, ray, &args);
+}
+
+#endif // include guard
@@ -0,0 +1,116 @@
+#ifndef _XDG_EXCLUSION_SET_H
+#define _XDG_EXCLUSION_SET_H
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "xdg/constants.h"
+
+namespace xdg {
+
+/*! Set of primitive IDs to exclude from ray queries.
+
+    Entries are kept in insertion order in inline storage alongside a small
+    open-addressing hash table, so lookups made from the ray tracing callbacks
+    are O(1) and building or clearing the set for each ray does not touch the
+    heap. If more than CAPACITY primitives are added the entries are moved to
+    heap storage and any entries beyond the inline capacity are searched
+    linearly. Particle histories are cleared at every collision and rarely
+    reach that size.
+ */
+class ExclusionSet {
+public:
+  static constexpr size_t CAPACITY {32}; //!< Number of entries stored inline
+  static constexpr size_t TABLE_SIZE {2 * CAPACITY}; //!< Number of hash table slots (power of two)
+
+  // Constructors
+  ExclusionSet() { table_.fill(ID_NONE); }
+
+  ExclusionSet(std::initializer_list<MeshID> ids) : ExclusionSet() {
+    for (auto id : ids) insert(id);
+  }
+
+  template<typename It>
+  ExclusionSet(It first, It last) : ExclusionSet() {
+    for (; first != last; ++first) insert(*first);
+  }
+
+  // Methods
+
+  //! \brief Check whether a primitive is in the set
+  bool contains(MeshID id) const {
+    if (id == ID_NONE) return false;
+    for (size_t slot = hash(id);; slot = (slot + 1) & (TABLE_SIZE - 1)) {
+      if (table_[slot] == id) return true;
+      if (table_[slot] == ID_NONE) break;
+    }
+    // entries past the inline capacity are not in the hash table
+    for (size_t i = CAPACITY; i < size_; i++) {
+      if (overflow_[i] == id) return true;
+    }
+    return false;
+  }
+
+  //! \brief Add a primitive to the set
+  //! \return True if the primitive was added, false if it was already present
+  bool insert(MeshID id) {
+    if (id == ID_NONE || contains(id)) return false;
+
+    if (size_ < CAPACITY) {
+      size_t slot = hash(id);
+      while (table_[slot] != ID_NONE) slot = (slot + 1) & (TABLE_SIZE - 1);
+      table_[slot] = id;
+      entries_[size_] = id;
+    } else {
+      // move entries to the heap so that they remain contiguous
+      if (overflow_.empty()) overflow_.assign(entries_.begin(), entries_.end());
+      overflow_.push_back(id);
+    }
+    size_++;
+    return true;
+  }
+
+  //! \brief Add a primitive to the set (same as insert)
+  void push_back(MeshID id) { insert(id); }
+
+  //! \brief Remove all primitives from the set
+  void clear() {
+    if (size_ == 0) return;
+    table_.fill(ID_NONE);
+    overflow_.clear();
+    size_ = 0;
+  }
+
+  // Accessors
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  //! \brief The most recently added primitive
+  MeshID back() const { return data()[size_ - 1]; }
+
+  //! \brief Contiguous view of the primitives in insertion order
+  const MeshID* data() const { return overflow_.empty() ? entries_.data() : overflow_.data(); }
+  const MeshID* begin() const { return data(); }
+  const MeshID* end() const { return data() + size_; }
+
+private:
+  static size_t hash(MeshID id) {
+    // Fibonacci hashing, keeping the top bits of the product
+    return (static_cast<uint32_t>(id) * 2654435769u) >> (32 - TABLE_BITS);
+  }
+
+  static constexpr int TABLE_BITS {6}; //!< log2(TABLE_SIZE)
+  static_assert(TABLE_SIZE == (size_t(1) << TABLE_BITS), "Exclusion set table size must match the hash width");
+
+  // Data members
+  size_t size_ {0}; //!< Number of primitives in the set
+  std::array<MeshID, CAPACITY> entries_; //!< Inline storage of the primitives in insertion order
+  std::array<MeshID, TABLE_SIZE> table_; //!< Open-addressing hash table of the inline entries
+  std::vector<MeshID> overflow_; //!< Heap storage of all primitives once CAPACITY is exceeded
+};
+
+} // namespace xdg
+
+#endif // include guard
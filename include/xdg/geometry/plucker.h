@@ -19,6 +19,9 @@ namespace xdg {
  * The vertices are ordered counter-clockwise when viewed from the front face
  * (normal pointing out of the plane). This ordering is based on the reference:
  * https://doi.org/10.1002/cnm.1237
+ *
+ * Plucker coordinates with a magnitude below zero_tol are treated as zero,
+ * i.e. the ray is considered to pass through the corresponding edge.
  */
 bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
                                const Position& origin,
@@ -26,7 +29,91 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
                                double& dist_out,
                                const double nonneg_ray_len = INFTY,
                                const double* neg_ray_len = nullptr,
-                               const int* orientation = nullptr);
+                               const int* orientation = nullptr,
+                               const double zero_tol = PLUCKER_ZERO_TOL);
+
+/*
+ * Find the face through which a ray leaves a tetrahedron.
+ *
+ * Each of the six edges of the tetrahedron is shared by two faces, so the
+ * Plucker products of the ray with the edges are computed once and reused for
+ * both faces (Platis & Theoharis, https://doi.org/10.1080/10867651.2003.10487592).
+ * The face tests and distances are identical to calling
+ * plucker_ray_tri_intersect with an exiting orientation on each face, with
+ * negative distances to accepted faces clamped to zero.
+ *
+ * faces gives the local vertex indices of each face, wound so that the face
+ * normals point out of the tetrahedron. Returns the index of the exit face
+ * with the smallest distance, or -1 if the ray exits through no face. The
+ * distance to the exit face (INFTY if none) is returned in dist_out.
+ */
+int plucker_ray_tet_exit(const std::array<Position, 4>& vertices,
+                         const std::array<std::array<int, 3>, 4>& faces,
+                         const Position& origin,
+                         const Direction& direction,
+                         double& dist_out);
+
+/*
+ * Batched ray-triangle intersection.
+ *
+ * The batched routines below evaluate plucker_ray_tri_intersect for several
+ * ray/triangle pairs at once, with one pair per lane of a SIMD register in
+ * structure-of-arrays form. Each lane performs the same double precision
+ * operations in the same order as the scalar routine, so hit decisions and
+ * hit distances are identical to calling plucker_ray_tri_intersect on each
+ * pair (without a negative ray length). The distance of a missed pair is
+ * INFTY.
+ *
+ * The instruction set is selected at runtime from those supported by the
+ * host CPU. Remainders that do not fill a register use the scalar routine.
+ */
+
+//! Instruction sets available to the batched Plucker routines
+enum class SIMDLevel {
+  SCALAR = 0,
+  AVX2,
+  AVX512
+};
+
+//! \brief Widest instruction set supported by the host CPU
+SIMDLevel max_simd_level();
+
+//! \brief Instruction set currently used by the batched routines
+SIMDLevel simd_level();
+
+//! \brief Set the instruction set used by the batched routines. Must be
+//! supported by the host CPU. Not thread safe.
+void set_simd_level(SIMDLevel level);
+
+//! \brief Intersect one ray with a batch of triangles
+//! \param vertices Triangle vertex coordinates, 9 values per triangle (the
+//! layout of BakedTriangleData)
+//! \param n_triangles Number of triangles in the batch
+//! \param hits_out Whether the ray hits each triangle
+//! \param dists_out Distance to each triangle
+void plucker_ray_tri_intersect_batch(const double* vertices,
+                                     size_t n_triangles,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     bool* hits_out,
+                                     double* dists_out,
+                                     const double nonneg_ray_len = INFTY,
+                                     const int* orientation = nullptr);
+
+//! \brief Intersect a batch of rays with one triangle
+//! \param origins Origin of each ray
+//! \param directions Direction of each ray
+//! \param n_rays Number of rays in the batch
+//! \param hits_out Whether each ray hits the triangle
+//! \param dists_out Distance along each ray to the triangle
+void plucker_rays_tri_intersect_batch(const std::array<Position, 3>& vertices,
+                                      const Position* origins,
+                                      const Direction* directions,
+                                      size_t n_rays,
+                                      bool* hits_out,
+                                      double* dists_out,
+                                      const double nonneg_ray_len = INFTY,
+                                      const int* orientation = nullptr);
 
 } // namespace xdg
 
@@ -1,7 +1,11 @@
 #ifndef _XDG_GEOMETRY_DATA_H
 #define _XDG_GEOMETRY_DATA_H
 
+#include <array>
+#include <vector>
+
 #include "xdg/constants.h"
+#include "xdg/vec3da.h"
 
 namespace xdg
 {
@@ -9,19 +13,79 @@ namespace xdg
 struct MeshManager; // Forward declaration
 struct PrimitiveRef; // Forward declaration
 
+/*! Double precision copy of the triangles in a surface geometry, indexed by
+    the primitive's slot in the geometry (the primID reported by Embree). Lets
+    the ray tracing callbacks read triangle data without going through the
+    mesh manager.
+ */
+struct BakedTriangleData {
+  std::vector<double> vertices; //! Triangle vertex coordinates (9 values per triangle)
+  std::vector<double> normals; //! Triangle unit normals (3 values per triangle)
+
+  bool empty() const { return normals.empty(); }
+
+  //! \brief Append a triangle to the cache
+  void push_back(const std::array<Vertex, 3>& tri_vertices, const Direction& normal) {
+    for (const auto& v : tri_vertices) {
+      vertices.insert(vertices.end(), {v.x, v.y, v.z});
+    }
+    normals.insert(normals.end(), {normal.x, normal.y, normal.z});
+  }
+
+  //! \brief Get the vertices of the triangle in the specified slot
+  std::array<Vertex, 3> triangle_vertices(size_t i) const {
+    const double* v = vertices.data() + 9 * i;
+    return {Vertex(v[0], v[1], v[2]), Vertex(v[3], v[4], v[5]), Vertex(v[6], v[7], v[8])};
+  }
+
+  //! \brief Get the normal of the triangle in the specified slot
+  Direction normal(size_t i) const {
+    const double* n = normals.data() + 3 * i;
+    return {n[0], n[1], n[2]};
+  }
+};
+
+/*! Barycentric transforms of the tetrahedra in an element geometry, indexed
+    by the primitive's slot in the geometry. Each transform is stored as 12
+    contiguous values (see tet_barycentric_transform) so that a containment
+    test reads one or two cache lines and does not go through the mesh manager.
+ */
+struct BakedTetrahedronData {
+  static constexpr size_t STRIDE {12}; //! Number of values per tetrahedron
+
+  std::vector<double> transforms; //! Barycentric transform of each tetrahedron
+
+  bool empty() const { return transforms.empty(); }
+
+  //! \brief Append the transform of a tetrahedron to the cache
+  void push_back(const std::array<double, STRIDE>& transform) {
+    transforms.insert(transforms.end(), transform.begin(), transform.end());
+  }
+
+  //! \brief Get the transform of the tetrahedron in the specified slot
+  const double* transform(size_t i) const { return transforms.data() + STRIDE * i; }
+};
+
 struct SurfaceUserData {
   MeshID surface_id {ID_NONE}; //! ID of the surface this geometry data is associated with
   MeshManager* mesh_manager {nullptr}; //! Pointer to the mesh manager for this geometry
   PrimitiveRef* prim_ref_buffer {nullptr}; //! Pointer to the mesh primitives in the geometry
-  double box_bump; //! Bump distance for the bounding boxes in this geometry
+  double box_bump {0.0}; //! Bump distance for the bounding boxes in this geometry
   MeshID forward_vol {ID_NONE}; // ID of the forward sense volume
   MeshID reverse_vol {ID_NONE}; // ID of the reverse sense volume
+  TreeID forward_tree {TREE_NONE}; // TreeID of the forward sense volume
+  TreeID reverse_tree {TREE_NONE}; // TreeID of the reverse sense volume
+  BakedTriangleData baked_triangles; //! Optional cache of the triangle data for this geometry
+
+  //! \brief Whether or not this surface bounds the volume of a surface tree
+  bool bounds_volume(TreeID tree) const { return tree == forward_tree || tree == reverse_tree; }
 };
 
 struct VolumeElementsUserData {
   MeshID volume_id {ID_NONE}; //! ID of the volume this geometry data is associated with
   MeshManager* mesh_manager {nullptr}; //! Pointer to the mesh manager for this geometry
   PrimitiveRef* prim_ref_buffer {nullptr}; //! Pointer to the mesh primitives in the geometry
+  BakedTetrahedronData baked_elements; //! Optional cache of the element transforms for this geometry
 };
 
 } // namespace xdg
@@ -43,6 +43,9 @@ class GPRTRayTracer : public RayTracer {
     ~GPRTRayTracer();
     RTLibrary library() const override { return RTLibrary::GPRT; }
 
+    //! Queries share the device ray and hit buffers and must be serialized
+    bool concurrent_queries() const override { return false; }
+
     void set_geom_data(const std::shared_ptr<MeshManager> mesh_manager);
     void init() override;
 
@@ -60,6 +63,14 @@ class GPRTRayTracer : public RayTracer {
       return ID_NONE;
     };
 
+    using RayTracer::locate;
+    ElementLocation locate(TreeID tree, const Position& point) const override {
+      fatal_error("Element trees not currently supported with GPRT ray tracer");
+      return {};
+    };
+
+    MeshID find_volume(const Position& point, const Direction& direction) const override;
+
     std::pair<TreeID, TreeID>
     register_volume(const std::shared_ptr<MeshManager>& mesh_manager, 
                     MeshID volume) override;
@@ -78,20 +89,24 @@ class GPRTRayTracer : public RayTracer {
       return;
     };
 
+    using RayTracer::point_in_volume;
+
     bool point_in_volume(TreeID scene,
                         const Position& point,
                         const Direction* direction = nullptr,
-                        const std::vector<MeshID>* exclude_primitives = nullptr) const override;
+                        const ExclusionSet* exclude_primitives = nullptr) const override;
 
     std::pair<double, MeshID> ray_fire(TreeID scene,
                                       const Position& origin,
                                       const Direction& direction,
                                       const double dist_limit = INFTY,
                                       HitOrientation orientation = HitOrientation::EXITING,
-                                      std::vector<MeshID>* const exclude_primitives = nullptr) override;
+                                      ExclusionSet* const exclude_primitives = nullptr) const override;
+
+    using RayTracer::ray_fire; // batched and vector exclusion versions forward to the version above
 
     std::pair<double, MeshID> closest(TreeID scene,
-                                      const Position& origin) override {};
+                                      const Position& origin) const override {};
 
     bool occluded(TreeID scene,
                   const Position& origin,
@@ -104,6 +119,9 @@ class GPRTRayTracer : public RayTracer {
   private:
     void check_ray_buffer_capacity(size_t N);
 
+    //! \brief Copy the excluded primitives to the device and point the ray at them
+    void upload_exclude_primitives(dblRay& ray, const ExclusionSet* exclude_primitives) const;
+
     // GPRT objects 
     GPRTContext context_;
     GPRTProgram deviceCode_; // device code for float precision shaders
@@ -133,6 +151,8 @@ class GPRTRayTracer : public RayTracer {
 
     // Internal GPRT Mappings
     std::unordered_map<SurfaceTreeID, GPRTAccel> surface_volume_tree_to_accel_map; // Map from XDG::TreeID to GPRTAccel for volume TLAS
+    std::unordered_map<MeshID, SurfaceTreeID> volume_surface_tree_map_; // Map from volume to its surface tree
+    std::unordered_map<MeshID, std::pair<MeshID, MeshID>> surface_parent_volumes_; // Map from surface to its forward and reverse sense volumes
     std::vector<GPRTAccel> blas_handles_; // Store BLAS handles so that they can be explicitly referenced in destructor
 
     // Global Tree IDs
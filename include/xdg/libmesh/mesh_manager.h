@@ -100,6 +100,10 @@ public:
 
   std::vector<Vertex> element_vertices(MeshID element) const override;
 
+  std::array<Vertex, 4> tet_vertices(MeshID element) const override;
+
+  const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override;
+
   std::array<Vertex, 3> face_vertices(MeshID triangle) const override;
 
   std::vector<MeshID> get_volume_surfaces(MeshID volume) const override;
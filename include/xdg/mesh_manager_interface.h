@@ -2,6 +2,8 @@
 #ifndef _XDG_MESH_MANAGER_INTERFACE
 #define _XDG_MESH_MANAGER_INTERFACE
 
+#include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -55,6 +57,45 @@ public:
                 const Direction& u,
                 double distance) const;
 
+  //! \brief Walk through elements along a ray, appending the segments to a
+  //! caller-provided buffer so that it can be reused between walks
+  //! \param segments Buffer the (element, distance) pairs are appended to
+  void walk_elements(MeshID starting_element,
+                     const Position& start,
+                     const Direction& u,
+                     double distance,
+                     std::vector<std::pair<MeshID, double>>& segments) const;
+
+  //! \brief Walk through elements along a ray, calling visit(element, distance)
+  //! for each element traversed instead of storing the segments
+  //! \note It is assumed that the provided position is within the starting element.
+  //! \param visit Callable invoked with the element ID and the distance traveled through it
+  template<typename Visitor>
+  void walk_elements(MeshID starting_element,
+                     const Position& start,
+                     const Direction& u,
+                     double distance,
+                     Visitor&& visit) const
+  {
+    // a copy of the start position that will be updated as elements are traversed
+    Position r = start;
+    MeshID elem = starting_element;
+    while (distance > 0) {
+      // find the exit point from the current element and determine the next element
+      // if one exists
+      auto exit = next_element(elem, r, u);
+      // ensure we are not traveling beyond the end of the ray
+      exit.second = std::min(exit.second, distance);
+      distance -= exit.second;
+      visit(elem, exit.second);
+      r += exit.second * u;
+      elem = exit.first;
+
+      // if there is no next element, we're exiting the mesh
+      if (elem == ID_NONE) break;
+    }
+  }
+
   //! \brief Find the next element along a ray from the current position.
   //! \note It is assumed that the provided position is within the element.
   //! \param current_element The current element being traversed
@@ -84,6 +125,16 @@ public:
   // TODO: can we accomplish this without allocating memory?
   virtual std::vector<Vertex> element_vertices(MeshID element) const = 0;
 
+  //! \brief Get the vertices of a tetrahedral element without allocating
+  //! \param element The element ID
+  //! \return The four vertices of the element
+  virtual std::array<Vertex, 4> tet_vertices(MeshID element) const;
+
+  //! \brief Local vertex indices of each face of a tetrahedron, listed in
+  //! the face numbering used by adjacent_element. Faces are wound so that
+  //! their normals point out of the element.
+  virtual const std::array<std::array<int, 3>, 4>& tet_face_ordering() const = 0;
+
   virtual std::array<Vertex, 3> face_vertices(MeshID element) const = 0;
 
   virtual std::vector<Vertex> get_surface_vertices(MeshID surface) const = 0;
@@ -1,13 +1,19 @@
 #ifndef _MBDIRECTACCESS_
 #define _MBDIRECTACCESS_
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 // MOAB
 #include "moab/Core.hpp"
 #include "moab/CartVect.hpp"
 #include "xdg/constants.h"
+#include "xdg/util/snapshot.h"
 #include "xdg/vec3da.h"
 
 
@@ -31,50 +37,65 @@ public:
   //! \brief Update internal data structures to account for changes in the MOAB instance
   void update();
 
+  //! \brief Add the internal data structures to a snapshot
+  void save_snapshot(SnapshotWriter& writer) const;
+
+  //! \brief Initialize internal structures from a snapshot instead of the
+  //! MOAB instance. The snapshot is only used if its vertices and elements
+  //! match those of the MOAB instance.
+  //! \return Whether or not the snapshot was loaded
+  bool load_snapshot(const SnapshotReader& reader);
+
+  //! \brief Set whether or not the vertices and elements are renumbered along a
+  //! space-filling curve when the internal structures are set up. Elements that
+  //! are close in space are then close in memory, which improves the cache
+  //! behaviour of element walks. MOAB handles and IDs are unaffected.
+  void set_reorder(bool reorder) { reorder_ = reorder; }
+
+  //! \brief Whether or not the vertices and elements are renumbered
+  bool reorder() const { return reorder_; }
+
   //! \brief Check that a triangle is part of the managed coordinates here
-  inline bool accessible(EntityHandle tri) {
-    // determine the correct contiguous memory block index to use
-    int block_idx = 0;
-    auto fe = face_data_.first_elements[block_idx];
-    while(true) {
-      if (tri - fe.first < fe.second) { break; }
-      block_idx++;
-      if (block_idx >= face_data_.first_elements.size()) { return false; }
-      fe = face_data_.first_elements[block_idx];
-    }
-    return true;
+  inline bool accessible(EntityHandle tri) const {
+    return face_data_.contains(tri);
   }
 
   //! \brief Get the coordinates of a triangle as XDG Vertices
-  inline std::array<xdg::Vertex, 3> get_mb_coords(const EntityHandle& tri) {
-    auto [i0, i1, i2] = face_data_.get_connectivity_indices<3>(tri);
-
-    std::array<xdg::Vertex, 3> vertices;
-    vertex_data_.set_coords(i0, vertices[0]);
-    vertex_data_.set_coords(i1, vertices[1]);
-    vertex_data_.set_coords(i2, vertices[2]);
-    return vertices;
+  inline std::array<xdg::Vertex, 3> get_mb_coords(const EntityHandle& tri) const {
+    return face_coords(face_data_.handle_slot(tri));
   }
 
-  //! \brief Get the coordinates of a triangle as XDG Vertices
-  inline std::array<xdg::Vertex, 4> get_element_coords(const EntityHandle& element) {
-    auto [i0, i1, i2, i3] = element_data_.get_connectivity_indices<4>(element);
-
-    std::array<xdg::Vertex, 4> vertices;
-    vertex_data_.set_coords(i0, vertices[0]);
-    vertex_data_.set_coords(i1, vertices[1]);
-    vertex_data_.set_coords(i2, vertices[2]);
-    vertex_data_.set_coords(i3, vertices[3]);
-    return vertices;
+  //! \brief Get the coordinates of a tetrahedron as XDG Vertices
+  inline std::array<xdg::Vertex, 4> get_element_coords(const EntityHandle& element) const {
+    return element_coords(element_data_.handle_slot(element));
+  }
+
+  //! \brief Get the coordinates of a triangle by MOAB ID as XDG Vertices
+  inline std::array<xdg::Vertex, 3> get_face_coords(MeshID tri) const {
+    return face_coords(face_data_.slot(tri));
+  }
+
+  //! \brief Get the coordinates of a tetrahedron by MOAB ID as XDG Vertices
+  inline std::array<xdg::Vertex, 4> get_element_coords_by_id(MeshID element) const {
+    return element_coords(element_data_.slot(element));
   }
 
   //! \brief Get the adjacent element
-  inline EntityHandle get_adjacent_element(const EntityHandle& element, int face_number) {
-    return element_adjacency_data_.get_adjacent_element(element, face_number);
+  inline EntityHandle get_adjacent_element(const EntityHandle& element, int face_number) const {
+    int32_t adj = element_adjacency_data_.adjacent_slot(element_data_.handle_slot(element), face_number);
+    return adj == ID_NONE ? static_cast<EntityHandle>(ID_NONE) : element_data_.slots.handle(adj);
   }
 
-  inline std::vector<EntityHandle> get_element_adjacencies(const EntityHandle& element) {
-    return element_adjacency_data_.get_element_adjacencies(element);
+  //! \brief Get the MOAB ID of the adjacent element (ID_NONE if the face is on the boundary)
+  inline MeshID get_adjacent_element_by_id(MeshID element, int face_number) const {
+    int32_t adj = element_adjacency_data_.adjacent_slot(element_data_.slot(element), face_number);
+    return adj == ID_NONE ? ID_NONE : element_data_.slots.id(adj);
+  }
+
+  inline std::vector<EntityHandle> get_element_adjacencies(const EntityHandle& element) const {
+    std::vector<EntityHandle> adjacencies(element_adjacency_data_.faces_per_element);
+    for (int i = 0; i < adjacencies.size(); i++) adjacencies[i] = get_adjacent_element(element, i);
+    return adjacencies;
   }
 
   const std::vector<std::vector<int>>& get_face_ordering(EntityType entity_type) const {
@@ -83,98 +104,168 @@ public:
 
   // Accessors
   //! \brief return the number of vertices being managed
-  inline int n_vertices() { return vertex_data_.num_vertices; }
+  inline int n_vertices() const { return vertex_data_.num_vertices; }
 
 private:
   Interface* mbi {nullptr}; //!< MOAB instance for the managed data
 
+  /*! Map from MOAB entity handles (or IDs) of a single entity type to dense
+      0..N-1 slots. Handles of one type are contiguous in ID space, so the
+      offset from the first handle is used directly as the slot when there are
+      no gaps and through a lookup table otherwise.
+   */
+  struct SlotMap {
+    EntityHandle first_handle {0}; //!< Lowest handle in the map
+    MeshID first_id {ID_NONE}; //!< MOAB ID of the lowest handle in the map
+    size_t extent {0}; //!< Number of handles between the lowest and highest handles (inclusive)
+    std::vector<int32_t> offset_to_slot; //!< Slot for each handle offset (empty if there are no gaps)
+    std::vector<int32_t> slot_to_offset; //!< Handle offset of each slot (empty if there are no gaps)
+
+    void setup(Interface* mbi, const Range& entities) {
+      clear();
+      if (entities.empty()) return;
+      first_handle = entities.front();
+      first_id = mbi->id_from_handle(first_handle);
+      extent = entities.back() - first_handle + 1;
+      if (extent == entities.size()) return;
+
+      offset_to_slot.assign(extent, ID_NONE);
+      slot_to_offset.resize(entities.size());
+      int32_t slot = 0;
+      for (auto entity : entities) {
+        slot_to_offset[slot] = entity - first_handle;
+        offset_to_slot[entity - first_handle] = slot++;
+      }
+    }
 
-  struct AdjacencyData {
-    EntityType entity_type {MBTET}; //!< Type of entity stored in this manager
-    int num_entities {-1}; //!< Number of elements in the manager
-    std::unordered_map<EntityHandle, std::vector<EntityHandle>> adj_info_;
+    inline int32_t slot_from_offset(size_t offset) const {
+      return offset_to_slot.empty() ? offset : offset_to_slot[offset];
+    }
+
+    inline int32_t handle_slot(EntityHandle handle) const { return slot_from_offset(handle - first_handle); }
+
+    inline int32_t slot(MeshID id) const {
+      assert(static_cast<size_t>(id - first_id) < extent);
+      return slot_from_offset(id - first_id);
+    }
+
+    inline size_t offset(int32_t slot) const {
+      return slot_to_offset.empty() ? slot : slot_to_offset[slot];
+    }
+
+    inline EntityHandle handle(int32_t slot) const { return first_handle + offset(slot); }
+
+    inline MeshID id(int32_t slot) const { return first_id + offset(slot); }
 
+    inline bool contains(EntityHandle handle) const {
+      size_t offset = handle - first_handle;
+      return offset < extent && slot_from_offset(offset) != ID_NONE;
+    }
+
+    //! \brief Reassign the slots of the entities
+    //! \param order Current slot of the entity to place in each slot
+    void permute(const std::vector<int32_t>& order) {
+      std::vector<int32_t> offsets(order.size());
+      for (size_t s = 0; s < order.size(); s++) offsets[s] = offset(order[s]);
+      slot_to_offset = std::move(offsets);
+      offset_to_slot.assign(extent, ID_NONE);
+      for (size_t s = 0; s < slot_to_offset.size(); s++) offset_to_slot[slot_to_offset[s]] = s;
+    }
+
+    void clear() {
+      first_handle = 0;
+      first_id = ID_NONE;
+      extent = 0;
+      offset_to_slot.clear();
+      slot_to_offset.clear();
+    }
+
+    //! \brief Whether or not the map covers exactly the given entities
+    bool matches(const Range& entities) const {
+      if (entities.empty()) return extent == 0;
+      size_t size = offset_to_slot.empty() ? extent : slot_to_offset.size();
+      return first_handle == entities.front() && extent == entities.back() - first_handle + 1 &&
+             size == entities.size();
+    }
+
+    void save(SnapshotWriter& writer, const std::string& prefix) const {
+      writer.add_value(prefix + ".first_handle", first_handle);
+      writer.add_value(prefix + ".first_id", first_id);
+      writer.add_value(prefix + ".extent", extent);
+      writer.add(prefix + ".offset_to_slot", offset_to_slot);
+      writer.add(prefix + ".slot_to_offset", slot_to_offset);
+    }
+
+    bool load(const SnapshotReader& reader, const std::string& prefix) {
+      return reader.read_value(prefix + ".first_handle", first_handle) &&
+             reader.read_value(prefix + ".first_id", first_id) &&
+             reader.read_value(prefix + ".extent", extent) &&
+             reader.read(prefix + ".offset_to_slot", offset_to_slot) &&
+             reader.read(prefix + ".slot_to_offset", slot_to_offset);
+    }
+  };
 
+
+  /*! Vertex coordinates, copied into a single interleaved array indexed by
+      dense vertex index */
+  struct VertexData {
     void setup(Interface* mbi) {
       ErrorCode rval;
+      clear();
+      // setup vertices
+      Range verts;
+      rval = mbi->get_entities_by_dimension(0, 0, verts, true);
+      MB_CHK_SET_ERR_CONT(rval, "Failed to get all elements of dimension 0 (vertices)");
+      num_vertices = verts.size();
 
-      // setup element adjacenty data
-      // TODO: support other element types
-      Range elements;
-      rval = mbi->get_entities_by_type(0, entity_type, elements, true);
-      MB_CHK_SET_ERR_CONT(rval, "Failed to get MOAB element adjacencies");
-
-      const auto& ord = ordering[entity_type];
-      // loop over elements and setup adjacency data
-      for (auto element : elements) {
-        adj_info_[element] = std::vector<EntityHandle>(ord.size(), xdg::ID_NONE);
-        // get element connectivity
-        std::vector<EntityHandle> conn;
-        rval = mbi->get_connectivity(&element, 1, conn);
-
-        // use ordering and adjacency call with intersection to populate adjacency entry
-        for (int i = 0; i < ord.size(); i++) {
-          auto o = ord[i];
-          // determine element for this face
-          std::vector<EntityHandle> verts;
-          for (auto idx : o) verts.push_back(conn[idx]);
-          Range adj_ents;
-          rval = mbi->get_adjacencies(verts.data(), verts.size(), 3, true, adj_ents);
-
-          // there be at most two adjacent elements for a given face
-          if (adj_ents.size() > 2) {
-            throw std::runtime_error("Something went wrong gathering adjacent face");
-          }
-
-          // if only one adjacent element, the face is on a boundary
-          if (adj_ents.size() == 1) {
-            // in this case, the returned element must be the current element itself
-            if (adj_ents[0] != element) {
-              throw std::runtime_error("The face is on a boundary, but the returned adjacent element is not the current element");
-            }
-            // if this face is on the boundary, there is no adjacency to add. Move on to the next face
-            continue;
-          }
-
-          if (adj_ents.size() == 2) {
-            if (adj_ents[0] == element) {
-            adj_info_[element][i] = adj_ents[1];
-          } else {
-            adj_info_[element][i] = adj_ents[0];
-          }
-          }
-        }
-      }
+      slots.setup(mbi, verts);
+
+      xyz.resize(3 * verts.size());
+      rval = mbi->get_coords(verts, xyz.data());
+      MB_CHK_SET_ERR_CONT(rval, "Failed to get vertex coordinates");
     }
 
-    EntityHandle get_adjacent_element(const EntityHandle& element, int face_number) {
-      return adj_info_[element][face_number];
+    void clear() {
+      num_vertices = -1;
+      slots.clear();
+      xyz.clear();
     }
 
-    std::vector<EntityHandle> get_element_adjacencies(const EntityHandle& element) {
-      return adj_info_[element];
+    //! \brief Reorder the vertices
+    //! \param order Current index of the vertex to place at each index
+    void permute(const std::vector<int32_t>& order) {
+      std::vector<double> permuted(xyz.size());
+      for (size_t i = 0; i < order.size(); i++) {
+        std::copy_n(xyz.data() + 3 * static_cast<size_t>(order[i]), 3, permuted.data() + 3 * i);
+      }
+      xyz.swap(permuted);
+      slots.permute(order);
     }
 
-    void clear() {
-      num_entities = -1;
-      adj_info_.clear();
+    //! \brief Get the coordinates of a vertex
+    //! \param i The dense index of the vertex
+    inline xdg::Vertex coords(int32_t i) const {
+      const double* c = xyz.data() + 3 * static_cast<size_t>(i);
+      return {c[0], c[1], c[2]};
     }
 
-    // ordering of element faces based on the cannonical ordering descibed here:
-    // Canonical numbering systems for finite‐element codes (http://dx.doi.org/10.1002/cnm.1237)
-    std::unordered_map<EntityType, std::vector<std::vector<int>>> ordering = {
-    {MBTET, {{0, 1, 3}, {1, 2, 3}, {2, 0, 3}, {0, 2, 1}}}
-    };
+    int num_vertices {-1}; //!< Number of vertices in the manager
+    SlotMap slots; //!< Map from vertex handles to dense vertex indices
+    std::vector<double> xyz; //!< Interleaved vertex coordinates
   };
+
+  /*! Connectivity of a single element type, remapped to dense element slots
+      and dense vertex indices */
   struct ConnectivityData {
     EntityType entity_type {MBMAXTYPE}; //!< Type of entity stored in this manager
     int num_entities {-1}; //!< Number of elements in the manager
     int element_stride {-1}; //!< Number of vertices used by each element
-    std::vector<std::pair<EntityHandle, size_t>> first_elements; //!< Pairs of first element and length pairs for contiguous blocks of memory
-    std::vector<const EntityHandle*> vconn; //!< Storage array(s) for the connectivity array
+    SlotMap slots; //!< Map from element handles/IDs to dense slots
+    std::vector<int32_t> connectivity; //!< Dense vertex indices of each element (element_stride per element)
 
-    void setup(Interface * mbi) {
+    void setup(Interface * mbi, const VertexData& vertex_data) {
       ErrorCode rval;
+      clear();
 
       // setup face connectivity data
       Range faces;
@@ -185,117 +276,114 @@ private:
       // only supporting triangle elements for now
       if (!faces.all_of_type(entity_type)) { throw std::runtime_error("Not all 2D elements are triangles"); }
 
+      slots.setup(mbi, faces);
+
       moab::Range::iterator faces_it = faces.begin();
       while(faces_it != faces.end()) {
-        // set connectivity pointer, element stride and the number of elements
+        // get the connectivity pointer, element stride and the number of elements for this block
         EntityHandle* conntmp;
         int n_elements;
         rval = mbi->connect_iterate(faces_it, faces.end(), conntmp, element_stride, n_elements);
         MB_CHK_SET_ERR_CONT(rval, "Failed to get direct access to triangle elements");
 
-        // set const pointers for the connectivity array and add first element/length pair to the set of first elements
-        vconn.push_back(conntmp);
-        first_elements.push_back({*faces_it, n_elements});
+        // copy the connectivity as dense vertex indices
+        if (connectivity.empty()) connectivity.reserve(static_cast<size_t>(num_entities) * element_stride);
+        for (size_t i = 0; i < static_cast<size_t>(n_elements) * element_stride; i++) {
+          connectivity.push_back(vertex_data.slots.handle_slot(conntmp[i]));
+        }
 
         // move iterator forward by the number of triangles in this contiguous memory block
         faces_it += n_elements;
       }
     }
 
-    template <int N>
-    std::array<size_t, N>
-    get_connectivity_indices(const EntityHandle& e) {
-      // determine the correct contiguous block index to use
-      int block_idx = 0;
-      auto fe = first_elements[block_idx];
-      while(true) {
-        if (e - fe.first < fe.second) { break; }
-        block_idx++;
-        fe = first_elements[block_idx];
-      }
+    inline bool contains(EntityHandle e) const { return slots.contains(e); }
 
-      std::array<size_t, N> indices;
-      size_t conn_idx = element_stride * (e - fe.first);
-      for (int i = 0; i < N; i++) {
-        indices[i] = vconn[block_idx][conn_idx + i];
-      }
-      return indices;
+    inline int32_t handle_slot(EntityHandle e) const { return slots.handle_slot(e); }
+
+    inline int32_t slot(MeshID id) const { return slots.slot(id); }
+
+    //! \brief Dense vertex indices of the element in a slot
+    inline const int32_t* connectivity_of(int32_t slot) const {
+      return connectivity.data() + static_cast<size_t>(element_stride) * slot;
     }
 
     void clear() {
       num_entities = -1;
       element_stride = -1;
-      first_elements.clear();
-      vconn.clear();
+      slots.clear();
+      connectivity.clear();
     }
-  };
-
-  struct VertexData {
-    void setup(Interface* mbi) {
-      ErrorCode rval;
-      // setup vertices
-      Range verts;
-      rval = mbi->get_entities_by_dimension(0, 0, verts, true);
-      MB_CHK_SET_ERR_CONT(rval, "Failed to get all elements of dimension 0 (vertices)");
-      num_vertices = verts.size();
 
-      moab::Range::iterator verts_it = verts.begin();
-      while (verts_it != verts.end()) {
-        // set vertex coordinate pointers
-        double* xtmp;
-        double* ytmp;
-        double* ztmp;
-        int n_vertices;
-        rval = mbi->coords_iterate(verts_it, verts.end(), xtmp, ytmp, ztmp, n_vertices);
-        MB_CHK_SET_ERR_CONT(rval, "Failed to get direct access to vertex elements");
-
-        // add the vertex coordinate arrays to their corresponding vector of array pointers
-        tx.push_back(&(*xtmp));
-        ty.push_back(&(*ytmp));
-        tz.push_back(&(*ztmp));
-
-        first_vertices.push_back({*verts_it, n_vertices});
-
-        // move iterator forward by the number of vertices in this contiguous memory block
-        verts_it += n_vertices;
+    //! \brief Reorder the elements
+    //! \param order Current slot of the element to place in each slot
+    void permute(const std::vector<int32_t>& order) {
+      std::vector<int32_t> permuted(connectivity.size());
+      for (size_t s = 0; s < order.size(); s++) {
+        std::copy_n(connectivity_of(order[s]), element_stride, permuted.data() + static_cast<size_t>(element_stride) * s);
       }
+      connectivity.swap(permuted);
+      slots.permute(order);
     }
 
-    void clear() {
-      num_vertices = -1;
-      tx.clear();
-      ty.clear();
-      tz.clear();
-      first_vertices.clear();
+    //! \brief Update the connectivity after the vertices have been reordered
+    //! \param new_index New index of each vertex by its previous index
+    void remap_vertices(const std::vector<int32_t>& new_index) {
+      for (auto& v : connectivity) v = new_index[v];
     }
+  };
 
-    //! \brief Set the coordinates of a vertex based on an index into a contiguous block of memory
-    //! \param i The index of the vertex in the block of memory
-    //! \param v The vertex to set the coordinates of
-    void set_coords(int i, xdg::Vertex& v) {
-      // determine the correct contiguous memory block index to use
-      int idx = 0;
-      auto fe = first_vertices[idx];
-      while(i - fe.first >= fe.second) {
-        fe = first_vertices[++idx];
-      }
-      // determine index into the contiguous block of coordinate memory
-      i -= fe.first;
-      // populate the vertex reference with coordinates
-      v = xdg::Vertex(tx[idx][i], ty[idx][i], tz[idx][i]);
+  /*! Face adjacency of the elements, stored as a flat array of neighbouring
+      element slots (one entry per element face) */
+  struct AdjacencyData {
+    EntityType entity_type {MBTET}; //!< Type of entity stored in this manager
+    int num_entities {-1}; //!< Number of elements in the manager
+    int faces_per_element {0}; //!< Number of faces of each element
+    std::vector<int32_t> neighbors; //!< Slot of the element across each face (ID_NONE on the boundary)
+
+    //! \brief Match the faces of the elements to populate the neighbor table
+    //! \param element_data Connectivity of the elements
+    //! \param n_vertices Number of vertices referenced by the connectivity
+    void setup(const ConnectivityData& element_data, int n_vertices);
+
+    inline int32_t adjacent_slot(int32_t slot, int face_number) const {
+      return neighbors[static_cast<size_t>(faces_per_element) * slot + face_number];
     }
 
-    int num_vertices {-1}; //!< Number of vertices in the manager
-    std::vector<const double*> tx; //!< Storage array(s) for vertex x coordinates
-    std::vector<const double*> ty; //!< Storage array(s) for vertex y coordinates
-    std::vector<const double*> tz; //!< Storage array(s) for vertex z coordinates
-    std::vector<std::pair<EntityHandle, size_t>> first_vertices; //!< Pairs of first vertex and length pairs for contiguous blocks of memory
+    void clear() {
+      num_entities = -1;
+      faces_per_element = 0;
+      neighbors.clear();
+    }
+
+    // ordering of element faces based on the cannonical ordering descibed here:
+    // Canonical numbering systems for finite‐element codes (http://dx.doi.org/10.1002/cnm.1237)
+    std::unordered_map<EntityType, std::vector<std::vector<int>>> ordering = {
+    {MBTET, {{0, 1, 3}, {1, 2, 3}, {2, 0, 3}, {0, 2, 1}}}
+    };
   };
 
+  //! \brief Renumber the vertices, faces and elements along a Morton curve
+  void reorder_slots();
+
+  //! \brief Get the coordinates of the triangle in a dense slot
+  inline std::array<xdg::Vertex, 3> face_coords(int32_t slot) const {
+    const int32_t* conn = face_data_.connectivity_of(slot);
+    return {vertex_data_.coords(conn[0]), vertex_data_.coords(conn[1]), vertex_data_.coords(conn[2])};
+  }
+
+  //! \brief Get the coordinates of the tetrahedron in a dense slot
+  inline std::array<xdg::Vertex, 4> element_coords(int32_t slot) const {
+    const int32_t* conn = element_data_.connectivity_of(slot);
+    return {vertex_data_.coords(conn[0]), vertex_data_.coords(conn[1]),
+            vertex_data_.coords(conn[2]), vertex_data_.coords(conn[3])};
+  }
+
   ConnectivityData face_data_;
   ConnectivityData element_data_;
   AdjacencyData element_adjacency_data_;
   VertexData vertex_data_;
+  bool reorder_ {false}; //!< Whether or not to renumber entities along a space-filling curve
 };
 
 } // namespace xdg
@@ -42,6 +42,37 @@ public:
 
   void init() override;
 
+  /**
+   * @brief Enables the snapshot cache for the direct access data structures.
+   *
+   * When enabled, init() looks in the cache directory for a snapshot of the
+   * vertex coordinates, element connectivity and element adjacency derived
+   * from the loaded file, keyed by a hash of the file contents. If a valid
+   * snapshot exists it is mapped into memory in place of rebuilding these
+   * structures from the MOAB instance. Otherwise the structures are built
+   * and a snapshot is written for subsequent runs. The cache is only used
+   * when a single file has been loaded with load_file.
+   *
+   * @param directory Existing directory holding the snapshot files. An empty
+   * string disables the cache.
+   */
+  void set_snapshot_cache(const std::string& directory) { snapshot_cache_dir_ = directory; }
+
+  /**
+   * @brief Enables renumbering of the direct access data structures along a
+   * space-filling curve.
+   *
+   * When enabled, init() sorts the vertices, triangles and tetrahedra copied
+   * from the MOAB instance by their position along a Morton curve so that
+   * elements visited consecutively by a walk through the mesh are stored
+   * close together in memory. MeshIDs are translated to the new ordering
+   * internally and are unchanged. Snapshots of renumbered meshes are cached
+   * in their own file alongside those of the original ordering.
+   *
+   * @param reorder Whether or not to renumber the mesh
+   */
+  void set_element_reordering(bool reorder) { mdam_->set_reorder(reorder); }
+
   // Geometry
   int num_volumes() const override;
 
@@ -68,6 +99,10 @@ public:
 
   std::vector<Vertex> element_vertices(MeshID element) const override;
 
+  std::array<Vertex, 4> tet_vertices(MeshID element) const override;
+
+  const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override;
+
   std::array<Vertex, 3> face_vertices(MeshID element) const override;
 
   std::pair<std::vector<Vertex>, std::vector<int>> get_surface_mesh(MeshID surface) const override;
@@ -114,6 +149,12 @@ private:
    */
   void graveyard_check();
 
+  /**
+   * @brief Sets up the direct access data structures, from the snapshot
+   * cache if one is enabled and holds a snapshot of the loaded file.
+   */
+  void setup_direct_access();
+
   /**
    * @brief Creates and registers a new surface that consists of the exterior faces of the mesh.
    *
@@ -185,6 +226,10 @@ private:
   moab::Interface* moab_raw_ptr_;
   std::shared_ptr<MBDirectAccess> mdam_;
 
+  // Snapshot cache
+  std::vector<std::string> loaded_files_; //!< Files loaded into the MOAB instance
+  std::string snapshot_cache_dir_; //!< Directory of the snapshot cache (empty if disabled)
+
   // Maps from XDG identifiers to MOAB handles
   std::unordered_map<MeshID, moab::EntityHandle> volume_id_map_;
   std::unordered_map<MeshID, moab::EntityHandle> surface_id_map_;
@@ -213,7 +258,7 @@ struct MOABElementFaceAccessor : public ElementFaceAccessor {
       throw std::runtime_error("MOABElementFaceAccessor requires a MOABMeshManager");
     }
     mesh_manager_ = moab_mesh_manager;
-    element_coordinates_ = mesh_manager_->element_vertices(element);
+    element_coordinates_ = mesh_manager_->tet_vertices(element);
   }
 
   std::array<Vertex, 3> face_vertices(int i) const override {
@@ -226,7 +271,7 @@ struct MOABElementFaceAccessor : public ElementFaceAccessor {
 
   // data members
   const MOABMeshManager* mesh_manager_;
-  std::vector<Vertex> element_coordinates_;
+  std::array<Vertex, 4> element_coordinates_;
   const std::vector<std::vector<int>>& element_ordering_;
 };
 
@@ -2,6 +2,7 @@
 #ifndef _XDG_RAY_H
 #define _XDG_RAY_H
 
+#include <array>
 #include <set>
 #include <vector>
 
@@ -9,6 +10,7 @@
 
 #include "xdg/constants.h"
 #include "xdg/embree_interface.h"
+#include "xdg/exclusion_set.h"
 #include "xdg/primitive_ref.h"
 
 namespace xdg {
@@ -87,8 +89,9 @@ struct RTCSurfaceDualRay : RTCDualRay {
   // Member variables
   RayFireType rf_type {RayFireType::VOLUME}; //!< Enum indicating the type of query this ray is used for
   HitOrientation orientation {HitOrientation::EXITING}; //!< Enum indicating what hits to accept based on orientation
-  const std::vector<MeshID>* exclude_primitives {nullptr}; //! < Set of primitives to exclude from the query
+  const ExclusionSet* exclude_primitives {nullptr}; //! < Set of primitives to exclude from the query
   TreeID volume_tree {ID_NONE}; // volume the ray is being fired in
+  bool volume_filter {false}; //!< Skip surfaces that do not bound volume_tree (set when the scene is shared by all volumes)
 };
 
 struct RTCElementDualRay : RTCDualRay {
@@ -98,6 +101,7 @@ struct RTCElementDualRay : RTCDualRay {
 
   // Member variables
   MeshID element; //!< ID of the element this ray is associated with
+  std::array<double, 4> barycentrics; //!< Barycentric coordinates of the ray origin in the element
 };
 
 /*! Structure extending Embree's RayHit to include a double precision version of the primitive normal */
@@ -128,6 +132,37 @@ struct RTCDualRayHit {
 
 };
 
+//! Largest ray packet size supported by Embree (RTCRayHit16)
+constexpr int MAX_PACKET_SIZE {16};
+
+/*! Query context used for ray packet queries and for queries against native
+    Embree triangle geometry. Embree's ray structures only hold single
+    precision values in these cases, so the double precision ray data and hit
+    information for each lane lives here and is reached from the geometry
+    callbacks through the context pointer Embree passes along with the rays.
+    The ray id of each ray is set to the lane it occupies in this context.
+ */
+struct RTCDualPacketContext {
+  RTCRayQueryContext context; //!< Embree query context (must be the first member)
+
+  // Ray data shared by all lanes in the packet
+  RayFireType rf_type {RayFireType::VOLUME}; //!< Enum indicating the type of query the packet is used for
+  HitOrientation orientation {HitOrientation::EXITING}; //!< Enum indicating what hits to accept based on orientation
+  TreeID volume_tree {ID_NONE}; //!< Volume the rays are being fired in
+  bool volume_filter {false}; //!< Skip surfaces that do not bound volume_tree (set when the scene is shared by all volumes)
+
+  // Per-lane ray data
+  Vec3da dorg[MAX_PACKET_SIZE]; //!< Double precision ray origins
+  Vec3da ddir[MAX_PACKET_SIZE]; //!< Double precision ray directions
+  double dtfar[MAX_PACKET_SIZE]; //!< Double precision ray far distances
+  const ExclusionSet* exclude_primitives[MAX_PACKET_SIZE]; //!< Primitives to exclude for each ray
+
+  // Per-lane hit data
+  const PrimitiveRef* primitive_ref[MAX_PACKET_SIZE]; //!< Primitive reference for each hit
+  MeshID surface[MAX_PACKET_SIZE]; //!< ID of the surface each hit belongs to
+  Vec3da dNg[MAX_PACKET_SIZE]; //!< Double precision primitive normal for each hit
+};
+
 /*! Structure extending Embree's RTCPointQuery to include double precision values */
 struct RTCDPointQuery : RTCPointQuery {
 
@@ -158,6 +193,8 @@ struct RTCDPointQuery : RTCPointQuery {
   double dblx, dbly, dblz; //<! Double precision version of the query location
   const PrimitiveRef* primitive_ref {nullptr}; //!< Pointer to the primitive reference for this hit
   double dradius; //!< Double precision version of the query distance
+  TreeID volume_tree {TREE_NONE}; //!< Volume the query is made in
+  bool volume_filter {false}; //!< Skip surfaces that do not bound volume_tree (set when the scene is shared by all volumes)
 };
 
 } // namespace xdg
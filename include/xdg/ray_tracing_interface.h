@@ -1,12 +1,14 @@
 #ifndef _XDG_RAY_TRACING_INTERFACE_H
 #define _XDG_RAY_TRACING_INTERFACE_H
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <unordered_map>
 
 #include "xdg/constants.h"
 #include "xdg/embree_interface.h"
+#include "xdg/exclusion_set.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/primitive_ref.h"
 #include "xdg/geometry_data.h"
@@ -14,11 +16,56 @@
 namespace xdg
 {
 
+/*! Element containing a point and the barycentric coordinates of the point in
+    that element. The coordinates are ordered as the element's vertices in
+    MeshManager::tet_vertices, which follows the connectivity of the mesh
+    library, and sum to one. Points on or within the containment tolerance of
+    a face may have coordinates slightly outside of [0, 1].
+ */
+struct ElementLocation {
+  MeshID element {ID_NONE}; //!< Element containing the point, ID_NONE if the point is not in the mesh
+  std::array<double, 4> barycentrics {}; //!< Barycentric coordinates of the point
+
+  //! \brief Interpolate a linear field from its values at the element's vertices
+  double interpolate(const std::array<double, 4>& vertex_values) const {
+    return barycentrics[0] * vertex_values[0] + barycentrics[1] * vertex_values[1] +
+           barycentrics[2] * vertex_values[2] + barycentrics[3] * vertex_values[3];
+  }
+};
+
+/*! Interface to the ray tracing backends.
+
+    Tree construction methods modify the ray tracer and must be called from a
+    single thread. Query methods are const. Backends for which
+    concurrent_queries() is true guarantee that queries are reentrant once the
+    trees have been built and init() has been called, so they may be issued
+    from many threads at once. Per-thread query state (excluded primitives
+    and scratch buffers) is held by a QueryContext owned by each thread rather
+    than by the ray tracer. Queries are counted by the statistics counters in
+    xdg/stats.h.
+ */
 class RayTracer {
 public:
+  /*! Per-thread state for ray tracing queries. Queries issued with a context
+      exclude the primitives in its exclusion set, add the primitive they hit
+      to it and use its scratch buffers. A context must not be used by more
+      than one thread at a time.
+   */
+  struct QueryContext {
+    //! \brief Clear the excluded primitives, e.g. at the start of a new track
+    void clear() { exclude_primitives.clear(); }
+
+    ExclusionSet exclude_primitives; //!< Primitives excluded from queries issued with this context
+    std::vector<std::pair<double, MeshID>> hits; //!< Results of the last batched ray fire issued with this context
+  };
+
   // Constructors/Destructors
   virtual ~RayTracer();
 
+  //! \brief Whether or not queries may be issued concurrently from multiple
+  //! threads once the ray tracer has been initialized
+  virtual bool concurrent_queries() const = 0;
+
   // Methods
   virtual void init() = 0;
 
@@ -39,6 +86,22 @@ public:
   virtual std::pair<TreeID, TreeID>
   register_volume(const std::shared_ptr<MeshManager>& mesh_manager, MeshID volume) = 0;
 
+  /**
+  * @brief Registers a set of volumes with the ray tracer.
+  *
+  * Equivalent to calling register_volume for each volume in turn, with trees
+  * numbered in the same order. Backends may override this method to set up
+  * and build the trees of many volumes concurrently. The default
+  * implementation registers the volumes one at a time.
+  *
+  * @param mesh_manager A shared pointer to the MeshManager responsible for
+  * managing the volumes' mesh data.
+  * @param volumes The MeshIDs of the volumes to be registered.
+  * @return The surface and element TreeIDs of each volume.
+  */
+  virtual std::vector<std::pair<TreeID, TreeID>>
+  register_volumes(const std::shared_ptr<MeshManager>& mesh_manager, const std::vector<MeshID>& volumes);
+
   /**
    * @brief Creates a surface tree for a given volume.
    *
@@ -77,14 +140,83 @@ public:
   virtual bool point_in_volume(TreeID tree,
                        const Position& point,
                        const Direction* direction = nullptr,
-                       const std::vector<MeshID>* exclude_primitives = nullptr) const = 0;
+                       const ExclusionSet* exclude_primitives = nullptr) const = 0;
+
+  //! \brief Version of point_in_volume accepting a vector of excluded primitives
+  bool point_in_volume(TreeID tree,
+                       const Position& point,
+                       const Direction* direction,
+                       const std::vector<MeshID>* exclude_primitives) const;
+
+  //! \brief Version of point_in_volume excluding the primitives in a query context
+  bool point_in_volume(TreeID tree,
+                       const Position& point,
+                       const Direction* direction,
+                       QueryContext& context) const;
 
   virtual std::pair<double, MeshID> ray_fire(TreeID tree,
                                      const Position& origin,
                                      const Direction& direction,
                                      const double dist_limit = INFTY,
                                      HitOrientation orientation = HitOrientation::EXITING,
-                                     std::vector<MeshID>* const exclude_primitives = nullptr) = 0;
+                                     ExclusionSet* const exclude_primitives = nullptr) const = 0;
+
+  //! \brief Version of ray_fire accepting a vector of excluded primitives. The
+  //! primitive hit by the ray is appended to the vector.
+  std::pair<double, MeshID> ray_fire(TreeID tree,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     const double dist_limit,
+                                     HitOrientation orientation,
+                                     std::vector<MeshID>* const exclude_primitives) const;
+
+  //! \brief Version of ray_fire excluding the primitives in a query context.
+  //! The primitive hit by the ray is added to the context's exclusion set.
+  std::pair<double, MeshID> ray_fire(TreeID tree,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     QueryContext& context,
+                                     const double dist_limit = INFTY,
+                                     HitOrientation orientation = HitOrientation::EXITING) const;
+
+  /**
+   * @brief Fires a batch of rays against a surface tree.
+   *
+   * Results are identical to calling the single ray version of ray_fire for
+   * each ray in turn. Backends may override this method to trace the rays
+   * together (e.g. as packets) for better throughput. The default
+   * implementation fires the rays one at a time.
+   *
+   * @param tree The TreeID of the surface tree to fire the rays against
+   * @param origins Pointer to n_rays ray origins
+   * @param directions Pointer to n_rays ray directions
+   * @param n_rays Number of rays in the batch
+   * @param hits Pointer to n_rays (distance, surface) pairs that are populated
+   *        with the result for each ray
+   * @param dist_limit Maximum distance for each ray
+   * @param orientation Orientation of the hits to accept
+   * @param exclude_primitives Optional pointer to n_rays exclusion sets, one
+   *        per ray. The primitive hit by each ray is added to its set.
+   */
+  virtual void ray_fire(TreeID tree,
+                        const Position* origins,
+                        const Direction* directions,
+                        size_t n_rays,
+                        std::pair<double, MeshID>* hits,
+                        const double dist_limit = INFTY,
+                        HitOrientation orientation = HitOrientation::EXITING,
+                        ExclusionSet* const exclude_primitives = nullptr) const;
+
+  //! \brief Version of the batched ray_fire storing the results in the hit
+  //! buffer of a query context. The context's exclusion set is not used.
+  //! \return Reference to the context's hit buffer, holding n_rays results
+  const std::vector<std::pair<double, MeshID>>& ray_fire(TreeID tree,
+                                                         const Position* origins,
+                                                         const Direction* directions,
+                                                         size_t n_rays,
+                                                         QueryContext& context,
+                                                         const double dist_limit = INFTY,
+                                                         HitOrientation orientation = HitOrientation::EXITING) const;
 
   /**
    * @brief Finds the element containing a given point using the global element tree.
@@ -107,8 +239,41 @@ public:
    */
   virtual MeshID find_element(TreeID tree, const Position& point) const = 0;
 
+  /**
+   * @brief Finds the element containing a given point using the global element
+   * tree along with the barycentric coordinates of the point in the element.
+   *
+   * @param point The Position to search for
+   * @return The location of the point. Its element is ID_NONE if no element
+   * contains the point.
+   */
+  ElementLocation locate(const Position& point) const { return locate(global_element_tree_, point); }
+
+  /**
+   * @brief Finds the element containing a given point using a specific tree
+   * along with the barycentric coordinates of the point in the element. The
+   * coordinates are those computed by the containment test, so no additional
+   * work is done compared to find_element.
+   */
+  virtual ElementLocation locate(TreeID tree, const Position& point) const = 0;
+
+  /**
+   * @brief Finds the volume containing a given point using the global surface tree.
+   *
+   * A single ray is fired from the point against the global surface tree. The
+   * first surface hit identifies the containing volume: if the ray crosses the
+   * surface along its normal the point lies in the forward sense volume of the
+   * surface, otherwise it lies in the reverse sense volume.
+   *
+   * @param point The Position to search for
+   * @param direction Direction of the ray fired from the point
+   * @return The MeshID of the containing volume, or ID_NONE if the ray does not
+   *         hit any surface or the surface has no volume on that side
+   */
+  virtual MeshID find_volume(const Position& point, const Direction& direction) const = 0;
+
   virtual std::pair<double, MeshID> closest(TreeID tree,
-                                            const Position& origin) = 0;
+                                            const Position& origin) const = 0;
 
   virtual bool occluded(TreeID tree,
                 const Position& origin,
@@ -147,6 +312,8 @@ protected:
   double numerical_precision_ {1e-3};
 };
 
+using QueryContext = RayTracer::QueryContext;
+
 } // namespace xdg
 
 
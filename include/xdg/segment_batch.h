@@ -0,0 +1,41 @@
+#ifndef _XDG_SEGMENT_BATCH_H
+#define _XDG_SEGMENT_BATCH_H
+
+#include <vector>
+
+#include "xdg/constants.h"
+
+namespace xdg
+{
+
+/*! Segments of a batch of tracks in compressed sparse row layout. The
+    segments of track i are elements[offsets[i]] to elements[offsets[i + 1] - 1]
+    with the corresponding entries of lengths. A batch may be reused for many
+    calls to XDG::segments, in which case its buffers are only reallocated
+    when a call produces more segments than any previous call.
+ */
+struct SegmentBatch {
+  std::vector<size_t> offsets; //!< Index of the first segment of each track, followed by the total number of segments
+  std::vector<MeshID> elements; //!< Element of each segment
+  std::vector<double> lengths; //!< Length of each segment
+
+  //! Number of tracks in the batch
+  size_t n_tracks() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+  //! Total number of segments in the batch
+  size_t size() const { return elements.size(); }
+
+  //! Number of segments of a track
+  size_t n_segments(size_t track) const { return offsets[track + 1] - offsets[track]; }
+
+  // Segments of a contiguous range of tracks, filled by a single thread
+  struct Scratch {
+    std::vector<MeshID> elements;
+    std::vector<double> lengths;
+  };
+  std::vector<Scratch> scratch; //!< Per-thread buffers reused between calls
+};
+
+} // namespace xdg
+
+#endif // include guard
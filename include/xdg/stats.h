@@ -0,0 +1,112 @@
+#ifndef _XDG_STATS_H
+#define _XDG_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace xdg {
+
+/*! Ray tracing statistics counters
+
+    Counters are enabled at configuration time with XDG_ENABLE_STATS. When
+    disabled, the XDG_STAT macros used in the query paths compile to nothing
+    and snapshots report zero for every counter.
+
+    Each thread increments its own set of counters without synchronization.
+    Snapshots sum the counters of all threads, including threads that have
+    exited, and may be taken while queries are running.
+ */
+namespace stats {
+
+enum class Counter : int {
+  RAY_FIRE = 0,        //!< Rays fired against a surface tree, including each ray of a batch
+  POINT_IN_VOLUME,     //!< Point containment queries
+  CLOSEST,             //!< Closest primitive queries
+  OCCLUDED,            //!< Occlusion queries
+  FIND_ELEMENT,        //!< Point location queries
+  TRIANGLE_TESTS,      //!< Candidate triangles tested by ray intersection callbacks
+  TRIANGLE_HITS,       //!< Triangle intersections accepted as the nearest hit so far
+  ORIENTATION_CULLS,   //!< Triangle intersections rejected by the hit orientation
+  EXCLUSION_CULLS,     //!< Triangle intersections rejected by the excluded primitives
+  VOLUME_CULLS,        //!< Triangles skipped because they do not bound the queried volume
+  OCCLUSION_TESTS,     //!< Candidate triangles tested by occlusion callbacks
+  ELEMENT_TESTS,       //!< Candidate elements tested for point containment
+  ELEMENT_STEPS,       //!< Element to element steps taken by mesh walks
+  SEGMENT_QUERIES,     //!< Calls to XDG::segments
+  SEGMENTS,            //!< Segments returned by XDG::segments
+  N_COUNTERS
+};
+
+constexpr size_t N_COUNTERS = static_cast<size_t>(Counter::N_COUNTERS);
+
+//! \brief Name of a counter as it appears in JSON output
+const char* counter_name(Counter counter);
+
+//! Values of all counters at a point in time
+struct Snapshot {
+  std::array<uint64_t, N_COUNTERS> values {};
+
+  uint64_t operator[](Counter counter) const { return values[static_cast<size_t>(counter)]; }
+
+  //! \brief Counter values as a JSON object keyed by counter name
+  std::string to_json() const;
+};
+
+//! \brief Whether or not counters were enabled at configuration time
+constexpr bool enabled()
+{
+#ifdef XDG_ENABLE_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+//! \brief Sum of the counters of all threads since the last reset
+Snapshot snapshot();
+
+//! \brief Reset the counters of all threads to zero
+void reset();
+
+namespace detail {
+
+//! Counters owned by a single thread. Only the owning thread writes to the
+//! counters, so increments are a relaxed load and store rather than an atomic
+//! read-modify-write.
+struct ThreadCounters {
+  ThreadCounters();
+  ~ThreadCounters();
+
+  std::array<std::atomic<uint64_t>, N_COUNTERS> values {};
+};
+
+//! \brief Counters of the calling thread
+inline ThreadCounters& thread_counters()
+{
+  thread_local ThreadCounters counters;
+  return counters;
+}
+
+inline void increment(Counter counter, uint64_t n = 1)
+{
+  auto& value = thread_counters().values[static_cast<size_t>(counter)];
+  value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+} // namespace stats
+
+} // namespace xdg
+
+#ifdef XDG_ENABLE_STATS
+#define XDG_STAT(counter) ::xdg::stats::detail::increment(::xdg::stats::Counter::counter)
+#define XDG_STAT_N(counter, n) ::xdg::stats::detail::increment(::xdg::stats::Counter::counter, (n))
+#else
+#define XDG_STAT(counter) ((void)0)
+#define XDG_STAT_N(counter, n) ((void)0)
+#endif
+
+#endif // include guard
@@ -0,0 +1,80 @@
+#ifndef _XDG_TALLY_H
+#define _XDG_TALLY_H
+
+#include <memory>
+#include <vector>
+
+#include "xdg/constants.h"
+#include "xdg/dense_map.h"
+#include "xdg/segment_batch.h"
+#include "xdg/vec3da.h"
+
+namespace xdg {
+
+class XDG; // Forward declaration
+
+/*! Track-length estimator tally over the volume elements of a model
+
+    Each track scores its weight times the length of each of its segments into
+    the bin of the segment's element and the track's energy group. Results are
+    held in a dense array ordered by element, then group.
+
+    Tracks are segmented and scored in parallel. Each thread scores into its
+    own copy of the bins, which are summed into the results at the end of every
+    batch, so no atomic operations are needed on shared bins. These per-thread
+    copies are kept between batches and use n_threads * n_bins doubles.
+ */
+class MeshTally {
+public:
+  //! \param xdg Model with its ray tracer prepared
+  //! \param n_groups Number of energy groups scored for each element
+  MeshTally(std::shared_ptr<XDG> xdg, int n_groups = 1);
+
+  //! \brief Score a batch of tracks
+  //! \param starts Starting point of each track
+  //! \param ends Ending point of each track
+  //! \param weights Weight of each track
+  //! \param groups Energy group of each track, may be nullptr if there is a single group
+  //! \param n_tracks Number of tracks
+  void score(const Position* starts,
+             const Position* ends,
+             const double* weights,
+             const int* groups,
+             size_t n_tracks);
+
+  //! \brief Zero all results
+  void reset();
+
+  // Accessors
+  int n_groups() const { return n_groups_; }
+  size_t n_bins() const { return results_.size(); }
+
+  //! \brief Elements of the tally in the order of the results
+  const std::vector<MeshID>& elements() const { return elements_; }
+
+  //! \brief Sum of the weight times track length of all segments in each bin
+  const std::vector<double>& results() const { return results_; }
+
+  //! \brief Sum of the weight times track length in an element for a group
+  double result(MeshID element, int group = 0) const;
+
+  //! \brief Segments of the last batch of tracks scored
+  const SegmentBatch& segments() const { return batch_; }
+
+  //! \brief Track-length estimate of the flux in an element for a group,
+  //! i.e. the result divided by the volume of the element
+  double flux(MeshID element, int group = 0) const;
+
+private:
+  std::shared_ptr<XDG> xdg_;
+  int n_groups_;
+  std::vector<MeshID> elements_; //!< Element of each set of bins
+  DenseMap<MeshID, size_t> element_index_; //!< Index of each element in elements_
+  std::vector<double> results_; //!< Accumulated results of all batches
+  std::vector<std::vector<double>> thread_results_; //!< Per-thread bins of the current batch
+  SegmentBatch batch_; //!< Segments of the current batch
+};
+
+} // namespace xdg
+
+#endif // include guard
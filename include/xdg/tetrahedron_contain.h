@@ -1,11 +1,48 @@
 #ifndef XDG_TETRAHEDRON_INTERSECT_H
 #define XDG_TETRAHEDRON_INTERSECT_H
 
+#include <array>
 
 #include "xdg/vec3da.h"
 
 namespace xdg
 {
+
+//! Barycentric transform of a tetrahedron: the inverse of the matrix of edge
+//! vectors [v1 - v0, v2 - v0, v3 - v0] in column-major order, followed by v0
+using TetTransform = std::array<double, 12>;
+
+/**
+ * @brief Computes the barycentric transform of a tetrahedron.
+ *
+ * The transform can be stored and reused for containment tests against the
+ * same tetrahedron, which then cost a single matrix-vector product.
+ *
+ * @return The barycentric transform of the tetrahedron
+ */
+TetTransform tet_barycentric_transform(const Position& v0,
+                                       const Position& v1,
+                                       const Position& v2,
+                                       const Position& v3);
+
+/**
+ * @brief Determines if a point is inside or on the boundary of a tetrahedron
+ * from its precomputed barycentric transform. Gives the same result as
+ * plucker_tet_containment_test for the tetrahedron's vertices.
+ *
+ * @param point The position of the point to test.
+ * @param transform Pointer to the 12 values of the tetrahedron's transform
+ * (see tet_barycentric_transform).
+ * @param barycentrics Optional pointer to 4 values set to the barycentric
+ * coordinates of the point with respect to v0, v1, v2 and v3 if the point is
+ * inside the tetrahedron.
+ * @return `true` if the point is inside or on the boundary of the tetrahedron,
+ * `false` otherwise.
+ */
+bool tet_transform_containment_test(const Position& point,
+                                    const double* transform,
+                                    double* barycentrics = nullptr);
+
 /**
  * @brief Determines if a point is inside or on the boundary of a tetrahedron
  * using Plücker coordinates.
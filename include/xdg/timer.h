@@ -2,6 +2,9 @@
 #define XDG_TIMER_H
 
 #include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
 
 namespace xdg {
 
@@ -40,12 +43,87 @@ private:
   double elapsed_ {0.0};                 //!< elapsed time in [s]
 };
 
+//==============================================================================
+//! Times a named scope and adds the result to the global timer registry.
+//! Scopes opened while another is running on the same thread are recorded as
+//! its children, e.g. "init/direct_access/adjacency".
+//==============================================================================
+
+class ScopedTimer {
+public:
+  explicit ScopedTimer(const std::string& name);
+  ~ScopedTimer();
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+protected:
+  //! Constructor for scopes that are only timed if active is true
+  ScopedTimer(const char* name, bool active);
+
+  size_t calls_ {1}; //!< Calls represented by this measurement
+
+private:
+  bool active_;
+  Timer timer_;
+};
+
+//==============================================================================
+//! Times one in every N calls of a scope, where N is the interval set with
+//! set_timer_sample_interval. Sampling is disabled by default, in which case
+//! the cost of a sampled scope is a counter increment. Use XDG_SAMPLED_TIMER
+//! rather than constructing these directly.
+//==============================================================================
+
+class SampledScopedTimer : public ScopedTimer {
+public:
+  //! \param name Name of the scope
+  //! \param counter Per-thread call counter of the scope
+  SampledScopedTimer(const char* name, unsigned& counter);
+};
+
+//! Accumulated time of a named scope
+struct TimerRecord {
+  std::vector<std::string> path; //!< Names of the enclosing scopes and this scope
+  size_t calls {0}; //!< Number of calls, estimated for sampled scopes
+  size_t samples {0}; //!< Number of calls that were timed
+  double elapsed {0.0}; //!< Time of the timed calls [s]
+
+  //! Name of the scope including its parents, separated by '/'
+  std::string name() const;
+
+  //! Total time of all calls, estimated from the samples for sampled scopes [s]
+  double total() const { return samples > 0 ? elapsed * calls / samples : 0.0; }
+};
+
 //==============================================================================
 // Non-member functions
 //==============================================================================
 
+//! Set the interval at which sampled scopes are timed (0 disables sampling)
+void set_timer_sample_interval(unsigned interval);
+
+//! Interval at which sampled scopes are timed
+unsigned timer_sample_interval();
+
+//! Records of all timed scopes, with children following their parent
+std::vector<TimerRecord> timer_records();
+
+//! Print a table of all timed scopes
+void print_timer_summary(std::ostream& out = std::cout);
+
+//! Clear the records of all timed scopes
 void reset_timers();
 
 } // namespace xdg
 
+#define XDG_TIMER_CONCAT_(a, b) a##b
+#define XDG_TIMER_CONCAT(a, b) XDG_TIMER_CONCAT_(a, b)
+
+//! Time one in every N calls of the enclosing scope under the given name
+#define XDG_SAMPLED_TIMER(name)                                                    \
+  static thread_local unsigned XDG_TIMER_CONCAT(xdg_sample_count_, __LINE__) = 0;  \
+  ::xdg::SampledScopedTimer XDG_TIMER_CONCAT(xdg_sampled_timer_, __LINE__)(        \
+    name, XDG_TIMER_CONCAT(xdg_sample_count_, __LINE__))
+
 #endif // XDG_TIMER_H
@@ -0,0 +1,139 @@
+#ifndef _XDG_SNAPSHOT_H
+#define _XDG_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace xdg {
+
+/*! Versioned binary snapshot of data derived from a mesh file.
+
+    A snapshot holds a sequence of named sections of plain data. Each snapshot
+    carries a key (a hash of the mesh file it was derived from) and the
+    snapshot format version. A snapshot is only read back if both match, so a
+    stale or foreign snapshot is ignored rather than misread.
+
+    File layout (all values in native byte order):
+      header   : magic (8 bytes), version (uint32), number of sections (uint32), key (uint64)
+      sections : name (32 bytes, null padded), size in bytes (uint64), data
+                 padded to a multiple of 8 bytes
+ */
+namespace snapshot {
+
+//! Bumped whenever the layout of a snapshot or of any section changes
+constexpr uint32_t VERSION {1};
+
+//! Maximum length of a section name, including the null terminator
+constexpr size_t NAME_SIZE {32};
+
+//! \brief Hash of the contents of a file (64-bit FNV-1a)
+//! \throws std::runtime_error if the file cannot be read
+uint64_t hash_file(const std::string& filepath);
+
+//! \brief Path of the snapshot for a key within a cache directory. Snapshots
+//! of the same file built with different settings are told apart by variant.
+std::string cache_path(const std::string& directory, uint64_t key, const std::string& variant = "");
+
+} // namespace snapshot
+
+/*! Collects sections in memory and writes them out as a snapshot file */
+class SnapshotWriter {
+public:
+  SnapshotWriter(uint64_t key) : key_(key) {}
+
+  //! \brief Add a section holding a copy of a vector's contents
+  template<typename T>
+  void add(const std::string& name, const std::vector<T>& data) {
+    add(name, data.data(), data.size() * sizeof(T));
+  }
+
+  //! \brief Add a section holding a single value
+  template<typename T>
+  void add_value(const std::string& name, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot values must be trivially copyable");
+    add(name, &value, sizeof(T));
+  }
+
+  //! \brief Add a section holding a copy of raw data
+  void add(const std::string& name, const void* data, size_t n_bytes);
+
+  //! \brief Write the snapshot. The file is written to a temporary path and
+  //! then renamed so that concurrent readers never see a partial snapshot.
+  //! \return Whether or not the snapshot was written
+  bool write(const std::string& filepath) const;
+
+private:
+  struct Section {
+    std::string name;
+    std::vector<char> data;
+  };
+
+  uint64_t key_;
+  std::vector<Section> sections_;
+};
+
+/*! Read-only view of a snapshot file mapped into memory */
+class SnapshotReader {
+public:
+  SnapshotReader() = default;
+  ~SnapshotReader();
+
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  //! \brief Map a snapshot file
+  //! \return Whether or not the file exists and is a valid snapshot for the key
+  bool open(const std::string& filepath, uint64_t key);
+
+  //! \brief Unmap the snapshot file
+  void close();
+
+  //! \brief Whether or not a snapshot is mapped
+  bool is_open() const { return data_ != nullptr; }
+
+  //! \brief Whether or not the snapshot has a section
+  bool contains(const std::string& name) const;
+
+  //! \brief Copy a section into a vector
+  //! \return Whether or not the section exists and holds a whole number of values
+  template<typename T>
+  bool read(const std::string& name, std::vector<T>& data) const {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot values must be trivially copyable");
+    const Section* s = find(name);
+    if (!s || s->size % sizeof(T) != 0) return false;
+    data.resize(s->size / sizeof(T));
+    copy(*s, data.data());
+    return true;
+  }
+
+  //! \brief Copy a single value section
+  //! \return Whether or not the section exists and has the size of the value
+  template<typename T>
+  bool read_value(const std::string& name, T& value) const {
+    static_assert(std::is_trivially_copyable<T>::value, "Snapshot values must be trivially copyable");
+    const Section* s = find(name);
+    if (!s || s->size != sizeof(T)) return false;
+    copy(*s, &value);
+    return true;
+  }
+
+private:
+  struct Section {
+    std::string name;
+    const char* data;
+    uint64_t size;
+  };
+
+  const Section* find(const std::string& name) const;
+  static void copy(const Section& section, void* destination);
+
+  void* data_ {nullptr}; //!< Start of the mapped file
+  size_t size_ {0}; //!< Size of the mapped file in bytes
+  std::vector<Section> sections_;
+};
+
+} // namespace xdg
+
+#endif // include guard
@@ -1,11 +1,15 @@
 #ifndef _XDG_INTERFACE_H
 #define _XDG_INTERFACE_H
 
+#include <array>
 #include <memory>
 #include <unordered_map>
 
+#include "xdg/dense_map.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/ray_tracing_interface.h"
+#include "xdg/segment_batch.h"
+#include "xdg/stats.h"
 
 
 namespace xdg {
@@ -35,6 +39,27 @@ MeshID find_element(const Position& point) const;
 MeshID find_element(MeshID volume,
                     const Position& point) const;
 
+//! Returns the element containing a point along with the barycentric
+//! coordinates of the point in that element, e.g. for interpolating nodal fields
+//! @param point The point to locate
+//! @return The location of the point. Its element is ID_NONE if the point is
+//! not inside the mesh.
+ElementLocation locate(const Position& point) const;
+
+//! Returns the element of a volume containing a point along with the
+//! barycentric coordinates of the point in that element
+ElementLocation locate(MeshID volume,
+                       const Position& point) const;
+
+//! Locates a batch of points, in parallel if the ray tracer supports
+//! concurrent queries
+//! @param points The points to locate
+//! @param n_points The number of points
+//! @param locations Output for the location of each point (n_points entries)
+void locate(const Position* points,
+            size_t n_points,
+            ElementLocation* locations) const;
+
 //! Returns a vector of segments between the start and end points on the mesh
 //! @param start The starting point of the query
 //! @param end The ending point of the query
@@ -53,6 +78,18 @@ segments(MeshID volume,
          const Position& start,
          const Position& end) const;
 
+//! Computes the segments of a batch of tracks in parallel
+//! @param starts The starting point of each track
+//! @param ends The ending point of each track
+//! @param n_tracks The number of tracks
+//! @param batch Output for the segments of all tracks. Its buffers are reused
+//! between calls, so no memory is allocated once a batch has grown to size.
+void
+segments(const Position* starts,
+         const Position* ends,
+         size_t n_tracks,
+         SegmentBatch& batch) const;
+
 //! Returns the next element along a line
 //! @param current_element The current element
 //! @param r The starting point of the line
@@ -63,17 +100,63 @@ next_element(MeshID current_element,
                   const Position& r,
                   const Direction& u) const;
 
+//! Returns the element of the volume mesh adjacent to a surface face
+//! @param face The surface face
+//! @param sense The side of the face, given by the sense of its surface with
+//! respect to the volume containing the element
+//! @return The element ID, or ID_NONE if no element shares the face
+MeshID face_element(MeshID face, Sense sense) const;
+
 bool point_in_volume(MeshID volume,
       const Position point,
       const Direction* direction = nullptr,
-      const std::vector<MeshID>* exclude_primitives = nullptr) const;
+      const ExclusionSet* exclude_primitives = nullptr) const;
+
+bool point_in_volume(MeshID volume,
+      const Position point,
+      const Direction* direction,
+      const std::vector<MeshID>* exclude_primitives) const;
+
+//! Point containment query excluding the primitives in a per-thread query context
+bool point_in_volume(MeshID volume,
+      const Position point,
+      const Direction* direction,
+      QueryContext& context) const;
 
 std::pair<double, MeshID> ray_fire(MeshID volume,
                                    const Position& origin,
                                    const Direction& direction,
                                    const double dist_limit = INFTY,
                                    HitOrientation orientation = HitOrientation::EXITING,
-                                   std::vector<MeshID>* const exclude_primitives = nullptr) const;
+                                   ExclusionSet* const exclude_primitives = nullptr) const;
+
+std::pair<double, MeshID> ray_fire(MeshID volume,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   const double dist_limit,
+                                   HitOrientation orientation,
+                                   std::vector<MeshID>* const exclude_primitives) const;
+
+//! Fire a ray excluding the primitives in a per-thread query context. The
+//! primitive hit by the ray is added to the context's exclusion set.
+std::pair<double, MeshID> ray_fire(MeshID volume,
+                                   const Position& origin,
+                                   const Direction& direction,
+                                   QueryContext& context,
+                                   const double dist_limit = INFTY,
+                                   HitOrientation orientation = HitOrientation::EXITING) const;
+
+//! Fire a batch of rays from within a volume. Each entry of hits is set to the
+//! (distance, surface) pair for the corresponding ray. If provided,
+//! exclude_primitives must point to one exclusion set per ray.
+void ray_fire(MeshID volume,
+              const Position* origins,
+              const Direction* directions,
+              size_t n_rays,
+              std::pair<double, MeshID>* hits,
+              const double dist_limit = INFTY,
+              HitOrientation orientation = HitOrientation::EXITING,
+              ExclusionSet* const exclude_primitives = nullptr) const;
 
 std::pair<double, MeshID> closest(MeshID volume,
                                   const Position& origin) const;
@@ -88,9 +171,24 @@ bool occluded(MeshID volume,
 
 Direction surface_normal(MeshID surface,
                          Position point,
-                         const std::vector<MeshID>* exclude_primitives = nullptr) const;
+                         const ExclusionSet* exclude_primitives = nullptr) const;
+
+Direction surface_normal(MeshID surface,
+                         Position point,
+                         const std::vector<MeshID>* exclude_primitives) const;
 
 
+  // Statistics
+  //! Sum of the ray tracing counters of all threads since the last reset. All
+  //! counters are zero unless XDG is configured with XDG_ENABLE_STATS.
+  stats::Snapshot statistics() const { return stats::snapshot(); }
+
+  //! Reset the ray tracing counters of all threads
+  void reset_statistics() const { stats::reset(); }
+
+  //! Write the current ray tracing counters to a file as JSON
+  void write_statistics(const std::string& filename) const;
+
   // Geometric Measurements
   double measure_volume(MeshID volume) const;
   double measure_surface_area(MeshID surface) const;
@@ -115,6 +213,21 @@ Direction surface_normal(MeshID surface,
   }
 // Private methods
 private:
+  //! Walk the elements along a track, calling visit(element, length) for each
+  //! segment. Returns false if the track could not be followed through the mesh.
+  template<typename Visitor>
+  bool walk_track(const Position& start, const Position& end, Visitor&& visit) const;
+
+  //! Find the elements adjacent to the faces of the surfaces bounding each
+  //! meshed volume. Faces are matched to element faces by their vertices.
+  void build_face_element_map();
+
+  //! Element a track enters when leaving an element through a face on a
+  //! surface. The exit face is found from a point r in the element along
+  //! direction u. Returns ID_NONE on the boundary of the model and a negative
+  //! value other than ID_NONE if the element must be found by point location.
+  MeshID element_crossing(MeshID element, const Position& r, const Direction& u) const;
+
   double _triangle_volume_contribution(const PrimitiveRef& triangle) const;
   double _triangle_area_contribution(const PrimitiveRef& triangle) const;
 
@@ -122,9 +235,11 @@ private:
   std::shared_ptr<RayTracer> ray_tracing_interface_ {nullptr};
   std::shared_ptr<MeshManager> mesh_manager_ {nullptr};
 
-  std::unordered_map<MeshID, TreeID> volume_to_surface_tree_map_;  //<! Map from mesh volume to raytracing tree
-  std::unordered_map<MeshID, TreeID> surface_to_tree_map_; //<! Map from mesh surface to embree scnee
-  std::unordered_map<MeshID, TreeID> volume_to_point_location_tree_map_; //<! Map from mesh volume to embree point location tree
+  DenseMap<MeshID, TreeID> volume_to_surface_tree_map_;  //<! Map from mesh volume to raytracing tree
+  DenseMap<MeshID, TreeID> surface_to_tree_map_; //<! Map from mesh surface to embree scnee
+  DenseMap<MeshID, TreeID> volume_to_point_location_tree_map_; //<! Map from mesh volume to embree point location tree
+  DenseMap<MeshID, std::array<MeshID, 2>> face_element_map_; //<! Map from surface face to the element on its forward and reverse sides
+  DenseMap<MeshID, std::array<MeshID, 4>> element_crossing_map_; //<! Map from elements on a surface to the element across each of their faces
   TreeID global_scene_; // TODO: does this need to be in the RayTacer class or the XDG? class
 };
 
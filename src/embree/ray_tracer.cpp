@@ -2,7 +2,9 @@
 #include "xdg/error.h"
 #include "xdg/geometry_data.h"
 #include "xdg/ray.h"
+#include "xdg/stats.h"
 #include "xdg/tetrahedron_contain.h"
+#include "xdg/timer.h"
 
 
 namespace xdg {
@@ -16,6 +18,11 @@ EmbreeRayTracer::EmbreeRayTracer()
 {
   device_ = rtcNewDevice(nullptr);
   rtcSetDeviceErrorFunction(device_, (RTCErrorFunction)error, nullptr);
+  rtcSetDeviceMemoryMonitorFunction(device_, memory_monitor, this);
+
+  for (auto tree_class : {TreeClass::VOLUME_SURFACE, TreeClass::GLOBAL_SURFACE, TreeClass::ELEMENT}) {
+    set_tree_build_settings(tree_class, XDGConfig::config().tree_build_settings(tree_class));
+  }
 }
 
 EmbreeRayTracer::~EmbreeRayTracer()
@@ -28,10 +35,33 @@ void EmbreeRayTracer::init()
 
 }
 
-RTCScene EmbreeRayTracer::create_embree_scene() {
+bool EmbreeRayTracer::memory_monitor(void* ray_tracer, ssize_t bytes, bool post)
+{
+  // allocations are positive and deallocations negative
+  static_cast<EmbreeRayTracer*>(ray_tracer)->device_bytes_ += bytes;
+  return true;
+}
+
+RTCScene EmbreeRayTracer::create_embree_scene(TreeClass tree_class) {
+  const auto& settings = tree_build_settings(tree_class);
   RTCScene rtcscene = rtcNewScene(device_);
-  rtcSetSceneFlags(rtcscene, RTC_SCENE_FLAG_ROBUST);
-  rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_HIGH);
+
+  int flags = RTC_SCENE_FLAG_NONE;
+  if (settings.robust) flags |= RTC_SCENE_FLAG_ROBUST;
+  if (settings.compact) flags |= RTC_SCENE_FLAG_COMPACT;
+  rtcSetSceneFlags(rtcscene, static_cast<RTCSceneFlags>(flags));
+
+  switch (settings.quality) {
+    case BuildQuality::LOW:
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_LOW);
+      break;
+    case BuildQuality::MEDIUM:
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_MEDIUM);
+      break;
+    case BuildQuality::HIGH:
+      rtcSetSceneBuildQuality(rtcscene, RTC_BUILD_QUALITY_HIGH);
+      break;
+  }
   return rtcscene;
 }
 
@@ -46,103 +76,237 @@ EmbreeRayTracer::register_volume(const std::shared_ptr<MeshManager>& mesh_manage
   return {faces_tree, element_tree};
 }
 
+std::vector<std::pair<SurfaceTreeID, ElementTreeID>>
+EmbreeRayTracer::register_volumes(const std::shared_ptr<MeshManager>& mesh_manager,
+                                  const std::vector<MeshID>& volumes)
+{
+  std::vector<std::pair<SurfaceTreeID, ElementTreeID>> trees(volumes.size());
+
+  // surface scenes are set up and built together
+  std::vector<RTCScene> surface_scenes;
+  std::vector<SurfaceTreeID> surface_trees;
+  {
+    ScopedTimer timer("surface_geometry");
+    surface_trees = create_surface_trees(mesh_manager, volumes, surface_scenes);
+  }
+
+  // element scenes are set up in volume order so that trees are numbered as
+  // if the volumes were registered one at a time
+  std::vector<RTCScene> element_scenes;
+  {
+    ScopedTimer timer("element_geometry");
+    for (size_t i = 0; i < volumes.size(); i++) {
+      RTCScene element_scene;
+      trees[i] = {surface_trees[i], setup_element_tree(mesh_manager, volumes[i], element_scene)};
+      if (element_scene) element_scenes.push_back(element_scene);
+    }
+  }
+
+  {
+    ScopedTimer timer("surface_trees");
+    commit_scenes(surface_scenes, surface_tree_class());
+  }
+  ScopedTimer timer("element_trees");
+  commit_scenes(element_scenes, TreeClass::ELEMENT);
+  return trees;
+}
+
 SurfaceTreeID
 EmbreeRayTracer::create_surface_tree(const std::shared_ptr<MeshManager>& mesh_manager,
                            MeshID volume_id)
 {
-  SurfaceTreeID tree = next_surface_tree_id();
-  surface_trees_.push_back(tree);
-  auto volume_scene = this->create_embree_scene();
-  auto volume_surfaces = mesh_manager->get_volume_surfaces(volume_id);
-
-  // allocate total storage for all the primtives in a volume
-  size_t vol_face_count = 0;
-  for (auto& surface_id : volume_surfaces) {
-    if (!surface_to_geometry_map_.count(surface_id)) {
-      vol_face_count += mesh_manager->get_surface_faces(surface_id).size();
+  std::vector<RTCScene> scenes;
+  SurfaceTreeID tree = create_surface_trees(mesh_manager, {volume_id}, scenes)[0];
+  commit_scenes(scenes, surface_tree_class());
+  return tree;
+}
+
+std::vector<SurfaceTreeID>
+EmbreeRayTracer::create_surface_trees(const std::shared_ptr<MeshManager>& mesh_manager,
+                                      const std::vector<MeshID>& volumes,
+                                      std::vector<RTCScene>& scenes)
+{
+  // Surfaces seen for the first time. Their primitive references are stored
+  // together in a single block.
+  struct NewSurface {
+    MeshID surface;
+    size_t storage_offset;
+    std::vector<MeshID> faces;
+    RTCGeometry geometry;
+    std::shared_ptr<SurfaceUserData> surface_data;
+  };
+  std::vector<NewSurface> new_surfaces;
+  std::unordered_map<MeshID, size_t> new_surface_index;
+
+  // Without per-volume trees the surfaces of every volume are held by the
+  // global surface scene, which each volume tree refers to
+  if (!volume_trees_ && global_surface_scene_ == nullptr) {
+    global_surface_scene_ = create_embree_scene(TreeClass::GLOBAL_SURFACE);
+  }
+
+  // enumerate the surfaces of every volume and allocate the primitive
+  // reference storage
+  std::vector<SurfaceTreeID> trees;
+  std::vector<RTCScene> volume_scenes;
+  std::vector<std::vector<MeshID>> volume_surfaces(volumes.size());
+  size_t face_count = 0;
+  for (size_t i = 0; i < volumes.size(); i++) {
+    SurfaceTreeID tree = next_surface_tree_id();
+    surface_trees_.push_back(tree);
+    trees.push_back(tree);
+    RTCScene volume_scene = volume_trees_ ? this->create_embree_scene(TreeClass::VOLUME_SURFACE) : global_surface_scene_;
+    volume_scenes.push_back(volume_scene);
+    if (volume_trees_) scenes.push_back(volume_scene);
+    surface_volume_tree_to_scene_map_[tree] = volume_scene;
+
+    volume_surfaces[i] = mesh_manager->get_volume_surfaces(volumes[i]);
+    for (auto surface : volume_surfaces[i]) {
+      if (surface_to_geometry_map_.count(surface) || new_surface_index.count(surface)) continue;
+      new_surface_index[surface] = new_surfaces.size();
+      auto faces = mesh_manager->get_surface_faces(surface);
+      size_t n_faces = faces.size();
+      new_surfaces.push_back({surface, face_count, std::move(faces), nullptr, nullptr});
+      face_count += n_faces;
     }
   }
+  if (!volume_trees_) scenes.push_back(global_surface_scene_);
+  PrimitiveRef* storage = nullptr;
+  if (face_count > 0) {
+    primitive_ref_storage_.emplace_back(face_count);
+    storage = primitive_ref_storage_.back().data();
+  }
+
+  // build the geometries of the new surfaces concurrently
+  int64_t device_bytes = device_bytes_;
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < new_surfaces.size(); i++) {
+    auto& new_surface = new_surfaces[i];
+    PrimitiveRef* primitive_refs = storage + new_surface.storage_offset;
+    std::tie(new_surface.geometry, new_surface.surface_data) =
+      create_surface_geometry(mesh_manager, new_surface.surface, new_surface.faces, primitive_refs);
+  }
+  geometry_bytes_ += device_bytes_ - device_bytes;
 
-  this->primitive_ref_storage_[volume_scene].resize(vol_face_count);
-  auto& triangle_storage = this->primitive_ref_storage_[volume_scene];
-  PrimitiveRef* tri_ref_ptr = triangle_storage.data();
-  auto bump = bounding_box_bump(mesh_manager, volume_id);
-  int storage_offset = 0;
+  for (const auto& new_surface : new_surfaces) {
+    surface_to_geometry_map_[new_surface.surface] = new_surface.geometry;
+    surface_user_data_map_[new_surface.geometry] = new_surface.surface_data;
+    // surfaces are attached to the shared scene only once
+    if (!volume_trees_) rtcAttachGeometry(global_surface_scene_, new_surface.geometry);
+  }
 
-  for (auto& surface : volume_surfaces) {
-    RTCGeometry surface_geometry;
-    std::shared_ptr<SurfaceUserData> surface_data;
+  // attach the surfaces to each volume scene
+  for (size_t i = 0; i < volumes.size(); i++) {
+    MeshID volume_id = volumes[i];
+    SurfaceTreeID tree = trees[i];
+    auto bump = bounding_box_bump(mesh_manager, volume_id);
+
+    for (auto surface : volume_surfaces[i]) {
+      RTCGeometry surface_geometry = surface_to_geometry_map_.at(surface);
+      auto& surface_data = surface_user_data_map_.at(surface_geometry);
+      if (volume_trees_) rtcAttachGeometry(volume_scenes[i], surface_geometry);
 
-    // Check if this surface already has cached geometry information
-    if (!surface_to_geometry_map_.count(surface))
-    { // First visit: Create new RTCGeometry and user data
-      std::tie(surface_geometry, surface_data) = register_surface(mesh_manager, surface, volume_scene, storage_offset);
-      surface_data->box_bump = bump; // set the box dilation value
-    }
-    else { // Second Visit: Recover existing RTCGeometry and user data
-      surface_geometry = surface_to_geometry_map_[surface];
-      surface_data = surface_user_data_map_.at(surface_geometry);
       // set the box dilation value to the larger of the two box bump values for
       // the volumes on either side of this surface
-      surface_data->box_bump = std::max(surface_data->box_bump, bump);
-      rtcAttachGeometry(volume_scene, surface_geometry);
+      if (bump > surface_data->box_bump) {
+        surface_data->box_bump = bump;
+        // the bounds of a surface already built into the shared scene must be updated
+        if (!volume_trees_ && !new_surface_index.count(surface)) rtcCommitGeometry(surface_geometry);
+      }
+
+      // Set the correct parent TreeID
+      auto [forward_parent, reverse_parent] = mesh_manager->surface_senses(surface);
+      if (volume_id == forward_parent) {
+        surface_data->forward_vol = forward_parent;
+        surface_data->forward_tree = tree;
+      } else if (volume_id == reverse_parent) {
+        surface_data->reverse_vol = reverse_parent;
+        surface_data->reverse_tree = tree;
+      } else {
+        fatal_error("Volume {} is not a parent of surface {}", volume_id, surface);
+      }
     }
+  }
 
-    // Set the correct parent TreeID
-    auto [forward_parent, reverse_parent] = mesh_manager->surface_senses(surface);
-    if (volume_id == forward_parent) {
-      surface_data->forward_vol = tree;
-    } else if (volume_id == reverse_parent) {
-      surface_data->reverse_vol = tree;
-    } else {
-      fatal_error("Volume {} is not a parent of surface {}", volume_id, surface);
-    }
+  return trees;
+}
+
+void EmbreeRayTracer::commit_scenes(const std::vector<RTCScene>& scenes, TreeClass tree_class)
+{
+  int64_t device_bytes = device_bytes_;
+
+  // each scene is built independently, so the builds can run concurrently
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i = 0; i < scenes.size(); i++) {
+    rtcCommitScene(scenes[i]);
   }
 
-  rtcCommitScene(volume_scene);
-  surface_volume_tree_to_scene_map_[tree] = volume_scene;
-  return tree;
+  tree_bytes_.at(static_cast<size_t>(tree_class)) += device_bytes_ - device_bytes;
 }
 
 std::pair<RTCGeometry, std::shared_ptr<SurfaceUserData>>
-EmbreeRayTracer::register_surface(const std::shared_ptr<MeshManager>& mesh_manager,
-                                  MeshID surface,
-                                  RTCScene& volume_scene,
-                                  int& storage_offset)
+EmbreeRayTracer::create_surface_geometry(const std::shared_ptr<MeshManager>& mesh_manager,
+                                         MeshID surface,
+                                         const std::vector<MeshID>& surface_faces,
+                                         PrimitiveRef* primitive_refs) const
 {
-  auto& triangle_storage = this->primitive_ref_storage_[volume_scene];
-  PrimitiveRef* tri_ref_ptr = triangle_storage.data();
-  auto surface_faces = mesh_manager->get_surface_faces(surface);
   size_t surf_face_count = surface_faces.size();
 
   // fill primitive refs
   for (size_t i = 0; i < surf_face_count; ++i) {
-    triangle_storage[storage_offset + i].primitive_id = surface_faces[i];
+    primitive_refs[i].primitive_id = surface_faces[i];
   }
 
   // create new RTCGeometry for the surface
-  auto surface_geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_USER);
-  rtcSetGeometryUserPrimitiveCount(surface_geometry, surf_face_count);
-  rtcAttachGeometry(volume_scene, surface_geometry);
-  surface_to_geometry_map_[surface] = surface_geometry;
+  RTCGeometry surface_geometry;
+  if (native_triangles_) {
+    surface_geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_TRIANGLE);
+    // vertices are stored per-triangle so that buffer indices match the primitive references
+    float* vertex_buffer = (float*)rtcSetNewGeometryBuffer(surface_geometry, RTC_BUFFER_TYPE_VERTEX, 0,
+                                                           RTC_FORMAT_FLOAT3, 3 * sizeof(float), 3 * surf_face_count);
+    unsigned* index_buffer = (unsigned*)rtcSetNewGeometryBuffer(surface_geometry, RTC_BUFFER_TYPE_INDEX, 0,
+                                                                RTC_FORMAT_UINT3, 3 * sizeof(unsigned), surf_face_count);
+    for (size_t i = 0; i < surf_face_count; ++i) {
+      auto vertices = mesh_manager->face_vertices(surface_faces[i]);
+      for (int j = 0; j < 3; ++j) {
+        vertex_buffer[9 * i + 3 * j] = vertices[j].x;
+        vertex_buffer[9 * i + 3 * j + 1] = vertices[j].y;
+        vertex_buffer[9 * i + 3 * j + 2] = vertices[j].z;
+        index_buffer[3 * i + j] = 3 * i + j;
+      }
+    }
+  } else {
+    surface_geometry = rtcNewGeometry(device_, RTC_GEOMETRY_TYPE_USER);
+    rtcSetGeometryUserPrimitiveCount(surface_geometry, surf_face_count);
+  }
 
   // create new SurfaceUserData for the surface
   auto surface_data = std::make_shared<SurfaceUserData>();
   surface_data->surface_id = surface;
   surface_data->mesh_manager = mesh_manager.get();
-  surface_data->prim_ref_buffer = tri_ref_ptr + storage_offset;
-  surface_user_data_map_[surface_geometry] = surface_data;
+  surface_data->prim_ref_buffer = primitive_refs;
+
+  // cache the triangle data for the geometry callbacks if requested
+  if (bake_triangles_) {
+    auto& baked = surface_data->baked_triangles;
+    baked.vertices.reserve(9 * surf_face_count);
+    baked.normals.reserve(3 * surf_face_count);
+    for (size_t i = 0; i < surf_face_count; ++i) {
+      baked.push_back(mesh_manager->face_vertices(surface_faces[i]), mesh_manager->face_normal(surface_faces[i]));
+    }
+  }
   rtcSetGeometryUserData(surface_geometry, surface_data.get());
 
   // Set RTC callbacks
-  rtcSetGeometryBoundsFunction(surface_geometry, (RTCBoundsFunction)&TriangleBoundsFunc, nullptr);
-  rtcSetGeometryIntersectFunction(surface_geometry, (RTCIntersectFunctionN)&TriangleIntersectionFunc);
-  rtcSetGeometryOccludedFunction(surface_geometry, (RTCOccludedFunctionN)&TriangleOcclusionFunc);
+  if (native_triangles_) {
+    rtcSetGeometryIntersectFilterFunction(surface_geometry, (RTCFilterFunctionN)&TriangleIntersectionFilterFunc);
+    rtcSetGeometryOccludedFilterFunction(surface_geometry, (RTCFilterFunctionN)&TriangleOcclusionFilterFunc);
+  } else {
+    rtcSetGeometryBoundsFunction(surface_geometry, (RTCBoundsFunction)&TriangleBoundsFunc, nullptr);
+    rtcSetGeometryIntersectFunction(surface_geometry, (RTCIntersectFunctionN)&TriangleIntersectionFunc);
+    rtcSetGeometryOccludedFunction(surface_geometry, (RTCOccludedFunctionN)&TriangleOcclusionFunc);
+  }
   rtcCommitGeometry(surface_geometry);
 
-  // increment storage offset by number of faces in this surface
-  storage_offset += surf_face_count;
-
   return {surface_geometry, surface_data};
 }
 
@@ -150,14 +314,25 @@ ElementTreeID
 EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_manager,
                                      MeshID volume)
 {
+  RTCScene volume_element_scene;
+  ElementTreeID tree = setup_element_tree(mesh_manager, volume, volume_element_scene);
+  if (volume_element_scene) commit_scenes({volume_element_scene}, TreeClass::ELEMENT);
+  return tree;
+}
+
+ElementTreeID
+EmbreeRayTracer::setup_element_tree(const std::shared_ptr<MeshManager>& mesh_manager,
+                                    MeshID volume,
+                                    RTCScene& volume_element_scene)
+{
+  volume_element_scene = nullptr;
   auto volume_elements = mesh_manager->get_volume_elements(volume);
   if (volume_elements.size() == 0) return TREE_NONE;
 
   // create a new geometry
-  RTCScene volume_element_scene = create_embree_scene();
+  volume_element_scene = create_embree_scene(TreeClass::ELEMENT);
   // create primitive references for the volumetric elements
-  this->primitive_ref_storage_[volume_element_scene].resize(volume_elements.size());
-  auto& volume_element_storage = this->primitive_ref_storage_[volume_element_scene];
+  auto& volume_element_storage = this->primitive_ref_storage_.emplace_back(volume_elements.size());
   for (int i = 0; i < volume_elements.size(); ++i) {
     auto& primitive_ref = volume_element_storage[i];
     primitive_ref.primitive_id = volume_elements[i];
@@ -170,6 +345,16 @@ EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_ma
   volume_elements_data->volume_id = volume;
   volume_elements_data->mesh_manager = mesh_manager.get();
   volume_elements_data->prim_ref_buffer = volume_element_storage.data();
+
+  // cache the element transforms for the point location callbacks if requested
+  if (bake_elements_) {
+    auto& baked = volume_elements_data->baked_elements;
+    baked.transforms.reserve(BakedTetrahedronData::STRIDE * volume_elements.size());
+    for (auto element : volume_elements) {
+      auto vertices = mesh_manager->tet_vertices(element);
+      baked.push_back(tet_barycentric_transform(vertices[0], vertices[1], vertices[2], vertices[3]));
+    }
+  }
   this->volume_user_data_map_[element_geometry] = volume_elements_data;
 
   rtcSetGeometryUserData(element_geometry, volume_elements_data.get());
@@ -179,7 +364,6 @@ EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_ma
   rtcSetGeometryOccludedFunction(element_geometry, (RTCOccludedFunctionN)&TetrahedronOcclusionFunc);
 
   rtcCommitGeometry(element_geometry);
-  rtcCommitScene(volume_element_scene);
 
   ElementTreeID tree = next_element_tree_id();
   element_trees_.push_back(tree);
@@ -189,16 +373,25 @@ EmbreeRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_ma
 
 void EmbreeRayTracer::create_global_surface_tree()
 {
-  if (global_surface_scene_ != nullptr) {
-    rtcReleaseScene(global_surface_scene_);
-  }
-  global_surface_scene_ = create_embree_scene();
+  if (volume_trees_) {
+    int64_t device_bytes = device_bytes_;
+    if (global_surface_scene_ != nullptr) {
+      rtcReleaseScene(global_surface_scene_);
+    }
+    global_surface_scene_ = create_embree_scene(TreeClass::GLOBAL_SURFACE);
 
-  for(auto& [geom, surface_data] : surface_user_data_map_) {
-      rtcAttachGeometry(global_surface_scene_, geom);
+    for(auto& [geom, surface_data] : surface_user_data_map_) {
+        rtcAttachGeometry(global_surface_scene_, geom);
+    }
+
+    rtcCommitScene(global_surface_scene_);
+    tree_bytes_.at(static_cast<size_t>(TreeClass::GLOBAL_SURFACE)) += device_bytes_ - device_bytes;
+  } else if (global_surface_scene_ == nullptr) {
+    // the shared scene already holds every registered surface
+    global_surface_scene_ = create_embree_scene(TreeClass::GLOBAL_SURFACE);
+    commit_scenes({global_surface_scene_}, TreeClass::GLOBAL_SURFACE);
   }
 
-  rtcCommitScene(global_surface_scene_);
   SurfaceTreeID tree = next_surface_tree_id();
   surface_trees_.push_back(tree);
   surface_volume_tree_to_scene_map_[tree] = global_surface_scene_;
@@ -207,15 +400,17 @@ void EmbreeRayTracer::create_global_surface_tree()
 
 void EmbreeRayTracer::create_global_element_tree()
 {
+  int64_t device_bytes = device_bytes_;
   if (global_element_scene_ != nullptr) {
     rtcReleaseScene(global_element_scene_);
   }
-  global_element_scene_ = create_embree_scene();
+  global_element_scene_ = create_embree_scene(TreeClass::ELEMENT);
 
   for (auto& [vol_geom, data] : volume_user_data_map_) {
     rtcAttachGeometry(global_element_scene_, vol_geom);
   }
   rtcCommitScene(global_element_scene_);
+  tree_bytes_.at(static_cast<size_t>(TreeClass::ELEMENT)) += device_bytes_ - device_bytes;
 
   ElementTreeID tree = next_element_tree_id();
   element_trees_.push_back(tree);
@@ -232,10 +427,17 @@ MeshID EmbreeRayTracer::find_element(const Position& point) const
 MeshID EmbreeRayTracer::find_element(ElementTreeID tree,
                                      const Position& point) const
 {
+  return locate(tree, point).element;
+}
+
+ElementLocation EmbreeRayTracer::locate(ElementTreeID tree,
+                                        const Position& point) const
+{
+  XDG_STAT(FIND_ELEMENT);
 
   if (!element_volume_tree_to_scene_map_.count(tree)) {
     warning(fmt::format("Tree {} does not have a point location tree", tree));
-    return ID_NONE;
+    return {};
   }
 
   RTCScene scene = element_volume_tree_to_scene_map_.at(tree);
@@ -251,17 +453,73 @@ MeshID EmbreeRayTracer::find_element(ElementTreeID tree,
     rtcOccluded1(scene, (RTCRay*)&ray);
   }
 
-  if (ray.dtfar != -INFTY) return ID_NONE;
+  if (ray.dtfar != -INFTY) return {};
+
+  return {ray.element, ray.barycentrics};
+}
 
-  return ray.element;
+// Fire a single ray against native triangle geometry. The double precision ray
+// data and hit information are carried in the first lane of the packet context,
+// which the caller sets up with the query type, orientation and volume tree.
+// The Embree geometry ID of the hit is written to geom_id if provided.
+static bool native_intersect1(RTCScene scene,
+                              RTCDualPacketContext& packet,
+                              const Position& origin,
+                              const Direction& direction,
+                              const double dist_limit,
+                              const ExclusionSet* exclude_primitives,
+                              unsigned* geom_id = nullptr)
+{
+  rtcInitRayQueryContext(&packet.context);
+
+  RTCRayHit rayhit;
+  rayhit.ray.org_x = origin.x;
+  rayhit.ray.org_y = origin.y;
+  rayhit.ray.org_z = origin.z;
+  rayhit.ray.dir_x = direction.x;
+  rayhit.ray.dir_y = direction.y;
+  rayhit.ray.dir_z = direction.z;
+  rayhit.ray.tnear = 0.0;
+  rayhit.ray.tfar = std::min(dist_limit, INFTYF);
+  rayhit.ray.time = 0.0;
+  rayhit.ray.mask = -1; // no mask
+  rayhit.ray.flags = 0;
+  rayhit.ray.id = 0; // lane of this ray in the packet context
+  rayhit.hit.geomID = RTC_INVALID_GEOMETRY_ID;
+  rayhit.hit.primID = RTC_INVALID_GEOMETRY_ID;
+
+  packet.dorg[0] = origin;
+  packet.ddir[0] = direction;
+  packet.dtfar[0] = dist_limit;
+  packet.exclude_primitives[0] = exclude_primitives;
+  packet.primitive_ref[0] = nullptr;
+  packet.surface[0] = ID_NONE;
+
+  rtcIntersect1(scene, &rayhit, &packet.context);
+
+  if (geom_id) *geom_id = rayhit.hit.geomID;
+  return rayhit.hit.geomID != RTC_INVALID_GEOMETRY_ID;
 }
 
 bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
                                 const Position& point,
                                 const Direction* direction,
-                                const std::vector<MeshID>* exclude_primitives) const
+                                const ExclusionSet* exclude_primitives) const
 {
+  XDG_STAT(POINT_IN_VOLUME);
   RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+
+  if (native_triangles_) {
+    RTCDualPacketContext packet;
+    packet.rf_type = RayFireType::VOLUME;
+    packet.orientation = HitOrientation::ANY;
+    packet.volume_tree = tree;
+    packet.volume_filter = volume_filter(tree);
+    Direction dir = direction ? *direction : Direction(1. / std::sqrt(2.0), 1 / std::sqrt(2.0), 0.0);
+    if (!native_intersect1(scene, packet, point, dir, INFTY, exclude_primitives)) return false;
+    return packet.ddir[0].dot(packet.dNg[0]) > 0.0;
+  }
+
   RTCDualRayHit rayhit; // embree specfic rayhit struct (payload?)
   rayhit.ray.set_org(point);
   if (direction != nullptr) rayhit.ray.set_dir(*direction);
@@ -271,6 +529,7 @@ bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
   rayhit.ray.set_tfar(INFTY);
   rayhit.ray.set_tnear(0.0);
   rayhit.ray.volume_tree = tree;
+  rayhit.ray.volume_filter = volume_filter(tree);
 
   if (exclude_primitives != nullptr) rayhit.ray.exclude_primitives = exclude_primitives;
 
@@ -286,15 +545,70 @@ bool EmbreeRayTracer::point_in_volume(SurfaceTreeID tree,
   return rayhit.ray.ddir.dot(rayhit.hit.dNg) > 0.0;
 }
 
+MeshID EmbreeRayTracer::find_volume(const Position& point,
+                                    const Direction& direction) const
+{
+  if (global_surface_scene_ == nullptr)
+    fatal_error("The global surface tree must be created before finding volumes");
+
+  // fire a single ray against every surface in the model. Normals are not
+  // flipped for FIND_VOLUME rays, so the sign of the hit normal relative to
+  // the ray direction is the sense of the surface crossing
+  unsigned geom_id;
+  double sense;
+  if (native_triangles_) {
+    RTCDualPacketContext packet;
+    packet.rf_type = RayFireType::FIND_VOLUME;
+    packet.orientation = HitOrientation::ANY;
+    packet.volume_tree = global_surface_tree_;
+    if (!native_intersect1(global_surface_scene_, packet, point, direction, INFTY, nullptr, &geom_id)) return ID_NONE;
+    sense = packet.ddir[0].dot(packet.dNg[0]);
+  } else {
+    RTCDualRayHit rayhit;
+    rayhit.ray.set_org(point);
+    rayhit.ray.set_dir(direction);
+    rayhit.ray.rf_type = RayFireType::FIND_VOLUME;
+    rayhit.ray.orientation = HitOrientation::ANY;
+    rayhit.ray.set_tfar(INFTY);
+    rayhit.ray.set_tnear(0.0);
+    rayhit.ray.volume_tree = global_surface_tree_;
+
+    rtcIntersect1(global_surface_scene_, (RTCRayHit*)&rayhit);
+
+    if (rayhit.hit.geomID == RTC_INVALID_GEOMETRY_ID) return ID_NONE;
+    geom_id = rayhit.hit.geomID;
+    sense = rayhit.dot_prod();
+  }
+
+  // a ray crossing the surface along its normal is exiting the forward volume
+  RTCGeometry geometry = rtcGetGeometry(global_surface_scene_, geom_id);
+  const SurfaceUserData* surface_data = (const SurfaceUserData*)rtcGetGeometryUserData(geometry);
+  return sense > 0.0 ? surface_data->forward_vol : surface_data->reverse_vol;
+}
+
 std::pair<double, MeshID>
 EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
                     const Position& origin,
                     const Direction& direction,
                     const double dist_limit,
                     HitOrientation orientation,
-                    std::vector<MeshID>* const exclude_primitves)
+                    ExclusionSet* const exclude_primitves) const
 {
+  XDG_STAT(RAY_FIRE);
   RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+
+  if (native_triangles_) {
+    RTCDualPacketContext packet;
+    packet.rf_type = RayFireType::VOLUME;
+    packet.orientation = orientation;
+    packet.volume_tree = tree;
+    packet.volume_filter = volume_filter(tree);
+    if (!native_intersect1(scene, packet, origin, direction, dist_limit, exclude_primitves))
+      return {INFTY, ID_NONE};
+    if (exclude_primitves) exclude_primitves->insert(packet.primitive_ref[0]->primitive_id);
+    return {packet.dtfar[0], packet.surface[0]};
+  }
+
   RTCDualRayHit rayhit;
   // set ray data
   rayhit.ray.set_org(origin);
@@ -305,6 +619,7 @@ EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
   rayhit.ray.orientation = orientation;
   rayhit.ray.mask = -1; // no mask
   rayhit.ray.volume_tree = tree;
+  rayhit.ray.volume_filter = volume_filter(tree);
 
   if (exclude_primitves != nullptr) rayhit.ray.exclude_primitives = exclude_primitves;
 
@@ -321,16 +636,206 @@ EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
     return {INFTY, ID_NONE};
   else
 
-    if (exclude_primitves) exclude_primitves->push_back(rayhit.hit.primitive_ref->primitive_id);
+    if (exclude_primitves) exclude_primitves->insert(rayhit.hit.primitive_ref->primitive_id);
     return {rayhit.ray.dtfar, rayhit.hit.surface};
 }
 
+// Embree ray packet type and query for each supported packet size
+template<int N> struct RTCRayHitPacket;
+
+template<> struct RTCRayHitPacket<4> {
+  using type = RTCRayHit4;
+  static void intersect(const int* valid, RTCScene scene, type* rayhit, RTCRayQueryContext* context) {
+    rtcIntersect4(valid, scene, rayhit, context);
+  }
+};
+
+template<> struct RTCRayHitPacket<8> {
+  using type = RTCRayHit8;
+  static void intersect(const int* valid, RTCScene scene, type* rayhit, RTCRayQueryContext* context) {
+    rtcIntersect8(valid, scene, rayhit, context);
+  }
+};
+
+template<> struct RTCRayHitPacket<16> {
+  using type = RTCRayHit16;
+  static void intersect(const int* valid, RTCScene scene, type* rayhit, RTCRayQueryContext* context) {
+    rtcIntersect16(valid, scene, rayhit, context);
+  }
+};
+
+template<int N>
+void fire_packets(RTCScene scene,
+                  SurfaceTreeID tree,
+                  bool volume_filter,
+                  const Position* origins,
+                  const Direction* directions,
+                  size_t n_rays,
+                  std::pair<double, MeshID>* hits,
+                  const double dist_limit,
+                  HitOrientation orientation,
+                  ExclusionSet* const exclude_primitives)
+{
+  XDG_STAT_N(RAY_FIRE, n_rays);
+  RTCDualPacketContext packet;
+  rtcInitRayQueryContext(&packet.context);
+  packet.rf_type = RayFireType::VOLUME;
+  packet.orientation = orientation;
+  packet.volume_tree = tree;
+  packet.volume_filter = volume_filter;
+
+  typename RTCRayHitPacket<N>::type rayhit;
+  alignas(64) int valid[N];
+
+  for (size_t start = 0; start < n_rays; start += N) {
+    size_t n_active = std::min(n_rays - start, static_cast<size_t>(N));
+
+    // set ray data, disabling any unused lanes in the final packet
+    for (size_t i = 0; i < N; i++) {
+      if (i >= n_active) {
+        valid[i] = 0;
+        continue;
+      }
+      valid[i] = -1;
+
+      const Position& origin = origins[start + i];
+      const Direction& direction = directions[start + i];
+      rayhit.ray.org_x[i] = origin.x;
+      rayhit.ray.org_y[i] = origin.y;
+      rayhit.ray.org_z[i] = origin.z;
+      rayhit.ray.dir_x[i] = direction.x;
+      rayhit.ray.dir_y[i] = direction.y;
+      rayhit.ray.dir_z[i] = direction.z;
+      rayhit.ray.tnear[i] = 0.0;
+      rayhit.ray.tfar[i] = std::min(dist_limit, INFTYF);
+      rayhit.ray.time[i] = 0.0;
+      rayhit.ray.mask[i] = -1; // no mask
+      rayhit.ray.flags[i] = 0;
+      rayhit.ray.id[i] = i; // lane of this ray in the packet context
+      rayhit.hit.geomID[i] = RTC_INVALID_GEOMETRY_ID;
+      rayhit.hit.primID[i] = RTC_INVALID_GEOMETRY_ID;
+
+      packet.dorg[i] = origin;
+      packet.ddir[i] = direction;
+      packet.dtfar[i] = dist_limit;
+      packet.exclude_primitives[i] = exclude_primitives ? exclude_primitives + start + i : nullptr;
+      packet.primitive_ref[i] = nullptr;
+      packet.surface[i] = ID_NONE;
+    }
+
+    // fire the packet
+    RTCRayHitPacket<N>::intersect(valid, scene, &rayhit, &packet.context);
+
+    for (size_t i = 0; i < n_active; i++) {
+      if (rayhit.hit.geomID[i] == RTC_INVALID_GEOMETRY_ID) {
+        hits[start + i] = {INFTY, ID_NONE};
+        continue;
+      }
+      if (exclude_primitives) exclude_primitives[start + i].insert(packet.primitive_ref[i]->primitive_id);
+      hits[start + i] = {packet.dtfar[i], packet.surface[i]};
+    }
+  }
+}
+
+void
+EmbreeRayTracer::ray_fire(SurfaceTreeID tree,
+                          const Position* origins,
+                          const Direction* directions,
+                          size_t n_rays,
+                          std::pair<double, MeshID>* hits,
+                          const double dist_limit,
+                          HitOrientation orientation,
+                          ExclusionSet* const exclude_primitives) const
+{
+  RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+
+  switch (packet_size_) {
+  case 4:
+    fire_packets<4>(scene, tree, volume_filter(tree), origins, directions, n_rays, hits, dist_limit, orientation, exclude_primitives);
+    break;
+  case 8:
+    fire_packets<8>(scene, tree, volume_filter(tree), origins, directions, n_rays, hits, dist_limit, orientation, exclude_primitives);
+    break;
+  case 16:
+    fire_packets<16>(scene, tree, volume_filter(tree), origins, directions, n_rays, hits, dist_limit, orientation, exclude_primitives);
+    break;
+  default:
+    RayTracer::ray_fire(tree, origins, directions, n_rays, hits, dist_limit, orientation, exclude_primitives);
+  }
+}
+
+void EmbreeRayTracer::set_native_triangles(bool native)
+{
+  if (!surface_to_geometry_map_.empty())
+    fatal_error("Native triangle geometry must be enabled or disabled before any volumes are registered");
+  if (native && !volume_trees_)
+    fatal_error("Native triangle geometry requires a separate surface tree for each volume");
+  native_triangles_ = native;
+}
+
+void EmbreeRayTracer::set_volume_trees(bool volume_trees)
+{
+  if (!surface_to_geometry_map_.empty())
+    fatal_error("Volume surface trees must be enabled or disabled before any volumes are registered");
+  // native triangles carry no user data to filter hits by volume
+  if (!volume_trees && native_triangles_)
+    fatal_error("Native triangle geometry requires a separate surface tree for each volume");
+  volume_trees_ = volume_trees;
+}
+
+void EmbreeRayTracer::set_low_memory(bool low_memory)
+{
+  if (!surface_to_geometry_map_.empty())
+    fatal_error("The low memory mode must be set before any volumes are registered");
+  for (auto tree_class : {TreeClass::VOLUME_SURFACE, TreeClass::GLOBAL_SURFACE, TreeClass::ELEMENT}) {
+    auto settings = tree_build_settings(tree_class);
+    settings.compact = low_memory;
+    set_tree_build_settings(tree_class, settings);
+  }
+  if (low_memory) {
+    bake_triangles_ = false;
+    bake_elements_ = false;
+    native_triangles_ = false;
+  }
+  volume_trees_ = !low_memory;
+}
+
+EmbreeRayTracer::MemoryUsage EmbreeRayTracer::memory_usage() const
+{
+  MemoryUsage usage;
+  usage.volume_surface_trees = tree_bytes_[static_cast<size_t>(TreeClass::VOLUME_SURFACE)];
+  usage.global_surface_tree = tree_bytes_[static_cast<size_t>(TreeClass::GLOBAL_SURFACE)];
+  usage.element_trees = tree_bytes_[static_cast<size_t>(TreeClass::ELEMENT)];
+  usage.geometry = geometry_bytes_;
+  for (const auto& block : primitive_ref_storage_) {
+    usage.primitive_refs += block.capacity() * sizeof(PrimitiveRef);
+  }
+  for (const auto& [geometry, surface_data] : surface_user_data_map_) {
+    const auto& baked = surface_data->baked_triangles;
+    usage.baked_triangles += (baked.vertices.capacity() + baked.normals.capacity()) * sizeof(double);
+  }
+  for (const auto& [geometry, element_data] : volume_user_data_map_) {
+    usage.baked_elements += element_data->baked_elements.transforms.capacity() * sizeof(double);
+  }
+  return usage;
+}
+
+void EmbreeRayTracer::set_packet_size(int packet_size)
+{
+  if (packet_size != 1 && packet_size != 4 && packet_size != 8 && packet_size != 16)
+    fatal_error("Invalid ray packet size {}. Must be one of 1, 4, 8 or 16", packet_size);
+  packet_size_ = packet_size;
+}
+
 std::pair<double, MeshID> EmbreeRayTracer::closest(SurfaceTreeID tree,
-                                                   const Position& point)
+                                                   const Position& point) const
 {
+  XDG_STAT(CLOSEST);
   RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
   RTCDPointQuery query;
   query.set_point(point);
+  query.volume_tree = tree;
+  query.volume_filter = volume_filter(tree);
 
   RTCPointQueryContext context;
   rtcInitPointQueryContext(&context);
@@ -349,7 +854,42 @@ bool EmbreeRayTracer::occluded(SurfaceTreeID tree,
                          const Direction& direction,
                          double& distance) const
 {
+  XDG_STAT(OCCLUDED);
   RTCScene scene = surface_volume_tree_to_scene_map_.at(tree);
+
+  if (native_triangles_) {
+    RTCDualPacketContext packet;
+    rtcInitRayQueryContext(&packet.context);
+    packet.rf_type = RayFireType::FIND_VOLUME;
+    packet.orientation = HitOrientation::ANY;
+    packet.volume_tree = tree;
+    packet.volume_filter = volume_filter(tree);
+    packet.dorg[0] = origin;
+    packet.ddir[0] = direction;
+    packet.dtfar[0] = INFTY;
+    packet.exclude_primitives[0] = nullptr;
+
+    RTCRay ray;
+    ray.org_x = origin.x;
+    ray.org_y = origin.y;
+    ray.org_z = origin.z;
+    ray.dir_x = direction.x;
+    ray.dir_y = direction.y;
+    ray.dir_z = direction.z;
+    ray.tnear = 0.0;
+    ray.tfar = INFTYF;
+    ray.time = 0.0;
+    ray.mask = -1; // no mask
+    ray.flags = 0;
+    ray.id = 0; // lane of this ray in the packet context
+
+    // the occlusion filter marks the ray as occluded in the packet context
+    rtcOccluded1(scene, &ray, &packet.context);
+
+    distance = packet.dtfar[0];
+    return distance != INFTY;
+  }
+
   RTCSurfaceDualRay ray;
   ray.set_org(origin);
   ray.set_dir(direction);
@@ -357,6 +897,8 @@ bool EmbreeRayTracer::occluded(SurfaceTreeID tree,
   ray.set_tnear(0.0);
   ray.rf_type = RayFireType::FIND_VOLUME;
   ray.orientation = HitOrientation::ANY;
+  ray.volume_tree = tree;
+  ray.volume_filter = volume_filter(tree);
   ray.flags = 0;
   ray.mask = -1; // no mask
 
@@ -2,6 +2,7 @@
 
 #include "xdg/geometry/plucker.h"
 
+#include <algorithm>
 
 #include "xdg/constants.h"
 #include "xdg/vec3da.h"
@@ -11,7 +12,7 @@ namespace xdg {
 constexpr bool EXIT_EARLY = false;
 
 double plucker_edge_test(const Position& vertexa, const Position& vertexb,
-  const Position& ray, const Position& ray_normal)
+  const Position& ray, const Position& ray_normal, const double zero_tol = PLUCKER_ZERO_TOL)
 {
   double pip;
   if (lower(vertexa, vertexb)) {
@@ -24,7 +25,7 @@ double plucker_edge_test(const Position& vertexa, const Position& vertexb,
     pip = ray.dot(edge_normal) + ray_normal.dot(edge);
     pip = -pip;
   }
-  if (PLUCKER_ZERO_TOL > fabs(pip))
+  if (zero_tol > fabs(pip))
     pip = 0.0;
   return pip;
 }
@@ -35,7 +36,8 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
                                double& dist_out,
                                const double nonneg_ray_len,
                                const double* neg_ray_len,
-                               const int* orientation)
+                               const int* orientation,
+                               const double zero_tol)
 {
   dist_out = INFTY;
 
@@ -44,7 +46,7 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
 
   // Determine the value of the first Plucker coordinate from edge 0
   double plucker_coord0 =
-    plucker_edge_test(vertices[0], vertices[1], raya, rayb);
+    plucker_edge_test(vertices[0], vertices[1], raya, rayb, zero_tol);
 
   // If orientation is set, confirm that sign of plucker_coordinate indicate
   // correct orientation of intersection
@@ -54,7 +56,7 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
 
   // Determine the value of the second Plucker coordinate from edge 1
   double plucker_coord1 =
-    plucker_edge_test(vertices[1], vertices[2], raya, rayb);
+    plucker_edge_test(vertices[1], vertices[2], raya, rayb, zero_tol);
 
   // If orientation is set, confirm that sign of plucker_coordinate indicate
   // correct orientation of intersection
@@ -71,7 +73,7 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
 
   // Determine the value of the third Plucker coordinate from edge 2
   double plucker_coord2 =
-    plucker_edge_test(vertices[2], vertices[0], raya, rayb);
+    plucker_edge_test(vertices[2], vertices[0], raya, rayb, zero_tol);
 
   // If orientation is set, confirm that sign of plucker_coordinate indicate
   // correct orientation of intersection
@@ -125,5 +127,76 @@ bool plucker_ray_tri_intersect(const std::array<Position, 3> vertices,
   return true;
 }
 
+int plucker_ray_tet_exit(const std::array<Position, 4>& vertices,
+                         const std::array<std::array<int, 3>, 4>& faces,
+                         const Position& origin,
+                         const Direction& direction,
+                         double& dist_out)
+{
+  dist_out = INFTY;
+
+  const Position raya = direction;
+  const Position rayb = direction.cross(origin);
+
+  // Plucker coordinate of each edge, computed from the lower to the higher
+  // local vertex index. plucker_edge_test orders the edge vertices
+  // internally, so reversing an edge exactly negates its coordinate.
+  constexpr int edge_index[4][4] = {{-1, 0, 1, 2}, {0, -1, 3, 4}, {1, 3, -1, 5}, {2, 4, 5, -1}};
+  std::array<double, 6> edge_coords;
+  for (int a = 0; a < 4; a++) {
+    for (int b = a + 1; b < 4; b++) {
+      edge_coords[edge_index[a][b]] = plucker_edge_test(vertices[a], vertices[b], raya, rayb);
+    }
+  }
+
+  auto edge_coord = [&](int a, int b) {
+    double coord = edge_coords[edge_index[a][b]];
+    return a < b ? coord : -coord;
+  };
+
+  // To minimize numerical error, get index of largest magnitude direction.
+  int idx = 0;
+  double max_abs_dir = 0;
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (fabs(direction[i]) > max_abs_dir) {
+      idx = i;
+      max_abs_dir = fabs(direction[i]);
+    }
+  }
+
+  int face_out = -1;
+  for (int i = 0; i < 4; i++) {
+    const auto& f = faces[i];
+
+    // exiting intersections only, all coordinates must be non-positive
+    double plucker_coord0 = edge_coord(f[0], f[1]);
+    if (plucker_coord0 > 0) continue;
+    double plucker_coord1 = edge_coord(f[1], f[2]);
+    if (plucker_coord1 > 0) continue;
+    double plucker_coord2 = edge_coord(f[2], f[0]);
+    if (plucker_coord2 > 0) continue;
+
+    // check for coplanar case to avoid dividing by zero
+    if (0.0 == plucker_coord0 && 0.0 == plucker_coord1 && 0.0 == plucker_coord2) continue;
+
+    // get the distance to intersection
+    const double inverse_sum =
+      1.0 / (plucker_coord0 + plucker_coord1 + plucker_coord2);
+
+    const Position intersection(plucker_coord0 * inverse_sum * vertices[f[2]] +
+                                plucker_coord1 * inverse_sum * vertices[f[0]] +
+                                plucker_coord2 * inverse_sum * vertices[f[1]]);
+
+    double dist = (intersection[idx] - origin[idx]) / direction[idx];
+    dist = std::max(0.0, dist);
+
+    if (dist < dist_out) {
+      dist_out = dist;
+      face_out = i;
+    }
+  }
+
+  return face_out;
+}
 
 } // namespace xdg
\ No newline at end of file
@@ -0,0 +1,371 @@
+#include "xdg/geometry/plucker.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "xdg/constants.h"
+#include "xdg/error.h"
+#include "xdg/vec3da.h"
+
+// The vectorized kernels use GCC/Clang vector extensions and function level
+// target attributes so that the rest of the library can be built for the
+// baseline instruction set (__builtin_shufflevector requires GCC 12 or Clang)
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12))
+#define XDG_PLUCKER_SIMD
+#endif
+
+namespace xdg {
+
+namespace {
+
+#ifdef XDG_PLUCKER_SIMD
+
+typedef double double4 __attribute__((vector_size(32)));
+typedef int64_t mask4 __attribute__((vector_size(32)));
+typedef double double8 __attribute__((vector_size(64)));
+typedef int64_t mask8 __attribute__((vector_size(64)));
+
+// Lane-wise helpers are always inlined into the target specific kernels
+// below, so vector values never cross a baseline ABI function boundary
+#define XDG_LANES_INLINE inline __attribute__((always_inline))
+#if !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Lane-wise comparisons
+template<typename V>
+XDG_LANES_INLINE auto less(const V& a, const V& b) { return a < b; }
+
+template<typename V>
+XDG_LANES_INLINE auto equal(const V& a, const V& b) { return a == b; }
+
+// GCC does not lower 512-bit comparisons producing vector masks well without
+// AVX512DQ, so compare the 256-bit halves instead
+#define XDG_COMPARE_HALVES(a, b, op)                                                     \
+  __builtin_shufflevector(__builtin_shufflevector(a, a, 0, 1, 2, 3) op                  \
+                          __builtin_shufflevector(b, b, 0, 1, 2, 3),                    \
+                          __builtin_shufflevector(a, a, 4, 5, 6, 7) op                  \
+                          __builtin_shufflevector(b, b, 4, 5, 6, 7), 0, 1, 2, 3, 4, 5, 6, 7)
+
+XDG_LANES_INLINE mask8 less(const double8& a, const double8& b) { return XDG_COMPARE_HALVES(a, b, <); }
+
+XDG_LANES_INLINE mask8 equal(const double8& a, const double8& b) { return XDG_COMPARE_HALVES(a, b, ==); }
+
+#undef XDG_COMPARE_HALVES
+
+// Lane-wise select, returning a where the mask is set and b elsewhere
+template<typename V, typename M>
+XDG_LANES_INLINE V select(const M& mask, const V& a, const V& b)
+{
+  return (V)((mask & (M)a) | (~mask & (M)b));
+}
+
+// Lane-wise absolute value
+template<typename V, typename M>
+XDG_LANES_INLINE V abs(const V& a)
+{
+  const V negative_zero = -(V{});
+  return (V)((M)a & ~(M)negative_zero);
+}
+
+// Lane-wise version of plucker_edge_test
+template<typename V, typename M>
+XDG_LANES_INLINE void edge_test(const V a[3], const V b[3], const V ray[3], const V ray_normal[3], V& pip)
+{
+  // lexicographic comparison of the edge vertices, as in lower()
+  M is_lower = less(a[0], b[0]) | (equal(a[0], b[0]) & (less(a[1], b[1]) | (equal(a[1], b[1]) & less(a[2], b[2]))));
+
+  V p[3], edge[3];
+  for (int i = 0; i < 3; i++) {
+    p[i] = select(is_lower, a[i], b[i]);
+    edge[i] = select(is_lower, b[i], a[i]) - p[i];
+  }
+
+  V edge_normal[3] {edge[1] * p[2] - edge[2] * p[1],
+                    edge[2] * p[0] - edge[0] * p[2],
+                    edge[0] * p[1] - edge[1] * p[0]};
+
+  pip = (ray[0] * edge_normal[0] + ray[1] * edge_normal[1] + ray[2] * edge_normal[2]) +
+        (ray_normal[0] * edge[0] + ray_normal[1] * edge[1] + ray_normal[2] * edge[2]);
+  pip = select(is_lower, pip, -pip);
+
+  const V tol = V{} + PLUCKER_ZERO_TOL;
+  M is_zero = less(pip, tol) & less(-tol, pip);
+  pip = select(is_zero, V{} + 0.0, pip);
+}
+
+// Lane-wise version of plucker_ray_tri_intersect without a negative ray length
+template<typename V, typename M>
+XDG_LANES_INLINE void intersect_lanes(const V v[3][3],
+                                      const V origin[3],
+                                      const V direction[3],
+                                      double nonneg_ray_len,
+                                      const int* orientation,
+                                      M& hit,
+                                      V& dist)
+{
+  const V zero = V{} + 0.0;
+
+  V ray_normal[3] {direction[1] * origin[2] - direction[2] * origin[1],
+                   direction[2] * origin[0] - direction[0] * origin[2],
+                   direction[0] * origin[1] - direction[1] * origin[0]};
+
+  V coords[3];
+  edge_test<V, M>(v[0], v[1], direction, ray_normal, coords[0]);
+  edge_test<V, M>(v[1], v[2], direction, ray_normal, coords[1]);
+  edge_test<V, M>(v[2], v[0], direction, ray_normal, coords[2]);
+
+  M miss;
+  if (orientation) {
+    const V sense = zero + (double)(*orientation);
+    miss = less(zero, sense * coords[0]) | less(zero, sense * coords[1]) | less(zero, sense * coords[2]);
+  } else {
+    // all coordinates must be the same sign or zero
+    M any_pos = less(zero, coords[0]) | less(zero, coords[1]) | less(zero, coords[2]);
+    M any_neg = less(coords[0], zero) | less(coords[1], zero) | less(coords[2], zero);
+    miss = any_pos & any_neg;
+  }
+
+  // coplanar case
+  miss |= equal(coords[0], zero) & equal(coords[1], zero) & equal(coords[2], zero);
+
+  const V inverse_sum = 1.0 / (coords[0] + coords[1] + coords[2]);
+  const V w0 = coords[0] * inverse_sum;
+  const V w1 = coords[1] * inverse_sum;
+  const V w2 = coords[2] * inverse_sum;
+
+  // select the component of the largest magnitude direction
+  V max_abs_dir = zero;
+  V intersection_c = zero, origin_c = zero, direction_c = zero;
+  for (int i = 0; i < 3; i++) {
+    V abs_dir = abs<V, M>(direction[i]);
+    M larger = less(max_abs_dir, abs_dir);
+    max_abs_dir = select(larger, abs_dir, max_abs_dir);
+    intersection_c = select(larger, w0 * v[2][i] + w1 * v[0][i] + w2 * v[1][i], intersection_c);
+    origin_c = select(larger, origin[i], origin_c);
+    direction_c = select(larger, direction[i], direction_c);
+  }
+  // with a zero direction the scalar routine uses the first component
+  M first = equal(max_abs_dir, zero);
+  intersection_c = select(first, w0 * v[2][0] + w1 * v[0][0] + w2 * v[1][0], intersection_c);
+  origin_c = select(first, origin[0], origin_c);
+  direction_c = select(first, direction[0], direction_c);
+
+  dist = (intersection_c - origin_c) / direction_c;
+
+  // distance limits
+  if (nonneg_ray_len) miss |= less(zero + nonneg_ray_len, dist);
+  miss |= less(dist, zero);
+
+  hit = ~miss;
+  dist = select(hit, dist, zero + INFTY);
+}
+
+// One ray against W triangles at a time
+template<typename V, typename M, int W>
+XDG_LANES_INLINE size_t ray_tris_lanes(const double* vertices,
+                                       size_t n_triangles,
+                                       const Position& origin,
+                                       const Direction& direction,
+                                       bool* hits_out,
+                                       double* dists_out,
+                                       double nonneg_ray_len,
+                                       const int* orientation)
+{
+  V o[3], d[3];
+  for (int i = 0; i < 3; i++) {
+    o[i] = V{} + origin[i];
+    d[i] = V{} + direction[i];
+  }
+
+  size_t n_full = n_triangles - n_triangles % W;
+  for (size_t start = 0; start < n_full; start += W) {
+    // transpose the triangle data into lanes
+    const double* tri = vertices + 9 * start;
+    V v[3][3];
+    for (int k = 0; k < 3; k++) {
+      for (int i = 0; i < 3; i++) {
+        for (int lane = 0; lane < W; lane++) v[k][i][lane] = tri[9 * lane + 3 * k + i];
+      }
+    }
+
+    M hit;
+    V dist;
+    intersect_lanes<V, M>(v, o, d, nonneg_ray_len, orientation, hit, dist);
+    for (int lane = 0; lane < W; lane++) {
+      hits_out[start + lane] = hit[lane] != 0;
+      dists_out[start + lane] = dist[lane];
+    }
+  }
+  return n_full;
+}
+
+// W rays against one triangle at a time
+template<typename V, typename M, int W>
+XDG_LANES_INLINE size_t rays_tri_lanes(const std::array<Position, 3>& vertices,
+                                       const Position* origins,
+                                       const Direction* directions,
+                                       size_t n_rays,
+                                       bool* hits_out,
+                                       double* dists_out,
+                                       double nonneg_ray_len,
+                                       const int* orientation)
+{
+  V v[3][3];
+  for (int k = 0; k < 3; k++) {
+    for (int i = 0; i < 3; i++) v[k][i] = V{} + vertices[k][i];
+  }
+
+  size_t n_full = n_rays - n_rays % W;
+  for (size_t start = 0; start < n_full; start += W) {
+    V o[3], d[3];
+    for (int i = 0; i < 3; i++) {
+      for (int lane = 0; lane < W; lane++) {
+        o[i][lane] = origins[start + lane][i];
+        d[i][lane] = directions[start + lane][i];
+      }
+    }
+
+    M hit;
+    V dist;
+    intersect_lanes<V, M>(v, o, d, nonneg_ray_len, orientation, hit, dist);
+    for (int lane = 0; lane < W; lane++) {
+      hits_out[start + lane] = hit[lane] != 0;
+      dists_out[start + lane] = dist[lane];
+    }
+  }
+  return n_full;
+}
+
+__attribute__((target("avx2")))
+size_t ray_tris_avx2(const double* vertices, size_t n_triangles, const Position& origin, const Direction& direction,
+                     bool* hits_out, double* dists_out, double nonneg_ray_len, const int* orientation)
+{
+  return ray_tris_lanes<double4, mask4, 4>(vertices, n_triangles, origin, direction,
+                                           hits_out, dists_out, nonneg_ray_len, orientation);
+}
+
+__attribute__((target("avx512f")))
+size_t ray_tris_avx512(const double* vertices, size_t n_triangles, const Position& origin, const Direction& direction,
+                       bool* hits_out, double* dists_out, double nonneg_ray_len, const int* orientation)
+{
+  return ray_tris_lanes<double8, mask8, 8>(vertices, n_triangles, origin, direction,
+                                           hits_out, dists_out, nonneg_ray_len, orientation);
+}
+
+__attribute__((target("avx2")))
+size_t rays_tri_avx2(const std::array<Position, 3>& vertices, const Position* origins, const Direction* directions,
+                     size_t n_rays, bool* hits_out, double* dists_out, double nonneg_ray_len, const int* orientation)
+{
+  return rays_tri_lanes<double4, mask4, 4>(vertices, origins, directions, n_rays,
+                                           hits_out, dists_out, nonneg_ray_len, orientation);
+}
+
+__attribute__((target("avx512f")))
+size_t rays_tri_avx512(const std::array<Position, 3>& vertices, const Position* origins, const Direction* directions,
+                       size_t n_rays, bool* hits_out, double* dists_out, double nonneg_ray_len, const int* orientation)
+{
+  return rays_tri_lanes<double8, mask8, 8>(vertices, origins, directions, n_rays,
+                                           hits_out, dists_out, nonneg_ray_len, orientation);
+}
+
+#endif // XDG_PLUCKER_SIMD
+
+SIMDLevel detect_simd_level()
+{
+#ifdef XDG_PLUCKER_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SIMDLevel::AVX512;
+  if (__builtin_cpu_supports("avx2")) return SIMDLevel::AVX2;
+#endif
+  return SIMDLevel::SCALAR;
+}
+
+SIMDLevel& active_simd_level()
+{
+  static SIMDLevel level = max_simd_level();
+  return level;
+}
+
+} // namespace
+
+SIMDLevel max_simd_level()
+{
+  static const SIMDLevel level = detect_simd_level();
+  return level;
+}
+
+SIMDLevel simd_level()
+{
+  return active_simd_level();
+}
+
+void set_simd_level(SIMDLevel level)
+{
+  if (level > max_simd_level())
+    fatal_error("SIMD level {} is not supported on this CPU (maximum is {})",
+                static_cast<int>(level), static_cast<int>(max_simd_level()));
+  active_simd_level() = level;
+}
+
+void plucker_ray_tri_intersect_batch(const double* vertices,
+                                     size_t n_triangles,
+                                     const Position& origin,
+                                     const Direction& direction,
+                                     bool* hits_out,
+                                     double* dists_out,
+                                     const double nonneg_ray_len,
+                                     const int* orientation)
+{
+  size_t start = 0;
+#ifdef XDG_PLUCKER_SIMD
+  switch (simd_level()) {
+    case SIMDLevel::AVX512:
+      start = ray_tris_avx512(vertices, n_triangles, origin, direction, hits_out, dists_out, nonneg_ray_len, orientation);
+      break;
+    case SIMDLevel::AVX2:
+      start = ray_tris_avx2(vertices, n_triangles, origin, direction, hits_out, dists_out, nonneg_ray_len, orientation);
+      break;
+    default:
+      break;
+  }
+#endif
+
+  for (size_t i = start; i < n_triangles; i++) {
+    const double* v = vertices + 9 * i;
+    std::array<Position, 3> tri {Position(v[0], v[1], v[2]), Position(v[3], v[4], v[5]), Position(v[6], v[7], v[8])};
+    hits_out[i] = plucker_ray_tri_intersect(tri, origin, direction, dists_out[i], nonneg_ray_len, nullptr, orientation);
+    if (!hits_out[i]) dists_out[i] = INFTY;
+  }
+}
+
+void plucker_rays_tri_intersect_batch(const std::array<Position, 3>& vertices,
+                                      const Position* origins,
+                                      const Direction* directions,
+                                      size_t n_rays,
+                                      bool* hits_out,
+                                      double* dists_out,
+                                      const double nonneg_ray_len,
+                                      const int* orientation)
+{
+  size_t start = 0;
+#ifdef XDG_PLUCKER_SIMD
+  switch (simd_level()) {
+    case SIMDLevel::AVX512:
+      start = rays_tri_avx512(vertices, origins, directions, n_rays, hits_out, dists_out, nonneg_ray_len, orientation);
+      break;
+    case SIMDLevel::AVX2:
+      start = rays_tri_avx2(vertices, origins, directions, n_rays, hits_out, dists_out, nonneg_ray_len, orientation);
+      break;
+    default:
+      break;
+  }
+#endif
+
+  for (size_t i = start; i < n_rays; i++) {
+    hits_out[i] = plucker_ray_tri_intersect(vertices, origins[i], directions[i], dists_out[i], nonneg_ray_len, nullptr, orientation);
+    if (!hits_out[i]) dists_out[i] = INFTY;
+  }
+}
+
+} // namespace xdg
@@ -186,6 +186,7 @@ GPRTRayTracer::create_surface_tree(const std::shared_ptr<MeshManager>& mesh_mana
     
     // Always update per-volume info
     auto [forward_parent, reverse_parent] = mesh_manager->get_parent_volumes(surf);
+    surface_parent_volumes_[surf] = {forward_parent, reverse_parent};
     if (volume_id == forward_parent) {
       geom_data->forward_vol = forward_parent;
       geom_data->forward_tree = tree;
@@ -202,6 +203,7 @@ GPRTRayTracer::create_surface_tree(const std::shared_ptr<MeshManager>& mesh_mana
   GPRTAccel volume_tlas = gprtInstanceAccelCreate(context_, surfaceBlasInstances.size(), instanceBuffer);
   gprtAccelBuild(context_, volume_tlas, buildParams_);
   surface_volume_tree_to_accel_map[tree] = volume_tlas;
+  volume_surface_tree_map_[volume_id] = tree;
   
   return tree;
 }
@@ -213,10 +215,28 @@ GPRTRayTracer::create_element_tree(const std::shared_ptr<MeshManager>& mesh_mana
   return TREE_NONE;
 };
 
+void GPRTRayTracer::upload_exclude_primitives(dblRay& ray, const ExclusionSet* exclude_primitives) const
+{
+  if (exclude_primitives) {
+    if (!exclude_primitives->empty()) gprtBufferResize(context_, excludePrimitivesBuffer_, exclude_primitives->size(), false);
+    gprtBufferMap(excludePrimitivesBuffer_);
+    std::copy(exclude_primitives->begin(), exclude_primitives->end(), gprtBufferGetHostPointer(excludePrimitivesBuffer_));
+    gprtBufferUnmap(excludePrimitivesBuffer_);
+
+    ray.exclude_primitives = gprtBufferGetDevicePointer(excludePrimitivesBuffer_);
+    ray.exclude_count = exclude_primitives->size();
+  }
+  else {
+    // If no primitives are excluded, set the pointer to null and count to 0
+    ray.exclude_primitives = nullptr;
+    ray.exclude_count = 0;
+  }
+}
+
 bool GPRTRayTracer::point_in_volume(SurfaceTreeID tree, 
                                     const Position& point,
                                     const Direction* direction,
-                                    const std::vector<MeshID>* exclude_primitives) const
+                                    const ExclusionSet* exclude_primitives) const
 {
   GPRTAccel volume = surface_volume_tree_to_accel_map.at(tree);
   auto rayGen = rayGenPrograms_.at(RayGenType::POINT_IN_VOLUME);
@@ -236,20 +256,7 @@ bool GPRTRayTracer::point_in_volume(SurfaceTreeID tree,
   ray[0].volume_tree = tree; // Set the TreeID of the volume being queried
   ray[0].hitOrientation = HitOrientation::ANY; // No orientation culling for point-in-volume check
 
-  if (exclude_primitives) {
-    if (!exclude_primitives->empty()) gprtBufferResize(context_, excludePrimitivesBuffer_, exclude_primitives->size(), false);
-    gprtBufferMap(excludePrimitivesBuffer_);
-    std::copy(exclude_primitives->begin(), exclude_primitives->end(), gprtBufferGetHostPointer(excludePrimitivesBuffer_));
-    gprtBufferUnmap(excludePrimitivesBuffer_);
-
-    ray[0].exclude_primitives = gprtBufferGetDevicePointer(excludePrimitivesBuffer_);
-    ray[0].exclude_count = exclude_primitives->size();
-  } 
-  else {
-    // If no primitives are excluded, set the pointer to null and count to 0
-    ray[0].exclude_primitives = nullptr;
-    ray[0].exclude_count = 0;
-  }
+  upload_exclude_primitives(ray[0], exclude_primitives);
   gprtBufferUnmap(rayHitBuffers_.ray); // required to sync buffer back on GPU?
 
   gprtRayGenLaunch1D(context_, rayGen, 1); // Launch raygen shader (entry point to RT pipeline)
@@ -277,7 +284,7 @@ std::pair<double, MeshID> GPRTRayTracer::ray_fire(SurfaceTreeID tree,
                                                   const Direction& direction,
                                                   double dist_limit,
                                                   HitOrientation orientation,
-                                                  std::vector<MeshID>* const exclude_primitives) 
+                                                  ExclusionSet* const exclude_primitives) const
 {
   GPRTAccel volume = surface_volume_tree_to_accel_map.at(tree);
   auto rayGen = rayGenPrograms_.at(RayGenType::RAY_FIRE);
@@ -293,20 +300,7 @@ std::pair<double, MeshID> GPRTRayTracer::ray_fire(SurfaceTreeID tree,
   ray[0].hitOrientation = orientation; // Set orientation for the ray
   ray[0].volume_tree = tree; // Set the TreeID of the volume being queried
 
-  if (exclude_primitives) {
-    if (!exclude_primitives->empty()) gprtBufferResize(context_, excludePrimitivesBuffer_, exclude_primitives->size(), false);
-    gprtBufferMap(excludePrimitivesBuffer_);
-    std::copy(exclude_primitives->begin(), exclude_primitives->end(), gprtBufferGetHostPointer(excludePrimitivesBuffer_));
-    gprtBufferUnmap(excludePrimitivesBuffer_);
-
-    ray[0].exclude_primitives = gprtBufferGetDevicePointer(excludePrimitivesBuffer_);
-    ray[0].exclude_count = exclude_primitives->size();
-  } 
-  else {
-    // If no primitives are excluded, set the pointer to null and count to 0
-    ray[0].exclude_primitives = nullptr;
-    ray[0].exclude_count = 0;
-  }
+  upload_exclude_primitives(ray[0], exclude_primitives);
   gprtBufferUnmap(rayHitBuffers_.ray); // required to sync buffer back on GPU?
   
   gprtRayGenLaunch1D(context_, rayGen, 1); // Launch raygen shader (entry point to RT pipeline)
@@ -323,10 +317,29 @@ std::pair<double, MeshID> GPRTRayTracer::ray_fire(SurfaceTreeID tree,
   if (surface == ID_NONE)
     return {INFTY, ID_NONE};
   else
-    if (exclude_primitives) exclude_primitives->push_back(primitive_id);
+    if (exclude_primitives) exclude_primitives->insert(primitive_id);
   return {distance, surface};
 }
                 
+MeshID GPRTRayTracer::find_volume(const Position& point,
+                                  const Direction& direction) const
+{
+  if (global_surface_accel_ == nullptr)
+    fatal_error("The global surface tree must be created before finding volumes");
+
+  // the first surface hit against the global tree determines the candidate volumes
+  auto [distance, surface] = ray_fire(global_surface_tree_, point, direction, INFTY, HitOrientation::ANY);
+  if (surface == ID_NONE) return ID_NONE;
+
+  // the hit normal is not returned by the ray fire shader, so the sense of the
+  // crossing is resolved with a point containment query on one side of the surface
+  auto [forward_vol, reverse_vol] = surface_parent_volumes_.at(surface);
+  auto forward_tree = volume_surface_tree_map_.find(forward_vol);
+  if (forward_tree == volume_surface_tree_map_.end()) return reverse_vol;
+  if (point_in_volume(forward_tree->second, point, &direction)) return forward_vol;
+  return reverse_vol;
+}
+
 void GPRTRayTracer::create_global_surface_tree()
 {
   // Create a TLAS (Top-Level Acceleration Structure) for all the volumes
@@ -4,6 +4,7 @@
 #include "xdg/error.h"
 #include "xdg/geometry/plucker.h"
 #include "xdg/geometry/face_common.h"
+#include "xdg/timer.h"
 #include "xdg/util/str_utils.h"
 
 #include "libmesh/boundary_info.h"
@@ -19,11 +20,14 @@ LibMeshManager::LibMeshManager(void *ptr) {}
 LibMeshManager::LibMeshManager() : MeshManager() {}
 
 void LibMeshManager::load_file(const std::string &filepath) {
+  ScopedTimer timer("load_file");
   mesh_ = std::make_unique<libMesh::Mesh>(*XDGConfig::config().libmesh_comm(), 3);
   mesh_->read(filepath);
 }
 
 void LibMeshManager::init() {
+  ScopedTimer timer("init");
+
   // ensure that the mesh is 3-dimensional, for our use case this is expected
   if (mesh_->mesh_dimension() != 3) {
     fatal_error("Mesh must be 3-dimensional");
@@ -116,6 +120,8 @@ void LibMeshManager::add_surface_to_volume(MeshID volume, MeshID surface, Sense
 }
 
 void LibMeshManager::parse_metadata() {
+  ScopedTimer timer("parse_metadata");
+
   // surface metadata
   auto boundary_info = mesh()->get_boundary_info();
   auto sideset_name_map = boundary_info.get_sideset_name_map();
@@ -354,6 +360,30 @@ LibMeshManager::element_vertices(MeshID element) const {
   return vertices;
 }
 
+std::array<Vertex, 4>
+LibMeshManager::tet_vertices(MeshID element) const {
+  auto elem = mesh()->elem_ptr(element);
+  std::array<Vertex, 4> vertices;
+  for (unsigned int i = 0; i < 4; ++i) {
+    const auto& node = elem->node_ref(i);
+    vertices[i] = {node(0), node(1), node(2)};
+  }
+  return vertices;
+}
+
+const std::array<std::array<int, 3>, 4>&
+LibMeshManager::tet_face_ordering() const {
+  // libMesh numbers the sides of a Tet4 by its side_nodes_map
+  static const std::array<std::array<int, 3>, 4> ordering = [] {
+    std::array<std::array<int, 3>, 4> o;
+    for (int i = 0; i < 4; ++i)
+      for (int j = 0; j < 3; ++j)
+        o[i][j] = libMesh::Tet4::side_nodes_map[i][j];
+    return o;
+  }();
+  return ordering;
+}
+
 std::array<Vertex, 3>
 LibMeshManager::face_vertices(MeshID element) const {
   const auto& side_pair = sidepair(element);
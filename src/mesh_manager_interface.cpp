@@ -7,7 +7,7 @@
 #include "xdg/error.h"
 #include "xdg/geometry/plucker.h"
 #include "xdg/geometry/face_common.h"
-#include "xdg/element_face_accessor.h"
+#include "xdg/stats.h"
 
 namespace xdg {
 
@@ -110,32 +110,22 @@ MeshManager::walk_elements(MeshID starting_element,
                            const Direction& u,
                            double distance) const
 {
-  // a copy of the start position that will be updated as elements are traversed
-  Position r = start;
   std::vector<std::pair<MeshID, double>> result;
-
-  MeshID elem = starting_element;
-  while (distance > 0) {
-    // find the exit point from the current element and determine the next element
-    // if one exists
-    auto exit = next_element(elem, r, u);
-    // ensure we are not traveling beyond the end of the ray
-    exit.second = std::min(exit.second, distance);
-    distance -= exit.second;
-    // only add to the result if the distance is greater than 0
-    result.push_back({elem, exit.second});
-    r += exit.second * u;
-    elem = exit.first;
-
-    // if there is no next element, we're exiting the mesh
-    if (elem == ID_NONE) {
-      break;
-    }
-  }
-
+  walk_elements(starting_element, start, u, distance, result);
   return result;
 }
 
+void
+MeshManager::walk_elements(MeshID starting_element,
+                           const Position& start,
+                           const Direction& u,
+                           double distance,
+                           std::vector<std::pair<MeshID, double>>& segments) const
+{
+  walk_elements(starting_element, start, u, distance,
+                [&segments](MeshID element, double dist) { segments.emplace_back(element, dist); });
+}
+
 std::vector<std::pair<MeshID, double>>
 MeshManager::walk_elements(MeshID starting_element,
                            const Position& start,
@@ -152,51 +142,28 @@ MeshManager::next_element(MeshID current_element,
                            const Position& r,
                            const Position& u) const
 {
-   std::array<double, 4> dists = {INFTY, INFTY, INFTY, INFTY};
-  std::array<bool, 4> hit_types;
-
-  auto element_face_accessor = ElementFaceAccessor::create(this, current_element);
-
-  // get the faces (triangles) of this element
-  for (int i = 0; i < 4; i++) {
-    // triangle connectivity
-    auto coords = element_face_accessor->face_vertices(i);
-
-    // get the normal of the triangle face
-    const Position normal = triangle_normal(coords);
-
-    // exiting hit only, assumes triangle normals point outward
-    // with respect to the element
-    int orientation = 1;
-    // perform ray-triangle intersection
-    hit_types[i] = plucker_ray_tri_intersect(coords,
-                                             r,
-                                             u,
-                                             dists[i],
-                                             INFTY,
-                                             nullptr,
-                                             &orientation);
-    // set distance and ensure it is non-negative
-    dists[i] = std::max(0.0, dists[i]);
-  }
+  XDG_STAT(ELEMENT_STEPS);
+  // fetch the element vertices once, all four faces are built from them
+  const std::array<Vertex, 4> vertices = this->tet_vertices(current_element);
 
-  // determine the minimum distance to exit and the face number
-  int idx_out = ID_NONE;
-  double min_dist = INFTY;
-  // choose the exiting face based on the minimum distance,
-  // if all distances are INFTY (no hit), then the index will
-  // not be updated
-  for (int i = 0; i < dists.size(); i++) {
-    if (dists[i] < min_dist) {
-      min_dist = dists[i];
-      idx_out = i;
-    }
-  }
+  // determine the exiting face and the distance to it, edges shared between
+  // faces are only tested once
+  double min_dist;
+  int idx_out = plucker_ray_tet_exit(vertices, this->tet_face_ordering(), r, u, min_dist);
+
+  if (idx_out == ID_NONE) return {ID_NONE, INFTY};
 
   MeshID next_element = this->adjacent_element(current_element, idx_out);
   return {next_element, min_dist};
 }
 
+std::array<Vertex, 4>
+MeshManager::tet_vertices(MeshID element) const
+{
+  auto vertices = this->element_vertices(element);
+  return {vertices[0], vertices[1], vertices[2], vertices[3]};
+}
+
 MeshID MeshManager::next_volume(MeshID current_volume, MeshID surface) const
 {
   auto parent_vols = this->get_parent_volumes(surface);
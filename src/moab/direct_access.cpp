@@ -1,12 +1,79 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 
 // MOAB
 #include "moab/Range.hpp"
 
 #include "xdg/moab/direct_access.h"
+#include "xdg/timer.h"
 
 namespace xdg {
 
+namespace {
+
+// Spread the lower 21 bits of a value so that there are two zero bits between
+// consecutive bits
+uint64_t spread_bits(uint64_t v)
+{
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffff;
+  v = (v | v << 16) & 0x1f0000ff0000ff;
+  v = (v | v << 8) & 0x100f00f00f00f00f;
+  v = (v | v << 4) & 0x10c30c30c30c30c3;
+  v = (v | v << 2) & 0x1249249249249249;
+  return v;
+}
+
+// Morton (Z-order) curve through the bounding box of a set of points, with
+// 2^21 cells along each axis
+class MortonCurve {
+public:
+  MortonCurve(const std::vector<double>& xyz) {
+    lower_.fill(std::numeric_limits<double>::max());
+    std::array<double, 3> upper;
+    upper.fill(std::numeric_limits<double>::lowest());
+    for (size_t i = 0; i < xyz.size(); i++) {
+      lower_[i % 3] = std::min(lower_[i % 3], xyz[i]);
+      upper[i % 3] = std::max(upper[i % 3], xyz[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+      double extent = upper[i] - lower_[i];
+      scale_[i] = extent > 0.0 ? MAX_CELL / extent : 0.0;
+    }
+  }
+
+  //! Position of a point along the curve
+  uint64_t code(const Vertex& p) const {
+    uint64_t code = 0;
+    for (int i = 0; i < 3; i++) {
+      double cell = std::clamp((p[i] - lower_[i]) * scale_[i], 0.0, MAX_CELL);
+      code |= spread_bits(static_cast<uint64_t>(cell)) << i;
+    }
+    return code;
+  }
+
+private:
+  static constexpr double MAX_CELL {(1 << 21) - 1};
+  std::array<double, 3> lower_;
+  std::array<double, 3> scale_;
+};
+
+// Indices of a set of items sorted by their codes, ties broken by index
+std::vector<int32_t> sort_order(const std::vector<uint64_t>& codes)
+{
+  std::vector<int32_t> order(codes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+    return codes[a] < codes[b] || (codes[a] == codes[b] && a < b);
+  });
+  return order;
+}
+
+} // namespace
+
 MBDirectAccess::MBDirectAccess(Interface* mbi)
 : mbi(mbi)
 {
@@ -17,10 +84,19 @@ MBDirectAccess::MBDirectAccess(Interface* mbi)
 
 void
 MBDirectAccess::setup() {
-  face_data_.setup(mbi);
-  element_data_.setup(mbi);
-  vertex_data_.setup(mbi);
-  element_adjacency_data_.setup(mbi);
+  // vertices first, element connectivity is stored as dense vertex indices
+  {
+    ScopedTimer timer("connectivity");
+    vertex_data_.setup(mbi);
+    face_data_.setup(mbi, vertex_data_);
+    element_data_.setup(mbi, vertex_data_);
+  }
+  if (reorder_) {
+    ScopedTimer timer("reorder");
+    reorder_slots();
+  }
+  ScopedTimer timer("adjacency");
+  element_adjacency_data_.setup(element_data_, vertex_data_.num_vertices);
 }
 
 void
@@ -38,4 +114,184 @@ MBDirectAccess::update() {
   setup();
 }
 
+void
+MBDirectAccess::reorder_slots()
+{
+  if (vertex_data_.num_vertices <= 0) return;
+  MortonCurve curve(vertex_data_.xyz);
+
+  std::vector<uint64_t> codes(vertex_data_.num_vertices);
+  #pragma omp parallel for
+  for (int32_t i = 0; i < vertex_data_.num_vertices; i++) codes[i] = curve.code(vertex_data_.coords(i));
+  auto vertex_order = sort_order(codes);
+  vertex_data_.permute(vertex_order);
+
+  std::vector<int32_t> new_vertex_index(vertex_order.size());
+  for (size_t i = 0; i < vertex_order.size(); i++) new_vertex_index[vertex_order[i]] = i;
+
+  // elements are ordered by their centroids, using the reordered vertices
+  for (auto data : {&face_data_, &element_data_}) {
+    data->remap_vertices(new_vertex_index);
+    if (data->num_entities <= 0) continue;
+
+    codes.resize(data->num_entities);
+    #pragma omp parallel for
+    for (int32_t s = 0; s < data->num_entities; s++) {
+      const int32_t* conn = data->connectivity_of(s);
+      Vertex centroid {0.0, 0.0, 0.0};
+      for (int i = 0; i < data->element_stride; i++) centroid += vertex_data_.coords(conn[i]);
+      codes[s] = curve.code(centroid / static_cast<double>(data->element_stride));
+    }
+    data->permute(sort_order(codes));
+  }
+}
+
+void
+MBDirectAccess::save_snapshot(SnapshotWriter& writer) const
+{
+  writer.add_value("reordered", reorder_);
+  writer.add_value("vertex.num_vertices", vertex_data_.num_vertices);
+  vertex_data_.slots.save(writer, "vertex.slots");
+  writer.add("vertex.xyz", vertex_data_.xyz);
+
+  for (const auto& [prefix, data] : {std::make_pair("face", &face_data_), std::make_pair("element", &element_data_)}) {
+    std::string p(prefix);
+    writer.add_value(p + ".num_entities", data->num_entities);
+    writer.add_value(p + ".element_stride", data->element_stride);
+    data->slots.save(writer, p + ".slots");
+    writer.add(p + ".connectivity", data->connectivity);
+  }
+
+  writer.add_value("adjacency.num_entities", element_adjacency_data_.num_entities);
+  writer.add_value("adjacency.faces_per_element", element_adjacency_data_.faces_per_element);
+  writer.add("adjacency.neighbors", element_adjacency_data_.neighbors);
+}
+
+bool
+MBDirectAccess::load_snapshot(const SnapshotReader& reader)
+{
+  clear();
+
+  bool loaded = reader.read_value("vertex.num_vertices", vertex_data_.num_vertices) &&
+                vertex_data_.slots.load(reader, "vertex.slots") &&
+                reader.read("vertex.xyz", vertex_data_.xyz);
+
+  for (auto [prefix, data] : {std::make_pair("face", &face_data_), std::make_pair("element", &element_data_)}) {
+    std::string p(prefix);
+    loaded = loaded &&
+             reader.read_value(p + ".num_entities", data->num_entities) &&
+             reader.read_value(p + ".element_stride", data->element_stride) &&
+             data->slots.load(reader, p + ".slots") &&
+             reader.read(p + ".connectivity", data->connectivity);
+  }
+
+  loaded = loaded &&
+           reader.read_value("adjacency.num_entities", element_adjacency_data_.num_entities) &&
+           reader.read_value("adjacency.faces_per_element", element_adjacency_data_.faces_per_element) &&
+           reader.read("adjacency.neighbors", element_adjacency_data_.neighbors);
+
+  // snapshots written before renumbering was available are in MOAB order
+  bool reordered = false;
+  reader.read_value("reordered", reordered);
+  loaded = loaded && reordered == reorder_;
+
+  // the snapshot must describe the entities currently in the MOAB instance
+  if (loaded) {
+    Range verts, faces, elements;
+    mbi->get_entities_by_dimension(0, 0, verts, true);
+    mbi->get_entities_by_type(0, face_data_.entity_type, faces, true);
+    mbi->get_entities_by_type(0, element_data_.entity_type, elements, true);
+    loaded = vertex_data_.slots.matches(verts) &&
+             vertex_data_.xyz.size() == 3 * verts.size() &&
+             face_data_.slots.matches(faces) &&
+             face_data_.connectivity.size() == static_cast<size_t>(std::max(face_data_.element_stride, 0)) * faces.size() &&
+             element_data_.slots.matches(elements) &&
+             element_data_.connectivity.size() == static_cast<size_t>(std::max(element_data_.element_stride, 0)) * elements.size() &&
+             element_adjacency_data_.neighbors.size() ==
+               static_cast<size_t>(element_adjacency_data_.faces_per_element) * elements.size();
+  }
+
+  if (!loaded) clear();
+  return loaded;
+}
+
+void
+MBDirectAccess::AdjacencyData::setup(const ConnectivityData& element_data, int n_vertices)
+{
+  clear();
+  num_entities = std::max(element_data.num_entities, 0);
+  const auto& ord = ordering.at(entity_type);
+  faces_per_element = ord.size();
+  const int64_t n_faces = static_cast<int64_t>(num_entities) * faces_per_element;
+  neighbors.assign(n_faces, ID_NONE);
+  if (n_faces == 0) return;
+
+  // vertices of an element face, sorted so that shared faces compare equal
+  auto face_key = [&](int64_t face) {
+    const int32_t* conn = element_data.connectivity_of(face / faces_per_element);
+    const auto& o = ord[face % faces_per_element];
+    std::array<int32_t, 3> key {conn[o[0]], conn[o[1]], conn[o[2]]};
+    std::sort(key.begin(), key.end());
+    return key;
+  };
+
+  // Bucket the faces by their lowest vertex index (a counting sort). Faces
+  // shared by two elements land in the same bucket, so each bucket can then
+  // be sorted and matched independently.
+  std::vector<int64_t> bucket_offsets(static_cast<size_t>(n_vertices) + 1, 0);
+  #pragma omp parallel for
+  for (int64_t face = 0; face < n_faces; face++) {
+    int32_t v = face_key(face)[0];
+    #pragma omp atomic
+    bucket_offsets[v + 1]++;
+  }
+  for (int i = 0; i < n_vertices; i++) bucket_offsets[i + 1] += bucket_offsets[i];
+
+  std::vector<int64_t> bucket_faces(n_faces);
+  std::vector<int64_t> bucket_fill(bucket_offsets.begin(), bucket_offsets.end() - 1);
+  #pragma omp parallel for
+  for (int64_t face = 0; face < n_faces; face++) {
+    int32_t v = face_key(face)[0];
+    int64_t pos;
+    #pragma omp atomic capture
+    pos = bucket_fill[v]++;
+    bucket_faces[pos] = face;
+  }
+  bucket_fill = std::vector<int64_t>();
+
+  bool non_manifold = false;
+  #pragma omp parallel
+  {
+    std::vector<std::pair<std::array<int32_t, 3>, int64_t>> keys;
+    #pragma omp for schedule(dynamic, 1024) reduction(||:non_manifold)
+    for (int v = 0; v < n_vertices; v++) {
+      keys.clear();
+      for (int64_t i = bucket_offsets[v]; i < bucket_offsets[v + 1]; i++) {
+        keys.push_back({face_key(bucket_faces[i]), bucket_faces[i]});
+      }
+      std::sort(keys.begin(), keys.end());
+
+      // there can be at most two elements adjacent to a face, one element
+      // means that the face is on the boundary
+      for (size_t i = 0; i < keys.size();) {
+        size_t j = i + 1;
+        while (j < keys.size() && keys[j].first == keys[i].first) j++;
+        if (j - i == 2) {
+          int64_t f0 = keys[i].second;
+          int64_t f1 = keys[i + 1].second;
+          neighbors[f0] = f1 / faces_per_element;
+          neighbors[f1] = f0 / faces_per_element;
+        } else if (j - i > 2) {
+          non_manifold = true;
+        }
+        i = j;
+      }
+    }
+  }
+
+  if (non_manifold) {
+    throw std::runtime_error("Found an element face shared by more than two elements");
+  }
+}
+
 } // namespace xdg
\ No newline at end of file
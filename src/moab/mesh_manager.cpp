@@ -11,6 +11,8 @@
 #include "xdg/geometry/face_common.h"
 #include "xdg/geometry/measure.h"
 #include "xdg/moab/tag_conventions.h"
+#include "xdg/timer.h"
+#include "xdg/util/snapshot.h"
 #include "xdg/util/str_utils.h"
 #include "xdg/vec3da.h"
 
@@ -34,8 +36,10 @@ MOABMeshManager::MOABMeshManager(moab::Interface* mbi) : moab_raw_ptr_(mbi)
 };
 
 void MOABMeshManager::init() {
+  ScopedTimer timer("init");
+
   // initialize the direct access manager
-  this->mb_direct()->setup();
+  this->setup_direct_access();
 
   // ensure all of the necessary tag handles exist
   this->setup_tags();
@@ -84,6 +88,39 @@ void MOABMeshManager::init() {
   MeshID ipc = create_implicit_complement();
 }
 
+void MOABMeshManager::setup_direct_access()
+{
+  ScopedTimer timer("direct_access");
+
+  if (snapshot_cache_dir_.empty() || loaded_files_.size() != 1) {
+    this->mb_direct()->setup();
+    return;
+  }
+
+  uint64_t key;
+  try {
+    key = snapshot::hash_file(loaded_files_[0]);
+  } catch (const std::runtime_error& e) {
+    warning(e.what());
+    this->mb_direct()->setup();
+    return;
+  }
+  // renumbered and plain tables are cached side by side
+  std::string variant = this->mb_direct()->reorder() ? "reordered" : "";
+  std::string snapshot_path = snapshot::cache_path(snapshot_cache_dir_, key, variant);
+
+  SnapshotReader reader;
+  if (reader.open(snapshot_path, key) && this->mb_direct()->load_snapshot(reader)) return;
+  reader.close();
+
+  this->mb_direct()->setup();
+  SnapshotWriter writer(key);
+  this->mb_direct()->save_snapshot(writer);
+  if (!writer.write(snapshot_path)) {
+    warning(fmt::format("Failed to write mesh snapshot {}", snapshot_path));
+  }
+}
+
 void MOABMeshManager::setup_tags() {
   // all of the tags are sparse and should be created if they don't exist
   auto tag_flags = moab::MB_TAG_SPARSE | moab::MB_TAG_CREAT;
@@ -120,7 +157,9 @@ void MOABMeshManager::setup_tags() {
 // Methods
 void MOABMeshManager::load_file(const std::string& filepath)
 {
+  ScopedTimer timer("load_file");
   this->moab_interface()->load_file(filepath.c_str());
+  loaded_files_.push_back(filepath);
 }
 
 int MOABMeshManager::num_volumes() const
@@ -300,18 +339,25 @@ MOABMeshManager::get_surface_faces(MeshID surface) const
 
 std::vector<Vertex> MOABMeshManager::element_vertices(MeshID element) const
 {
-  moab::EntityHandle element_handle;
-  this->moab_interface()->handle_from_id(moab::MBTET, element, element_handle);
-  auto out = this->mb_direct()->get_element_coords(element_handle);
+  auto out = this->mb_direct()->get_element_coords_by_id(element);
   return std::vector<Vertex>(out.begin(), out.end());
 }
 
+std::array<Vertex, 4> MOABMeshManager::tet_vertices(MeshID element) const
+{
+  return this->mb_direct()->get_element_coords_by_id(element);
+}
+
+const std::array<std::array<int, 3>, 4>& MOABMeshManager::tet_face_ordering() const
+{
+  // must match the MBTET face ordering used for adjacencies in MBDirectAccess
+  static const std::array<std::array<int, 3>, 4> ordering {{{0, 1, 3}, {1, 2, 3}, {2, 0, 3}, {0, 2, 1}}};
+  return ordering;
+}
+
 std::array<Vertex, 3> MOABMeshManager::face_vertices(MeshID element) const
 {
-  moab::EntityHandle element_handle;
-  this->moab_interface()->handle_from_id(moab::MBTRI, element, element_handle);
-  auto out = this->mb_direct()->get_mb_coords(element_handle);
-  return out;
+  return this->mb_direct()->get_face_coords(element);
 }
 
 std::pair<MeshID, MeshID>
@@ -426,25 +472,21 @@ MOABMeshManager::get_surface_element_type(MeshID surface) const
 MeshID
 MOABMeshManager::adjacent_element(MeshID element, int face) const
 {
-  moab::EntityHandle element_handle;
-  this->moab_interface()->handle_from_id(moab::MBTET, element, element_handle);
-  moab::EntityHandle next_element = this->mb_direct()->get_adjacent_element(element_handle, face);
-  if (next_element == ID_NONE) return ID_NONE;
-  return this->moab_interface()->id_from_handle(next_element);
+  return this->mb_direct()->get_adjacent_element_by_id(element, face);
 }
 
 double
 MOABMeshManager::element_volume(MeshID element) const
 {
-  moab::EntityHandle element_handle;
-  this->moab_interface()->handle_from_id(moab::MBTET, element, element_handle);
-  std::array<xdg::Vertex, 4> verts = this->mb_direct()->get_element_coords(element_handle);
+  std::array<xdg::Vertex, 4> verts = this->mb_direct()->get_element_coords_by_id(element);
   return tetrahedron_volume(verts);
 }
 
 void
 MOABMeshManager::parse_metadata()
 {
+  ScopedTimer timer("parse_metadata");
+
   // loop over all groups
   moab::Range groups;
 
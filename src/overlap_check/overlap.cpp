@@ -20,7 +20,7 @@ void check_location_for_overlap(std::shared_ptr<XDG> xdg,
 
   for (const auto& vol : allVols) {
     bool pointInVol = false;
-    pointInVol = xdg->point_in_volume(vol, loc, &dir, nullptr);
+    pointInVol = xdg->point_in_volume(vol, loc, &dir);
 
     if (pointInVol) {
       vols_found.insert(vol);
@@ -42,7 +42,7 @@ void check_location_for_overlap(std::shared_ptr<XDG> xdg,
 
   for (const auto& vol : allVols) {
 		bool pointInVol = false;
-    pointInVol = xdg->point_in_volume(vol, loc, &dir, nullptr);
+    pointInVol = xdg->point_in_volume(vol, loc, &dir);
 
     if (pointInVol) {
       vols_found.insert(vol);
@@ -17,6 +17,91 @@ ElementTreeID RayTracer::next_element_tree_id()
   return ++next_element_tree_id_;
 }
 
+std::vector<std::pair<TreeID, TreeID>>
+RayTracer::register_volumes(const std::shared_ptr<MeshManager>& mesh_manager,
+                            const std::vector<MeshID>& volumes)
+{
+  std::vector<std::pair<TreeID, TreeID>> trees;
+  trees.reserve(volumes.size());
+  for (auto volume : volumes) {
+    trees.push_back(register_volume(mesh_manager, volume));
+  }
+  return trees;
+}
+
+bool RayTracer::point_in_volume(TreeID tree,
+                                const Position& point,
+                                const Direction* direction,
+                                const std::vector<MeshID>* exclude_primitives) const
+{
+  if (!exclude_primitives) return point_in_volume(tree, point, direction);
+
+  ExclusionSet exclude(exclude_primitives->begin(), exclude_primitives->end());
+  return point_in_volume(tree, point, direction, &exclude);
+}
+
+bool RayTracer::point_in_volume(TreeID tree,
+                                const Position& point,
+                                const Direction* direction,
+                                QueryContext& context) const
+{
+  return point_in_volume(tree, point, direction, &context.exclude_primitives);
+}
+
+std::pair<double, MeshID> RayTracer::ray_fire(TreeID tree,
+                                              const Position& origin,
+                                              const Direction& direction,
+                                              const double dist_limit,
+                                              HitOrientation orientation,
+                                              std::vector<MeshID>* const exclude_primitives) const
+{
+  if (!exclude_primitives) return ray_fire(tree, origin, direction, dist_limit, orientation);
+
+  ExclusionSet exclude(exclude_primitives->begin(), exclude_primitives->end());
+  auto hit = ray_fire(tree, origin, direction, dist_limit, orientation, &exclude);
+  if (hit.second != ID_NONE) exclude_primitives->push_back(exclude.back());
+  return hit;
+}
+
+std::pair<double, MeshID> RayTracer::ray_fire(TreeID tree,
+                                              const Position& origin,
+                                              const Direction& direction,
+                                              QueryContext& context,
+                                              const double dist_limit,
+                                              HitOrientation orientation) const
+{
+  return ray_fire(tree, origin, direction, dist_limit, orientation, &context.exclude_primitives);
+}
+
+void RayTracer::ray_fire(TreeID tree,
+                         const Position* origins,
+                         const Direction* directions,
+                         size_t n_rays,
+                         std::pair<double, MeshID>* hits,
+                         const double dist_limit,
+                         HitOrientation orientation,
+                         ExclusionSet* const exclude_primitives) const
+{
+  for (size_t i = 0; i < n_rays; i++) {
+    ExclusionSet* exclude = exclude_primitives ? exclude_primitives + i : nullptr;
+    hits[i] = ray_fire(tree, origins[i], directions[i], dist_limit, orientation, exclude);
+  }
+}
+
+const std::vector<std::pair<double, MeshID>>&
+RayTracer::ray_fire(TreeID tree,
+                    const Position* origins,
+                    const Direction* directions,
+                    size_t n_rays,
+                    QueryContext& context,
+                    const double dist_limit,
+                    HitOrientation orientation) const
+{
+  context.hits.resize(n_rays);
+  ray_fire(tree, origins, directions, n_rays, context.hits.data(), dist_limit, orientation);
+  return context.hits;
+}
+
 const double RayTracer::bounding_box_bump(const std::shared_ptr<MeshManager> mesh_manager, MeshID volume_id)
 {
   auto volume_bounding_box = mesh_manager->volume_bounding_box(volume_id);
@@ -0,0 +1,115 @@
+#include <mutex>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include "xdg/stats.h"
+
+namespace xdg {
+
+namespace stats {
+
+namespace {
+
+// Counters of every live thread and the totals of threads that have exited.
+// Resetting records the current value of each thread's counters as a baseline
+// rather than writing to counters owned by other threads.
+struct Registry {
+  std::mutex mutex;
+  std::unordered_map<const detail::ThreadCounters*, std::array<uint64_t, N_COUNTERS>> baselines;
+  std::array<uint64_t, N_COUNTERS> retired {};
+};
+
+Registry& registry()
+{
+  // never destroyed so that thread counters released during program exit can
+  // still retire their values
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+} // namespace
+
+const char* counter_name(Counter counter)
+{
+  switch (counter) {
+    case Counter::RAY_FIRE: return "ray_fire";
+    case Counter::POINT_IN_VOLUME: return "point_in_volume";
+    case Counter::CLOSEST: return "closest";
+    case Counter::OCCLUDED: return "occluded";
+    case Counter::FIND_ELEMENT: return "find_element";
+    case Counter::TRIANGLE_TESTS: return "triangle_tests";
+    case Counter::TRIANGLE_HITS: return "triangle_hits";
+    case Counter::ORIENTATION_CULLS: return "orientation_culls";
+    case Counter::EXCLUSION_CULLS: return "exclusion_culls";
+    case Counter::VOLUME_CULLS: return "volume_culls";
+    case Counter::OCCLUSION_TESTS: return "occlusion_tests";
+    case Counter::ELEMENT_TESTS: return "element_tests";
+    case Counter::ELEMENT_STEPS: return "element_steps";
+    case Counter::SEGMENT_QUERIES: return "segment_queries";
+    case Counter::SEGMENTS: return "segments";
+    default: return "unknown";
+  }
+}
+
+std::string Snapshot::to_json() const
+{
+  std::string json = "{";
+  for (size_t i = 0; i < N_COUNTERS; i++) {
+    json += fmt::format("{}\"{}\": {}", i == 0 ? "" : ", ", counter_name(static_cast<Counter>(i)), values[i]);
+  }
+  json += "}";
+  return json;
+}
+
+Snapshot snapshot()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  Snapshot result;
+  result.values = reg.retired;
+  for (const auto& [counters, baseline] : reg.baselines) {
+    for (size_t i = 0; i < N_COUNTERS; i++) {
+      result.values[i] += counters->values[i].load(std::memory_order_relaxed) - baseline[i];
+    }
+  }
+  return result;
+}
+
+void reset()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.retired.fill(0);
+  for (auto& [counters, baseline] : reg.baselines) {
+    for (size_t i = 0; i < N_COUNTERS; i++) {
+      baseline[i] = counters->values[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+namespace detail {
+
+ThreadCounters::ThreadCounters()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.baselines[this] = {};
+}
+
+ThreadCounters::~ThreadCounters()
+{
+  auto& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  const auto& baseline = reg.baselines.at(this);
+  for (size_t i = 0; i < N_COUNTERS; i++) {
+    reg.retired[i] += values[i].load(std::memory_order_relaxed) - baseline[i];
+  }
+  reg.baselines.erase(this);
+}
+
+} // namespace detail
+
+} // namespace stats
+
+} // namespace xdg
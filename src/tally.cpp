@@ -0,0 +1,109 @@
+#include "xdg/tally.h"
+
+#include <algorithm>
+
+#ifdef XDG_HAVE_OPENMP
+#include "omp.h"
+#endif
+
+#include "xdg/error.h"
+#include "xdg/timer.h"
+#include "xdg/xdg.h"
+
+namespace xdg {
+
+MeshTally::MeshTally(std::shared_ptr<XDG> xdg, int n_groups)
+  : xdg_(xdg), n_groups_(n_groups)
+{
+  if (n_groups_ < 1) fatal_error("Mesh tally must have at least one group, got {}", n_groups_);
+
+  const auto& mesh_manager = xdg_->mesh_manager();
+  for (auto volume : mesh_manager->volumes()) {
+    for (auto element : mesh_manager->get_volume_elements(volume)) {
+      if (element_index_.contains(element)) continue;
+      element_index_[element] = elements_.size();
+      elements_.push_back(element);
+    }
+  }
+  results_.assign(elements_.size() * n_groups_, 0.0);
+}
+
+void MeshTally::score(const Position* starts,
+                      const Position* ends,
+                      const double* weights,
+                      const int* groups,
+                      size_t n_tracks)
+{
+  ScopedTimer timer("mesh_tally");
+
+  if (groups == nullptr && n_groups_ > 1)
+    fatal_error("Groups must be provided for a mesh tally with {} groups", n_groups_);
+  for (size_t i = 0; groups && i < n_tracks; i++) {
+    if (groups[i] < 0 || groups[i] >= n_groups_)
+      fatal_error("Track {} has group {}, outside of the {} groups of the mesh tally", i, groups[i], n_groups_);
+  }
+
+  xdg_->segments(starts, ends, n_tracks, batch_);
+
+#ifdef XDG_HAVE_OPENMP
+  size_t n_threads = omp_get_max_threads();
+#else
+  size_t n_threads = 1;
+#endif
+  if (thread_results_.size() < n_threads) thread_results_.resize(n_threads);
+
+  const size_t n_bins = results_.size();
+  #pragma omp parallel
+  {
+#ifdef XDG_HAVE_OPENMP
+    auto& bins = thread_results_[omp_get_thread_num()];
+#else
+    auto& bins = thread_results_[0];
+#endif
+    if (bins.size() != n_bins) bins.assign(n_bins, 0.0);
+
+    #pragma omp for schedule(dynamic, 64)
+    for (size_t i = 0; i < n_tracks; i++) {
+      int group = groups ? groups[i] : 0;
+      double weight = weights[i];
+      for (size_t j = batch_.offsets[i]; j < batch_.offsets[i + 1]; j++) {
+        // segments outside of the tally elements are not scored
+        auto it = element_index_.find(batch_.elements[j]);
+        if (it == element_index_.end()) continue;
+        bins[it->second * n_groups_ + group] += weight * batch_.lengths[j];
+      }
+    }
+
+    // reduce the thread bins into the results, each thread summing a range of
+    // bins across all threads and clearing them for the next batch
+    #pragma omp for schedule(static)
+    for (size_t bin = 0; bin < n_bins; bin++) {
+      double sum = 0.0;
+      for (auto& thread_bins : thread_results_) {
+        if (thread_bins.empty()) continue;
+        sum += thread_bins[bin];
+        thread_bins[bin] = 0.0;
+      }
+      results_[bin] += sum;
+    }
+  }
+}
+
+void MeshTally::reset()
+{
+  std::fill(results_.begin(), results_.end(), 0.0);
+}
+
+double MeshTally::result(MeshID element, int group) const
+{
+  if (group < 0 || group >= n_groups_)
+    fatal_error("Group {} is outside of the {} groups of the mesh tally", group, n_groups_);
+  return results_.at(element_index_.at(element) * n_groups_ + group);
+}
+
+double MeshTally::flux(MeshID element, int group) const
+{
+  return result(element, group) / xdg_->mesh_manager()->element_volume(element);
+}
+
+} // namespace xdg
@@ -1,6 +1,11 @@
 #include "xdg/constants.h"
+#include "xdg/geometry_data.h"
+#include "xdg/mesh_manager_interface.h"
+#include "xdg/primitive_ref.h"
 #include "xdg/ray_tracing_interface.h"
 #include "xdg/ray.h"
+#include "xdg/stats.h"
+#include "xdg/tetrahedron_contain.h"
 #include "xdg/vec3da.h"
 
 #include "xdg/util/linalg.h"
@@ -8,11 +13,10 @@
 namespace xdg
 {
 
-bool plucker_tet_containment_test(const Position& point,
-                                  const Position& v0,
-                                  const Position& v1,
-                                  const Position& v2,
-                                  const Position& v3) {
+TetTransform tet_barycentric_transform(const Position& v0,
+                                       const Position& v1,
+                                       const Position& v2,
+                                       const Position& v3) {
     using namespace linalg::aliases;
     // Create matrix T = [v1 - v0, v2 - v0, v3 - v0]
     Vec3da e0 = v1 - v0;
@@ -21,12 +25,29 @@ bool plucker_tet_containment_test(const Position& point,
     double3x3 T = { {e0.x, e0.y, e0.z},
                    {e1.x, e1.y, e1.z},
                    {e2.x, e2.y, e2.z}};
+    double3x3 T_inv = inverse(T);
+
+    TetTransform transform;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) transform[3 * i + j] = T_inv[i][j];
+        transform[9 + i] = v0[i];
+    }
+    return transform;
+}
+
+bool tet_transform_containment_test(const Position& point,
+                                    const double* transform,
+                                    double* barycentrics) {
+    using namespace linalg::aliases;
+    double3x3 T_inv = { {transform[0], transform[1], transform[2]},
+                       {transform[3], transform[4], transform[5]},
+                       {transform[6], transform[7], transform[8]}};
 
     // Vector from v0 to point
-    Vec3da rhs = point - v0;
+    double3 rhs = {point.x - transform[9], point.y - transform[10], point.z - transform[11]};
 
     // Solve T * [λ1, λ2, λ3] = rhs
-    double3 lambda123 = mul(inverse(T),{rhs.x, rhs.y, rhs.z});
+    double3 lambda123 = mul(T_inv, rhs);
 
     // Compute λ0
     double lambda0 = 1.0f - (lambda123.x + lambda123.y + lambda123.z);
@@ -34,14 +55,44 @@ bool plucker_tet_containment_test(const Position& point,
     // Final barycentric coordinate vector
     double4 bary = { lambda0, lambda123.x, lambda123.y, lambda123.z };
 
-    // Check all λ_i in [0, 1]
+    // Check all λ_i in [0, 1], written so that the NaN coordinates of a
+    // degenerate tetrahedron fail the test
     for (int i = 0; i < 4; ++i) {
-        if (bary[i] < -PLUCKER_ZERO_TOL || bary[i] > 1.0f + PLUCKER_ZERO_TOL)
+        if (!(bary[i] >= -PLUCKER_ZERO_TOL && bary[i] <= 1.0f + PLUCKER_ZERO_TOL))
             return false;
     }
+    if (barycentrics) {
+        for (int i = 0; i < 4; ++i) barycentrics[i] = bary[i];
+    }
     return true;
 }
 
+bool plucker_tet_containment_test(const Position& point,
+                                  const Position& v0,
+                                  const Position& v1,
+                                  const Position& v2,
+                                  const Position& v3) {
+    TetTransform transform = tet_barycentric_transform(v0, v1, v2, v3);
+    return tet_transform_containment_test(point, transform.data());
+}
+
+// Containment test of the element in a slot of an element geometry, using the
+// baked barycentric transform if present. The barycentric coordinates of the
+// point are written to barycentrics if provided and the point is inside.
+inline bool element_contains(const VolumeElementsUserData* user_data,
+                             unsigned int primID,
+                             const Position& point,
+                             double* barycentrics = nullptr) {
+  XDG_STAT(ELEMENT_TESTS);
+  if (!user_data->baked_elements.empty())
+    return tet_transform_containment_test(point, user_data->baked_elements.transform(primID), barycentrics);
+
+  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[primID];
+  auto vertices = user_data->mesh_manager->tet_vertices(primitive_ref.primitive_id);
+  TetTransform transform = tet_barycentric_transform(vertices[0], vertices[1], vertices[2], vertices[3]);
+  return tet_transform_containment_test(point, transform.data(), barycentrics);
+}
+
 // Embree callbacks
 
 void VolumeElementBoundsFunc(RTCBoundsFunctionArguments* args)
@@ -64,11 +115,6 @@ void VolumeElementBoundsFunc(RTCBoundsFunctionArguments* args)
 
 void TetrahedronIntersectionFunc(RTCIntersectFunctionNArguments* args) {
   const VolumeElementsUserData* user_data = (const VolumeElementsUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
-  // TODO: Update this!
-  const PrimitiveRef primitive_ref = user_data->prim_ref_buffer[args->primID];
-  auto vertices = mesh_manager->element_vertices(primitive_ref.primitive_id);
 
   RTCDualRayHit* rayhit = (RTCDualRayHit*)args->rayhit;
   RTCSurfaceDualRay& ray = rayhit->ray;
@@ -77,9 +123,7 @@ void TetrahedronIntersectionFunc(RTCIntersectFunctionNArguments* args) {
   Position ray_origin = {ray.dorg[0], ray.dorg[1], ray.dorg[2]};
 
   // check the containment of the point
-  bool inside = plucker_tet_containment_test(ray_origin, vertices[0], vertices[1], vertices[2], vertices[3]);
-
-  if (!inside) return;
+  if (!element_contains(user_data, args->primID, ray_origin)) return;
   // zero out the hit information
   rayhit->hit.u = 0.0;
   rayhit->hit.v = 0.0;
@@ -94,22 +138,15 @@ void TetrahedronIntersectionFunc(RTCIntersectFunctionNArguments* args) {
 void TetrahedronOcclusionFunc(RTCOccludedFunctionNArguments* args)
 {
   const VolumeElementsUserData* user_data = (const VolumeElementsUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
-  const PrimitiveRef primitive_ref = user_data->prim_ref_buffer[args->primID];
-
-  auto vertices = mesh_manager->element_vertices(primitive_ref.primitive_id);
 
   RTCElementDualRay* ray = (RTCElementDualRay*)args->ray;
   Position ray_origin = {ray->dorg[0], ray->dorg[1], ray->dorg[2]};
 
   // check the containment of the point
-  bool inside = plucker_tet_containment_test(ray_origin, vertices[0], vertices[1], vertices[2], vertices[3]);
-
-  if (!inside) return;
+  if (!element_contains(user_data, args->primID, ray_origin, ray->barycentrics.data())) return;
 
   // set the hit information
-  ray->element = primitive_ref.primitive_id;
+  ray->element = user_data->prim_ref_buffer[args->primID].primitive_id;
   ray->set_tfar(-INFTY);
 }
 
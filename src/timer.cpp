@@ -1,7 +1,38 @@
 #include "xdg/timer.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include <fmt/format.h>
+
 namespace xdg {
 
+//==============================================================================
+// Global variables
+//==============================================================================
+
+namespace {
+
+// Accumulated time of each scope, keyed by the names of the enclosing scopes
+struct TimerRegistry {
+  std::mutex mutex;
+  std::map<std::vector<std::string>, TimerRecord> records;
+};
+
+TimerRegistry& timer_registry()
+{
+  static TimerRegistry registry;
+  return registry;
+}
+
+// Names of the scopes currently being timed on this thread
+thread_local std::vector<std::string> scope_stack;
+
+std::atomic<unsigned> sample_interval {0};
+
+} // namespace
+
 //==============================================================================
 // Timer implementation
 //==============================================================================
@@ -34,4 +65,115 @@ double Timer::elapsed()
   }
 }
 
+//==============================================================================
+// ScopedTimer implementation
+//==============================================================================
+
+ScopedTimer::ScopedTimer(const std::string& name)
+  : ScopedTimer(name.c_str(), true)
+{}
+
+ScopedTimer::ScopedTimer(const char* name, bool active)
+  : active_(active)
+{
+  if (!active_) return;
+  scope_stack.push_back(name);
+  timer_.start();
+}
+
+ScopedTimer::~ScopedTimer()
+{
+  if (!active_) return;
+  timer_.stop();
+
+  auto& registry = timer_registry();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto& record = registry.records[scope_stack];
+    record.calls += calls_;
+    record.samples++;
+    record.elapsed += timer_.elapsed();
+  }
+  scope_stack.pop_back();
+}
+
+// Whether or not the current call of a sampled scope should be timed
+static bool sample_call(unsigned& counter)
+{
+  unsigned interval = sample_interval.load(std::memory_order_relaxed);
+  if (interval == 0) return false;
+  return ++counter % interval == 0;
+}
+
+SampledScopedTimer::SampledScopedTimer(const char* name, unsigned& counter)
+  : ScopedTimer(name, sample_call(counter))
+{
+  calls_ = sample_interval.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Non-member functions
+//==============================================================================
+
+std::string TimerRecord::name() const
+{
+  std::string result;
+  for (const auto& scope : path) {
+    if (!result.empty()) result += "/";
+    result += scope;
+  }
+  return result;
+}
+
+void set_timer_sample_interval(unsigned interval)
+{
+  sample_interval = interval;
+}
+
+unsigned timer_sample_interval()
+{
+  return sample_interval;
+}
+
+std::vector<TimerRecord> timer_records()
+{
+  auto& registry = timer_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  std::vector<TimerRecord> records;
+  for (const auto& [path, record] : registry.records) {
+    records.push_back(record);
+    records.back().path = path;
+  }
+  return records;
+}
+
+void print_timer_summary(std::ostream& out)
+{
+  auto records = timer_records();
+  if (records.empty()) return;
+
+  out << fmt::format("{:<48} {:>12} {:>14} {:>14}\n", "timer", "calls", "total (s)", "mean (ms)");
+  bool sampled = false;
+  for (const auto& record : records) {
+    // nested scopes are indented below their parent
+    std::string name = std::string(2 * (record.path.size() - 1), ' ') + record.path.back();
+    if (record.samples < record.calls) {
+      name += " *";
+      sampled = true;
+    }
+    out << fmt::format("{:<48} {:>12} {:>14.4f} {:>14.4f}\n", name, record.calls, record.total(),
+                       1e3 * record.total() / record.calls);
+  }
+  if (sampled) {
+    out << "* sampled, calls and times are estimated from the timed calls\n";
+  }
+}
+
+void reset_timers()
+{
+  auto& registry = timer_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.records.clear();
+}
+
 } // namespace xdg
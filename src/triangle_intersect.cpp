@@ -1,10 +1,11 @@
-#include <algorithm> // for find
+#include <algorithm>
 
 #include "xdg/geometry/closest.h"
 #include "xdg/primitive_ref.h"
 #include "xdg/geometry_data.h"
 #include "xdg/geometry/plucker.h"
 #include "xdg/ray.h"
+#include "xdg/stats.h"
 
 namespace xdg
 {
@@ -23,14 +24,118 @@ bool orientation_cull(const Direction& ray_dir, const Direction& normal, HitOrie
   return false;
 }
 
+// Vertices of a surface primitive, read from the baked triangle data if present
+inline std::array<Vertex, 3> primitive_vertices(const SurfaceUserData* user_data, unsigned int primID)
+{
+  if (!user_data->baked_triangles.empty()) return user_data->baked_triangles.triangle_vertices(primID);
+  return user_data->mesh_manager->face_vertices(user_data->prim_ref_buffer[primID].primitive_id);
+}
+
+// Normal of a surface primitive, read from the baked triangle data if present
+inline Direction primitive_normal(const SurfaceUserData* user_data, unsigned int primID)
+{
+  if (!user_data->baked_triangles.empty()) return user_data->baked_triangles.normal(primID);
+  return user_data->mesh_manager->face_normal(user_data->prim_ref_buffer[primID].primitive_id);
+}
+
+bool primitive_mask_cull(const ExclusionSet* exclude_primitives, int primID) {
+  if (!exclude_primitives) return false;
+
+  // if the primitive mask is set, cull if the primitive is in the mask
+  return exclude_primitives->contains(primID);
+}
+
 bool primitive_mask_cull(RTCDualRayHit* rayhit, int primID) {
-  if (!rayhit->ray.exclude_primitives) return false;
+  return primitive_mask_cull(rayhit->ray.exclude_primitives, primID);
+}
 
-  RTCSurfaceDualRay& ray = rayhit->ray;
-  RTCDualHit& hit = rayhit->hit;
+// Intersection of a ray packet (N > 1) with a single triangle. Every active
+// lane tests the same primitive, so the vertex and normal lookups are done
+// once and shared across the packet, and the active rays are tested against
+// the triangle together with the batched Plucker kernel.
+void TriangleIntersectionFuncN(RTCIntersectFunctionNArguments* args) {
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  RTCDualPacketContext* packet = (RTCDualPacketContext*)args->context;
 
-  // if the primitive mask is set, cull if the primitive is not in the mask
-  return std::find(ray.exclude_primitives->begin(), ray.exclude_primitives->end(), primID) != ray.exclude_primitives->end();
+  if (packet->volume_filter && !user_data->bounds_volume(packet->volume_tree)) {
+    XDG_STAT(VOLUME_CULLS);
+    return;
+  }
+
+  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+
+  auto vertices = primitive_vertices(user_data, args->primID);
+
+  RTCRayN* rays = RTCRayHitN_RayN(args->rayhit, args->N);
+  RTCHitN* hits = RTCRayHitN_HitN(args->rayhit, args->N);
+
+  // gather the active rays of the packet
+  unsigned int n_active {0};
+  unsigned int active[MAX_PACKET_SIZE];
+  Position origins[MAX_PACKET_SIZE];
+  Direction directions[MAX_PACKET_SIZE];
+  for (unsigned int i = 0; i < args->N; i++) {
+    if (args->valid[i] == 0) continue;
+    unsigned int lane = RTCRayN_id(rays, args->N, i);
+    active[n_active] = i;
+    origins[n_active] = packet->dorg[lane];
+    directions[n_active] = packet->ddir[lane];
+    n_active++;
+  }
+
+  XDG_STAT_N(TRIANGLE_TESTS, n_active);
+  bool hit_tri[MAX_PACKET_SIZE];
+  double plucker_dists[MAX_PACKET_SIZE];
+  plucker_rays_tri_intersect_batch(vertices, origins, directions, n_active, hit_tri, plucker_dists);
+
+  Direction normal;
+  bool normal_set {false};
+
+  for (unsigned int j = 0; j < n_active; j++) {
+    if (!hit_tri[j]) continue;
+
+    unsigned int i = active[j];
+    unsigned int lane = RTCRayN_id(rays, args->N, i);
+    double plucker_dist = plucker_dists[j];
+
+    if (plucker_dist > packet->dtfar[lane]) continue;
+
+    if (!normal_set) {
+      normal = primitive_normal(user_data, args->primID);
+      // if this is a normal ray fire, flip the normal as needed
+      if (packet->volume_tree == user_data->reverse_tree && packet->rf_type != RayFireType::FIND_VOLUME)
+        normal = -normal;
+      normal_set = true;
+    }
+
+    if (packet->rf_type == RayFireType::VOLUME) {
+      if (orientation_cull(packet->ddir[lane], normal, packet->orientation)) {
+        XDG_STAT(ORIENTATION_CULLS);
+        continue;
+      }
+      if (primitive_mask_cull(packet->exclude_primitives[lane], primitive_ref.primitive_id)) {
+        XDG_STAT(EXCLUSION_CULLS);
+        continue;
+      }
+    }
+
+    // if we've gotten through all of the filters, set the ray information
+    XDG_STAT(TRIANGLE_HITS);
+    packet->dtfar[lane] = plucker_dist;
+    RTCRayN_tfar(rays, args->N, i) = std::min(plucker_dist, INFTYF);
+    // zero-out barycentric coords
+    RTCHitN_u(hits, args->N, i) = 0.0;
+    RTCHitN_v(hits, args->N, i) = 0.0;
+    RTCHitN_Ng_x(hits, args->N, i) = 0.0;
+    RTCHitN_Ng_y(hits, args->N, i) = 0.0;
+    RTCHitN_Ng_z(hits, args->N, i) = 0.0;
+    // set the hit information
+    RTCHitN_geomID(hits, args->N, i) = args->geomID;
+    RTCHitN_primID(hits, args->N, i) = args->primID;
+    packet->primitive_ref[lane] = &primitive_ref;
+    packet->surface[lane] = user_data->surface_id;
+    packet->dNg[lane] = normal;
+  }
 }
 
 void TriangleBoundsFunc(RTCBoundsFunctionArguments* args)
@@ -38,8 +143,13 @@ void TriangleBoundsFunc(RTCBoundsFunctionArguments* args)
   const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
   const MeshManager* mesh_manager = user_data->mesh_manager;
 
-  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
-  BoundingBox bounds = mesh_manager->face_bounding_box(primitive_ref.primitive_id);
+  BoundingBox bounds;
+  if (!user_data->baked_triangles.empty()) {
+    bounds = BoundingBox::from_points(user_data->baked_triangles.triangle_vertices(args->primID));
+  } else {
+    const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+    bounds = mesh_manager->face_bounding_box(primitive_ref.primitive_id);
+  }
 
   args->bounds_o->lower_x = bounds.min_x - user_data->box_bump;
   args->bounds_o->lower_y = bounds.min_y - user_data->box_bump;
@@ -50,17 +160,28 @@ void TriangleBoundsFunc(RTCBoundsFunctionArguments* args)
 }
 
 void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
-  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-
-  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+  // ray packets carry their double precision data in the query context
+  if (args->N != 1) {
+    TriangleIntersectionFuncN(args);
+    return;
+  }
 
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
 
   RTCDualRayHit* rayhit = (RTCDualRayHit*)args->rayhit;
   RTCSurfaceDualRay& ray = rayhit->ray;
   RTCDualHit& hit = rayhit->hit;
 
+  if (ray.volume_filter && !user_data->bounds_volume(ray.volume_tree)) {
+    XDG_STAT(VOLUME_CULLS);
+    return;
+  }
+  XDG_STAT(TRIANGLE_TESTS);
+
+  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
+
+  auto vertices = primitive_vertices(user_data, args->primID);
+
   Position ray_origin = {ray.dorg[0], ray.dorg[1], ray.dorg[2]};
   Direction ray_direction = {ray.ddir[0], ray.ddir[1], ray.ddir[2]};
 
@@ -72,22 +193,29 @@ void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
 
   if (plucker_dist > rayhit->ray.dtfar) return;
 
-  Direction normal = mesh_manager->face_normal(primitive_ref.primitive_id);
+  Direction normal = primitive_normal(user_data, args->primID);
 
   // Check if ray is entering or exiting the volume it was fired against
   // if this is a normal ray fire, flip the normal as needed
-  if (ray.volume_tree == user_data->reverse_vol && rayhit->ray.rf_type != RayFireType::FIND_VOLUME)
+  if (ray.volume_tree == user_data->reverse_tree && rayhit->ray.rf_type != RayFireType::FIND_VOLUME)
   {  
     normal = -normal;
   }
 
   if (rayhit->ray.rf_type == RayFireType::VOLUME) {
-   if (orientation_cull(rayhit->ray.ddir, normal, rayhit->ray.orientation)) return;
-   if (primitive_mask_cull(rayhit, primitive_ref.primitive_id)) return;
+   if (orientation_cull(rayhit->ray.ddir, normal, rayhit->ray.orientation)) {
+     XDG_STAT(ORIENTATION_CULLS);
+     return;
+   }
+   if (primitive_mask_cull(rayhit, primitive_ref.primitive_id)) {
+     XDG_STAT(EXCLUSION_CULLS);
+     return;
+   }
   }
 
 
   // if we've gotten through all of the filters, set the ray information
+  XDG_STAT(TRIANGLE_HITS);
   rayhit->ray.set_tfar(plucker_dist);
   // zero-out barycentric coords
   rayhit->hit.u = 0.0;
@@ -103,17 +231,98 @@ void TriangleIntersectionFunc(RTCIntersectFunctionNArguments* args) {
   rayhit->hit.dNg = normal;
 }
 
+// Refine a single precision hit candidate on native triangle geometry in
+// double precision. The single precision traversal can report a hit that the
+// double precision test misses for rays passing very close to a triangle
+// edge. The single precision mesh is watertight, so these are kept as long as
+// the ray is within single precision round-off of an edge rather than letting
+// the ray pass between the two triangles sharing the edge.
+static bool refine_native_hit(const std::array<Vertex, 3>& vertices,
+                              const Position& origin,
+                              const Direction& direction,
+                              double& dist)
+{
+  if (plucker_ray_tri_intersect(vertices, origin, direction, dist)) return true;
+
+  // The Plucker coordinate of an edge scales with the length of the edge and
+  // the distance of the edge from the origin of the coordinate system
+  double edge_length = std::max({(vertices[1] - vertices[0]).length(),
+                                 (vertices[2] - vertices[1]).length(),
+                                 (vertices[0] - vertices[2]).length()});
+  double extent = std::max({vertices[0].length(), vertices[1].length(),
+                            vertices[2].length(), origin.length()});
+  double edge_tol = PLUCKER_EDGE_TOL * edge_length * extent;
+  return plucker_ray_tri_intersect(vertices, origin, direction, dist, INFTY, nullptr, nullptr, edge_tol);
+}
+
+void TriangleIntersectionFilterFunc(const RTCFilterFunctionNArguments* args) {
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  RTCDualPacketContext* packet = (RTCDualPacketContext*)args->context;
+
+  bool volume_cull = packet->volume_filter && !user_data->bounds_volume(packet->volume_tree);
+
+  for (unsigned int i = 0; i < args->N; i++) {
+    if (args->valid[i] == 0) continue;
+    if (volume_cull) {
+      XDG_STAT(VOLUME_CULLS);
+      args->valid[i] = 0;
+      continue;
+    }
+    XDG_STAT(TRIANGLE_TESTS);
+    unsigned int lane = RTCRayN_id(args->ray, args->N, i);
+    unsigned int primID = RTCHitN_primID(args->hit, args->N, i);
+
+    const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[primID];
+    auto vertices = primitive_vertices(user_data, primID);
+    Direction normal = primitive_normal(user_data, primID);
+
+    const Position& ray_origin = packet->dorg[lane];
+    const Direction& ray_direction = packet->ddir[lane];
+
+    // refine the single precision candidate in double precision
+    double dist;
+    if (!refine_native_hit(vertices, ray_origin, ray_direction, dist) || dist > packet->dtfar[lane]) {
+      args->valid[i] = 0;
+      continue;
+    }
+
+    // if this is a normal ray fire, flip the normal as needed
+    if (packet->volume_tree == user_data->reverse_tree && packet->rf_type != RayFireType::FIND_VOLUME)
+      normal = -normal;
+
+    if (packet->rf_type == RayFireType::VOLUME) {
+      if (orientation_cull(ray_direction, normal, packet->orientation)) {
+        XDG_STAT(ORIENTATION_CULLS);
+        args->valid[i] = 0;
+        continue;
+      }
+      if (primitive_mask_cull(packet->exclude_primitives[lane], primitive_ref.primitive_id)) {
+        XDG_STAT(EXCLUSION_CULLS);
+        args->valid[i] = 0;
+        continue;
+      }
+    }
+
+    // accept the hit and record the double precision hit information
+    XDG_STAT(TRIANGLE_HITS);
+    packet->dtfar[lane] = dist;
+    packet->primitive_ref[lane] = &primitive_ref;
+    packet->surface[lane] = user_data->surface_id;
+    packet->dNg[lane] = normal;
+  }
+}
+
 bool TriangleClosestFunc(RTCPointQueryFunctionArguments* args) {
   RTCGeometry g = rtcGetGeometry(*(RTCScene*)args->userPtr, args->geomID);
   // get the array of DblTri's stored on the geometry
   const SurfaceUserData* user_data = (const SurfaceUserData*) rtcGetGeometryUserData(g);
 
-  const MeshManager* mesh_manager = user_data->mesh_manager;
+  RTCDPointQuery* query = (RTCDPointQuery*) args->query;
+  if (query->volume_filter && !user_data->bounds_volume(query->volume_tree)) return false;
 
   const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
+  auto vertices = primitive_vertices(user_data, args->primID);
 
-  RTCDPointQuery* query = (RTCDPointQuery*) args->query;
   Position p {query->dblx, query->dbly, query->dblz};
 
   Position result = closest_location_on_triangle(vertices, p);
@@ -131,15 +340,49 @@ bool TriangleClosestFunc(RTCPointQueryFunctionArguments* args) {
   }
 }
 
+void TriangleOcclusionFilterFunc(const RTCFilterFunctionNArguments* args) {
+  const SurfaceUserData* user_data = (const SurfaceUserData*)args->geometryUserPtr;
+  RTCDualPacketContext* packet = (RTCDualPacketContext*)args->context;
+
+  bool volume_cull = packet->volume_filter && !user_data->bounds_volume(packet->volume_tree);
+
+  for (unsigned int i = 0; i < args->N; i++) {
+    if (args->valid[i] == 0) continue;
+    if (volume_cull) {
+      XDG_STAT(VOLUME_CULLS);
+      args->valid[i] = 0;
+      continue;
+    }
+    XDG_STAT(OCCLUSION_TESTS);
+    unsigned int lane = RTCRayN_id(args->ray, args->N, i);
+    unsigned int primID = RTCHitN_primID(args->hit, args->N, i);
+
+    auto vertices = primitive_vertices(user_data, primID);
+
+    // refine the single precision candidate in double precision
+    double dist;
+    if (!refine_native_hit(vertices, packet->dorg[lane], packet->ddir[lane], dist) || dist > packet->dtfar[lane]) {
+      args->valid[i] = 0;
+      continue;
+    }
+
+    // accept the hit, marking the ray as occluded
+    packet->dtfar[lane] = -INFTY;
+  }
+}
+
 void TriangleOcclusionFunc(RTCOccludedFunctionNArguments* args) {
   const SurfaceUserData* user_data = (const SurfaceUserData*) args->geometryUserPtr;
-  const MeshManager* mesh_manager = user_data->mesh_manager;
-  const PrimitiveRef& primitive_ref = user_data->prim_ref_buffer[args->primID];
-
-  auto vertices = mesh_manager->face_vertices(primitive_ref.primitive_id);
 
   // get the double precision ray from the args
   RTCSurfaceDualRay* ray = (RTCSurfaceDualRay*) args->ray;
+  if (ray->volume_filter && !user_data->bounds_volume(ray->volume_tree)) {
+    XDG_STAT(VOLUME_CULLS);
+    return;
+  }
+  XDG_STAT(OCCLUSION_TESTS);
+
+  auto vertices = primitive_vertices(user_data, args->primID);
 
   double plucker_dist;
   if (plucker_ray_tri_intersect(vertices, ray->dorg, ray->ddir, plucker_dist)) {
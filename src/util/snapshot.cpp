@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "xdg/util/snapshot.h"
+
+namespace xdg {
+
+namespace snapshot {
+
+constexpr char MAGIC[8] = {'X', 'D', 'G', 'S', 'N', 'A', 'P', '\0'};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t n_sections;
+  uint64_t key;
+};
+
+struct SectionHeader {
+  char name[NAME_SIZE];
+  uint64_t size;
+};
+
+//! \brief Number of bytes of padding following a section of the given size
+inline size_t padding(uint64_t size) { return (8 - size % 8) % 8; }
+
+uint64_t hash_file(const std::string& filepath)
+{
+  std::ifstream file(filepath, std::ios::binary);
+  if (!file) throw std::runtime_error(fmt::format("Failed to open {} for hashing", filepath));
+
+  uint64_t hash = 14695981039346656037ULL;
+  std::vector<char> buffer(1 << 20);
+  while (file) {
+    file.read(buffer.data(), buffer.size());
+    std::streamsize n = file.gcount();
+    for (std::streamsize i = 0; i < n; i++) {
+      hash ^= static_cast<unsigned char>(buffer[i]);
+      hash *= 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+std::string cache_path(const std::string& directory, uint64_t key, const std::string& variant)
+{
+  if (variant.empty()) return fmt::format("{}/{:016x}.xdgsnap", directory, key);
+  return fmt::format("{}/{:016x}-{}.xdgsnap", directory, key, variant);
+}
+
+} // namespace snapshot
+
+void SnapshotWriter::add(const std::string& name, const void* data, size_t n_bytes)
+{
+  if (name.size() >= snapshot::NAME_SIZE)
+    throw std::invalid_argument(fmt::format("Snapshot section name '{}' is too long", name));
+  const char* bytes = static_cast<const char*>(data);
+  sections_.push_back({name, std::vector<char>(bytes, bytes + n_bytes)});
+}
+
+bool SnapshotWriter::write(const std::string& filepath) const
+{
+  std::string tmp_path = fmt::format("{}.{}.tmp", filepath, getpid());
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    snapshot::Header header {};
+    std::memcpy(header.magic, snapshot::MAGIC, sizeof(header.magic));
+    header.version = snapshot::VERSION;
+    header.n_sections = sections_.size();
+    header.key = key_;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    const char zeros[8] = {};
+    for (const auto& section : sections_) {
+      snapshot::SectionHeader section_header {};
+      std::strncpy(section_header.name, section.name.c_str(), snapshot::NAME_SIZE - 1);
+      section_header.size = section.data.size();
+      file.write(reinterpret_cast<const char*>(&section_header), sizeof(section_header));
+      file.write(section.data.data(), section.data.size());
+      file.write(zeros, snapshot::padding(section.data.size()));
+    }
+    if (!file) {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(tmp_path.c_str(), filepath.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+SnapshotReader::~SnapshotReader()
+{
+  close();
+}
+
+bool SnapshotReader::open(const std::string& filepath, uint64_t key)
+{
+  close();
+
+  int fd = ::open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(snapshot::Header))) {
+    ::close(fd);
+    return false;
+  }
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping remains valid after the descriptor is closed
+  if (data == MAP_FAILED) return false;
+  data_ = data;
+  size_ = st.st_size;
+
+  // validate the header
+  const char* bytes = static_cast<const char*>(data_);
+  snapshot::Header header;
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, snapshot::MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != snapshot::VERSION ||
+      header.key != key) {
+    close();
+    return false;
+  }
+
+  // index the sections, rejecting truncated files
+  size_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.n_sections; i++) {
+    snapshot::SectionHeader section_header;
+    if (size_ - offset < sizeof(section_header)) { close(); return false; }
+    std::memcpy(&section_header, bytes + offset, sizeof(section_header));
+    offset += sizeof(section_header);
+    if (size_ - offset < section_header.size) { close(); return false; }
+    section_header.name[snapshot::NAME_SIZE - 1] = '\0';
+    sections_.push_back({section_header.name, bytes + offset, section_header.size});
+    offset += section_header.size;
+    offset += std::min<size_t>(snapshot::padding(section_header.size), size_ - offset);
+  }
+  return true;
+}
+
+void SnapshotReader::close()
+{
+  if (data_) munmap(data_, size_);
+  data_ = nullptr;
+  size_ = 0;
+  sections_.clear();
+}
+
+bool SnapshotReader::contains(const std::string& name) const
+{
+  return find(name) != nullptr;
+}
+
+const SnapshotReader::Section* SnapshotReader::find(const std::string& name) const
+{
+  for (const auto& section : sections_) {
+    if (section.name == name) return &section;
+  }
+  return nullptr;
+}
+
+void SnapshotReader::copy(const Section& section, void* destination)
+{
+  if (section.size > 0) std::memcpy(destination, section.data, section.size);
+}
+
+} // namespace xdg
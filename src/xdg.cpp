@@ -1,17 +1,62 @@
-#include <vector>
+#include <algorithm>
+#include <fstream>
 #include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#ifdef XDG_HAVE_OPENMP
+#include "omp.h"
+#endif
 
 #include "xdg/xdg.h"
 #include "xdg/error.h"
 #include "xdg/constants.h"
 #include "xdg/geometry/measure.h"
+#include "xdg/geometry/plucker.h"
 
 #include "xdg/mesh_managers.h"
 
 #include "xdg/ray_tracers.h"
+#include "xdg/timer.h"
 
 namespace xdg {
 
+namespace {
+
+// Vertex coordinates of a triangle in sorted order, so that a surface face and
+// the element face it coincides with have the same key regardless of the
+// ordering of their vertices
+using FaceKey = std::array<double, 9>;
+
+FaceKey face_key(std::array<Vertex, 3> vertices)
+{
+  std::sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) {
+    return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+  });
+  FaceKey key;
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) key[3 * i + j] = vertices[i][j];
+  }
+  return key;
+}
+
+struct FaceKeyHash {
+  size_t operator()(const FaceKey& key) const {
+    size_t hash = 0;
+    for (double value : key) {
+      hash ^= std::hash<double>{}(value) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+  }
+};
+
+// Marks element faces where the element on the other side of the face can only
+// be found with a point location query
+constexpr MeshID LOCATE_ELEMENT {-2};
+
+} // namespace
+
 XDG::XDG(std::shared_ptr<MeshManager> mesh_manager, RTLibrary ray_tracing_lib)
         : mesh_manager_(mesh_manager)
 {
@@ -36,16 +81,123 @@ XDG::XDG(std::shared_ptr<MeshManager> mesh_manager, RTLibrary ray_tracing_lib)
 
 void XDG::prepare_raytracer()
 {
-  for (auto volume : mesh_manager()->volumes()) {
-    this->prepare_volume_for_raytracing(volume);
+  ScopedTimer timer("prepare_raytracer");
+
+  // register all volumes at once so that backends can build their trees concurrently
+  const auto& volumes = mesh_manager()->volumes();
+  {
+    ScopedTimer register_timer("register_volumes");
+    auto trees = ray_tracing_interface_->register_volumes(mesh_manager_, volumes);
+    for (size_t i = 0; i < volumes.size(); i++) {
+      volume_to_surface_tree_map_[volumes[i]] = trees[i].first;
+      volume_to_point_location_tree_map_[volumes[i]] = trees[i].second;
+    }
   }
 
-  ray_tracing_interface()->create_global_element_tree();
-  ray_tracing_interface()->create_global_surface_tree();
+  {
+    ScopedTimer global_timer("global_element_tree");
+    ray_tracing_interface()->create_global_element_tree();
+  }
+  {
+    ScopedTimer global_timer("global_surface_tree");
+    ray_tracing_interface()->create_global_surface_tree();
+  }
+
+  {
+    ScopedTimer face_timer("face_elements");
+    build_face_element_map();
+  }
 
+  ScopedTimer init_timer("init");
   ray_tracing_interface()->init(); // Initialize the ray tracer (e.g. build SBT for GPRT)
 }
 
+void XDG::build_face_element_map()
+{
+  face_element_map_.clear();
+  element_crossing_map_.clear();
+  MeshID ipc = mesh_manager()->implicit_complement();
+  const auto& face_ordering = mesh_manager()->tet_face_ordering();
+
+  // element faces found on a surface, resolved once every volume is matched
+  struct SurfaceElementFace {
+    MeshID element;
+    int element_face;
+    MeshID surface;
+    MeshID face;
+    Sense sense;
+  };
+  std::vector<SurfaceElementFace> surface_element_faces;
+
+  std::unordered_map<FaceKey, std::tuple<MeshID, MeshID, Sense>, FaceKeyHash> volume_faces;
+  for (auto volume : mesh_manager()->volumes()) {
+    if (volume == ipc || mesh_manager()->num_volume_elements(volume) == 0) continue;
+
+    // faces of the volume's surfaces and the side of each facing the volume
+    volume_faces.clear();
+    for (auto surface : mesh_manager()->get_volume_surfaces(volume)) {
+      Sense sense = mesh_manager()->surface_sense(surface, volume);
+      if (sense == Sense::UNSET) continue;
+      for (auto face : mesh_manager()->get_surface_faces(surface)) {
+        volume_faces[face_key(mesh_manager()->face_vertices(face))] = {surface, face, sense};
+      }
+    }
+
+    for (auto element : mesh_manager()->get_volume_elements(volume)) {
+      auto vertices = mesh_manager()->tet_vertices(element);
+      for (int i = 0; i < face_ordering.size(); i++) {
+        const auto& f = face_ordering[i];
+        auto it = volume_faces.find(face_key({vertices[f[0]], vertices[f[1]], vertices[f[2]]}));
+        if (it == volume_faces.end()) continue;
+        auto [surface, face, sense] = it->second;
+        if (!face_element_map_.contains(face)) face_element_map_[face] = {ID_NONE, ID_NONE};
+        face_element_map_[face][static_cast<int>(sense)] = element;
+        surface_element_faces.push_back({element, i, surface, face, sense});
+      }
+    }
+  }
+
+  // Classify what a track leaving an element through a surface face enters:
+  // the element sharing the face on a conforming interface, nothing on the
+  // boundary of the model (or of the meshed volumes), or an unknown element
+  // of a meshed volume whose mesh does not share the face
+  for (const auto& sef : surface_element_faces) {
+    if (!element_crossing_map_.contains(sef.element))
+      element_crossing_map_[sef.element] = {LOCATE_ELEMENT, LOCATE_ELEMENT, LOCATE_ELEMENT, LOCATE_ELEMENT};
+
+    Sense other_side = sef.sense == Sense::FORWARD ? Sense::REVERSE : Sense::FORWARD;
+    MeshID crossing = face_element(sef.face, other_side);
+    if (crossing == ID_NONE) {
+      auto senses = mesh_manager()->surface_senses(sef.surface);
+      MeshID other_volume = sef.sense == Sense::FORWARD ? senses.second : senses.first;
+      bool meshed = other_volume != ID_NONE && other_volume != ipc &&
+                    mesh_manager()->num_volume_elements(other_volume) > 0;
+      if (meshed) crossing = LOCATE_ELEMENT;
+    }
+    element_crossing_map_[sef.element][sef.element_face] = crossing;
+  }
+}
+
+MeshID XDG::face_element(MeshID face, Sense sense) const
+{
+  if (sense == Sense::UNSET) return ID_NONE;
+  auto it = face_element_map_.find(face);
+  if (it == face_element_map_.end()) return ID_NONE;
+  return it->second[static_cast<int>(sense)];
+}
+
+MeshID XDG::element_crossing(MeshID element, const Position& r, const Direction& u) const
+{
+  auto it = element_crossing_map_.find(element);
+  if (it == element_crossing_map_.end()) return LOCATE_ELEMENT;
+
+  double exit_distance;
+  int exit_face = plucker_ray_tet_exit(mesh_manager()->tet_vertices(element),
+                                       mesh_manager()->tet_face_ordering(), r, u, exit_distance);
+  if (exit_face < 0) return LOCATE_ELEMENT;
+  return it->second[exit_face];
+}
+
 void XDG::prepare_volume_for_raytracing(MeshID volume) {
     auto [surface_tree, volume_tree] = ray_tracing_interface_->register_volume(mesh_manager_, volume);
     volume_to_surface_tree_map_[volume] = surface_tree;
@@ -101,48 +253,93 @@ std::shared_ptr<XDG> XDG::create(MeshLibrary mesh_lib, RTLibrary ray_tracing_lib
   return xdg;
 }
 
+bool XDG::point_in_volume(MeshID volume,
+                          const Position point,
+                          const Direction* direction,
+                          const ExclusionSet* exclude_primitives) const
+{
+  XDG_SAMPLED_TIMER("point_in_volume");
+  TreeID tree = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->point_in_volume(tree, point, direction, exclude_primitives);
+}
+
 bool XDG::point_in_volume(MeshID volume,
                           const Position point,
                           const Direction* direction,
                           const std::vector<MeshID>* exclude_primitives) const
 {
+  XDG_SAMPLED_TIMER("point_in_volume");
   TreeID tree = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->point_in_volume(tree, point, direction, exclude_primitives);
 }
 
+bool XDG::point_in_volume(MeshID volume,
+                          const Position point,
+                          const Direction* direction,
+                          QueryContext& context) const
+{
+  XDG_SAMPLED_TIMER("point_in_volume");
+  TreeID tree = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->point_in_volume(tree, point, direction, context);
+}
+
 MeshID XDG::find_volume(const Position& point,
-                                                   const Direction& direction) const
+                        const Direction& direction) const
 {
-  MeshID ipc = mesh_manager()->implicit_complement();
-  for (auto volume_scene_pair : volume_to_surface_tree_map_) {
-    MeshID volume = volume_scene_pair.first;
-    if (volume == ipc) continue;
-    TreeID scene = volume_scene_pair.second;
-    if (ray_tracing_interface()->point_in_volume(scene, point, &direction)) {
-      return volume;
-    }
-  }
+  XDG_SAMPLED_TIMER("find_volume");
+  MeshID volume = ray_tracing_interface()->find_volume(point, direction);
 
   // if the point could not be found in any volume, it is by definition in the implicit complement
-  return ipc;
+  if (volume == ID_NONE) return mesh_manager()->implicit_complement();
+  return volume;
 }
 
 MeshID XDG::find_element(const Position& point) const
 {
+  XDG_SAMPLED_TIMER("find_element");
   return ray_tracing_interface()->find_element(point);
 }
 
 MeshID XDG::find_element(MeshID volume,
                          const Position& point) const
 {
+  XDG_SAMPLED_TIMER("find_element");
   TreeID scene = volume_to_point_location_tree_map_.at(volume);
   return ray_tracing_interface()->find_element(scene, point);
 }
 
-std::vector<std::pair<MeshID, double>>
-XDG::segments(const Position& start,
-              const Position& end) const
+ElementLocation XDG::locate(const Position& point) const
+{
+  XDG_SAMPLED_TIMER("locate");
+  return ray_tracing_interface()->locate(point);
+}
+
+ElementLocation XDG::locate(MeshID volume,
+                            const Position& point) const
+{
+  XDG_SAMPLED_TIMER("locate");
+  TreeID scene = volume_to_point_location_tree_map_.at(volume);
+  return ray_tracing_interface()->locate(scene, point);
+}
+
+void XDG::locate(const Position* points,
+                 size_t n_points,
+                 ElementLocation* locations) const
+{
+  XDG_SAMPLED_TIMER("locate_batch");
+  bool parallel = ray_tracing_interface()->concurrent_queries();
+  #pragma omp parallel for schedule(static) if(parallel)
+  for (size_t i = 0; i < n_points; i++) {
+    locations[i] = ray_tracing_interface()->locate(points[i]);
+  }
+}
+
+template<typename Visitor>
+bool XDG::walk_track(const Position& start,
+                     const Position& end,
+                     Visitor&& visit) const
 {
+  XDG_STAT(SEGMENT_QUERIES);
   MeshID ipc = mesh_manager()->implicit_complement();
 
   Position r = start;
@@ -150,51 +347,145 @@ XDG::segments(const Position& start,
   double distance = u.length();
   u /= distance;
 
-  std::vector<std::pair<MeshID, double>> segments;
+  // attempt to find an element at the start location
+  MeshID current_element = ray_tracing_interface()->find_element(r);
+  MeshID last_element = ID_NONE;
   while (distance > 0) {
-    // attempt to find an element at the start location
-    MeshID current_element = ray_tracing_interface()->find_element(r);
-    // at this point we may be on the face of an element, if we're declared inside that element, ignore it
-    if (segments.size() > 0 && current_element == segments.back().first) current_element = ID_NONE;
-    MeshID volume = ID_NONE;
     if (current_element == ID_NONE) {
       // fire a ray against the implicit complement
-      auto hit = ray_fire(ipc, r, u, INFTY, HitOrientation::EXITING);
+      ExclusionSet hit_face;
+      auto hit = ray_fire(ipc, r, u, INFTY, HitOrientation::EXITING, &hit_face);
       // if there is no entry point or the distance to the surface
       // is past the end point, return
-      if (hit.second == ID_NONE || hit.first > distance) return segments;
+      if (hit.second == ID_NONE || hit.first > distance) return true;
 
       // move up to the surface
       r += u * hit.first;
       distance -= hit.first;
-      // determine the volume we're moving into
-      mesh_manager()->next_volume(ipc, hit.second);
 
-      // determine what element is on the other side of this surface
-      current_element = find_element(r + u * TINY_BIT);
+      // the element on the other side of the face that was hit is in the
+      // volume we're moving into, on the side of the surface not facing the
+      // implicit complement
+      auto parent_vols = mesh_manager()->get_parent_volumes(hit.second);
+      Sense sense = parent_vols.first == ipc ? Sense::REVERSE : Sense::FORWARD;
+      current_element = face_element(hit_face.back(), sense);
+
+      // fall back to a point location query for faces without a matching
+      // element face, e.g. volumes added after the ray tracer was prepared
+      if (current_element == ID_NONE) current_element = find_element(r + u * TINY_BIT);
       if (current_element == ID_NONE) {
-        warning("Ray fire hit surface {}, but could not find element on the other side of the surface.", hit.second);
-        return {};
+        warning(fmt::format("Ray fire hit surface {}, but could not find element on the other side of the surface.", hit.second));
+        return false;
       }
     }
-    auto vol_segments = mesh_manager()->walk_elements(current_element, r, u, distance);
-    // add to current set of segments
-    segments.insert(segments.end(), vol_segments.begin(), vol_segments.end());
-    double segment_sum = std::accumulate(vol_segments.begin(), vol_segments.end(), 0.0,
-                                         [](double total, const auto& segment) { return total + segment.second; });
+    // walk the elements in this volume, adding to the current set of segments
+    double segment_sum = 0.0;
+    double last_length = 0.0;
+    mesh_manager()->walk_elements(current_element, r, u, distance,
+                                  [&](MeshID element, double length) {
+                                    XDG_STAT(SEGMENTS);
+                                    visit(element, length);
+                                    last_element = element;
+                                    last_length = length;
+                                    segment_sum += length;
+                                  });
     // upate location of the track start
     r += u * segment_sum;
     // decrement distance by total distance traveled in the volume
     distance -= segment_sum;
+    if (distance <= 0) break;
+
+    // The walk stopped on a face of the last element without an adjacent
+    // element. Continue in the element across a conforming interface, or
+    // through the implicit complement from the boundary of the model.
+    current_element = element_crossing(last_element, r - u * last_length, u);
+    if (current_element != LOCATE_ELEMENT) continue;
+
+    // Faces that are not on a surface and interfaces with a volume whose mesh
+    // does not share the face's vertices require a point location query. We're
+    // on the face of the last element, so if we're declared inside that
+    // element, ignore it.
+    current_element = ray_tracing_interface()->find_element(r);
+    if (current_element == last_element) current_element = ID_NONE;
   }
+  return true;
+}
+
+std::vector<std::pair<MeshID, double>>
+XDG::segments(const Position& start,
+              const Position& end) const
+{
+  XDG_SAMPLED_TIMER("segments");
+  std::vector<std::pair<MeshID, double>> segments;
+  bool complete = walk_track(start, end, [&](MeshID element, double length) {
+    segments.emplace_back(element, length);
+  });
+  if (!complete) return {};
   return segments;
 }
 
+void
+XDG::segments(const Position* starts,
+              const Position* ends,
+              size_t n_tracks,
+              SegmentBatch& batch) const
+{
+  XDG_SAMPLED_TIMER("segments_batch");
+  batch.offsets.assign(n_tracks + 1, 0);
+
+  // Tracks are split into contiguous ranges, each filling its own scratch
+  // buffer. There are a few more ranges than threads to balance the load of
+  // tracks of different lengths.
+#ifdef XDG_HAVE_OPENMP
+  size_t n_ranges = std::min(n_tracks, static_cast<size_t>(4 * omp_get_max_threads()));
+#else
+  size_t n_ranges = std::min(n_tracks, static_cast<size_t>(1));
+#endif
+  if (batch.scratch.size() < n_ranges) batch.scratch.resize(n_ranges);
+  auto range_begin = [&](size_t range) { return n_tracks * range / n_ranges; };
+
+  bool parallel = ray_tracing_interface()->concurrent_queries();
+  #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+  for (size_t range = 0; range < n_ranges; range++) {
+    auto& scratch = batch.scratch[range];
+    scratch.elements.clear();
+    scratch.lengths.clear();
+    for (size_t i = range_begin(range); i < range_begin(range + 1); i++) {
+      size_t track_begin = scratch.elements.size();
+      bool complete = walk_track(starts[i], ends[i], [&](MeshID element, double length) {
+        scratch.elements.push_back(element);
+        scratch.lengths.push_back(length);
+      });
+      // tracks that could not be completed have no segments, as in segments(start, end)
+      if (!complete) {
+        scratch.elements.resize(track_begin);
+        scratch.lengths.resize(track_begin);
+      }
+      batch.offsets[i + 1] = scratch.elements.size() - track_begin;
+    }
+  }
+
+  // convert the segment counts to offsets and gather the scratch buffers
+  std::partial_sum(batch.offsets.begin(), batch.offsets.end(), batch.offsets.begin());
+  batch.elements.resize(batch.offsets.back());
+  batch.lengths.resize(batch.offsets.back());
+
+  #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+  for (size_t range = 0; range < n_ranges; range++) {
+    const auto& scratch = batch.scratch[range];
+    size_t offset = batch.offsets[range_begin(range)];
+    std::copy(scratch.elements.begin(), scratch.elements.end(), batch.elements.begin() + offset);
+    std::copy(scratch.lengths.begin(), scratch.lengths.end(), batch.lengths.begin() + offset);
+  }
+}
+
 std::vector<std::pair<MeshID, double>>
 XDG::segments(MeshID volume,
               const Position& start,
               const Position& end) const
 {
+  XDG_SAMPLED_TIMER("segments");
+  XDG_STAT(SEGMENT_QUERIES);
   Position start_copy = start;
   Direction u = (end - start).normalize();
   TreeID volume_tree = volume_to_point_location_tree_map_.at(volume);
@@ -203,10 +494,12 @@ XDG::segments(MeshID volume,
   // if we're outside of the region of interest, determine the distance to an entering intersection
   // with the model
   if (starting_element == ID_NONE) {
-    auto hit = ray_fire(volume, start, u, INFTY, HitOrientation::ENTERING);
+    ExclusionSet hit_face;
+    auto hit = ray_fire(volume, start, u, INFTY, HitOrientation::ENTERING, &hit_face);
     if (hit.second == ID_NONE) return {};
-    // TODO: use mesh adjaccies to find the element on the other side of the hit face
-    starting_element = ray_tracing_interface()->find_element(volume_tree, start + u * (hit.first + TINY_BIT));
+    starting_element = face_element(hit_face.back(), mesh_manager()->surface_sense(hit.second, volume));
+    if (starting_element == ID_NONE)
+      starting_element = ray_tracing_interface()->find_element(volume_tree, start + u * (hit.first + TINY_BIT));
     if (starting_element == ID_NONE) {
       warning("Ray fire hit surface {}, but could not find element on the other side of the surface.", hit.second);
       return {};
@@ -216,6 +509,7 @@ XDG::segments(MeshID volume,
 
   if (starting_element == ID_NONE) return {};
   auto segments = mesh_manager()->walk_elements(starting_element, start_copy, end);
+  XDG_STAT_N(SEGMENTS, segments.size());
   return segments;
 }
 
@@ -227,6 +521,19 @@ XDG::next_element(MeshID current_element,
   return mesh_manager()->next_element(current_element, r, u);
 }
 
+std::pair<double, MeshID>
+XDG::ray_fire(MeshID volume,
+              const Position& origin,
+              const Direction& direction,
+              const double dist_limit,
+              HitOrientation orientation,
+              ExclusionSet* const exclude_primitives) const
+{
+  XDG_SAMPLED_TIMER("ray_fire");
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->ray_fire(scene, origin, direction, dist_limit, orientation, exclude_primitives);
+}
+
 std::pair<double, MeshID>
 XDG::ray_fire(MeshID volume,
               const Position& origin,
@@ -235,13 +542,43 @@ XDG::ray_fire(MeshID volume,
               HitOrientation orientation,
               std::vector<MeshID>* const exclude_primitives) const
 {
+  XDG_SAMPLED_TIMER("ray_fire");
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->ray_fire(scene, origin, direction, dist_limit, orientation, exclude_primitives);
 }
 
+std::pair<double, MeshID>
+XDG::ray_fire(MeshID volume,
+              const Position& origin,
+              const Direction& direction,
+              QueryContext& context,
+              const double dist_limit,
+              HitOrientation orientation) const
+{
+  XDG_SAMPLED_TIMER("ray_fire");
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  return ray_tracing_interface()->ray_fire(scene, origin, direction, context, dist_limit, orientation);
+}
+
+void
+XDG::ray_fire(MeshID volume,
+              const Position* origins,
+              const Direction* directions,
+              size_t n_rays,
+              std::pair<double, MeshID>* hits,
+              const double dist_limit,
+              HitOrientation orientation,
+              ExclusionSet* const exclude_primitives) const
+{
+  XDG_SAMPLED_TIMER("ray_fire_batch");
+  TreeID scene = volume_to_surface_tree_map_.at(volume);
+  ray_tracing_interface()->ray_fire(scene, origins, directions, n_rays, hits, dist_limit, orientation, exclude_primitives);
+}
+
 std::pair<double, MeshID> XDG::closest(MeshID volume,
                                        const Position& origin) const
 {
+  XDG_SAMPLED_TIMER("closest");
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->closest(scene, origin);
 }
@@ -249,6 +586,7 @@ std::pair<double, MeshID> XDG::closest(MeshID volume,
 double XDG::closest_distance(MeshID volume,
                              const Position& origin) const
 {
+  XDG_SAMPLED_TIMER("closest");
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->closest(scene, origin).first;
 }
@@ -258,13 +596,14 @@ bool XDG::occluded(MeshID volume,
               const Direction& direction,
               double& dist) const
 {
+  XDG_SAMPLED_TIMER("occluded");
   TreeID scene = volume_to_surface_tree_map_.at(volume);
   return ray_tracing_interface()->occluded(scene, origin, direction, dist);
 }
 
 Direction XDG::surface_normal(MeshID surface,
                               Position point,
-                              const std::vector<MeshID>* exclude_primitives) const
+                              const ExclusionSet* exclude_primitives) const
 {
   MeshID element;
   if (exclude_primitives != nullptr && exclude_primitives->size() > 0) {
@@ -282,6 +621,22 @@ Direction XDG::surface_normal(MeshID surface,
   return mesh_manager()->face_normal(element);
 }
 
+Direction XDG::surface_normal(MeshID surface,
+                              Position point,
+                              const std::vector<MeshID>* exclude_primitives) const
+{
+  if (exclude_primitives != nullptr && exclude_primitives->size() > 0)
+    return mesh_manager()->face_normal(exclude_primitives->back());
+  return surface_normal(surface, point);
+}
+
+void XDG::write_statistics(const std::string& filename) const
+{
+  std::ofstream out(filename);
+  if (!out) fatal_error("Failed to open statistics file {}", filename);
+  out << statistics().to_json() << std::endl;
+}
+
 double XDG::measure_volume(MeshID volume) const
 {
   double volume_total {0.0};
@@ -87,6 +87,17 @@ public:
     return {vertices()[conn[0]], vertices()[conn[1]], vertices()[conn[2]], vertices()[conn[3]]};
   }
 
+  virtual std::array<Vertex, 4> tet_vertices(MeshID element) const override {
+    const auto& conn = tetrahedron_connectivity()[element];
+    return {vertices()[conn[0]], vertices()[conn[1]], vertices()[conn[2]], vertices()[conn[3]]};
+  }
+
+  virtual const std::array<std::array<int, 3>, 4>& tet_face_ordering() const override {
+    // local vertex indices of the faces returned by tet_faces
+    static const std::array<std::array<int, 3>, 4> ordering {{{0, 1, 2}, {0, 2, 3}, {0, 3, 1}, {1, 3, 2}}};
+    return ordering;
+  }
+
   virtual std::array<Vertex, 3> face_vertices(MeshID element) const override {
     const auto& conn = triangle_connectivity()[element];
     return {vertices()[conn[0]], vertices()[conn[1]], vertices()[conn[2]]};
@@ -1,7 +1,9 @@
 // for testing
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 
 // xdg includes
+#include "xdg/config.h"
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/embree/ray_tracer.h"
@@ -45,4 +47,34 @@ TEST_CASE("Test Mesh BVH")
     auto [volume_tree, element_tree] = rti->register_volume(mm, volume);
     volume_to_scene_map[volume] = volume_tree;
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test Mesh BVH Build Settings")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+
+  // ray tracers take their initial settings from the configuration
+  XDGConfig::config().set_tree_build_settings(TreeClass::GLOBAL_SURFACE, {BuildQuality::LOW, true, true});
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  XDGConfig::config().reset();
+  REQUIRE(rti->tree_build_settings(TreeClass::GLOBAL_SURFACE).quality == BuildQuality::LOW);
+  REQUIRE(rti->tree_build_settings(TreeClass::GLOBAL_SURFACE).compact);
+  REQUIRE(rti->tree_build_settings(TreeClass::VOLUME_SURFACE).quality == BuildQuality::HIGH);
+
+  // trees built with any settings give the same results
+  for (auto quality : {BuildQuality::LOW, BuildQuality::MEDIUM, BuildQuality::HIGH}) {
+    for (bool compact : {false, true}) {
+      rti = std::make_shared<EmbreeRayTracer>();
+      rti->set_tree_build_settings(TreeClass::VOLUME_SURFACE, {quality, true, compact});
+      rti->set_tree_build_settings(TreeClass::GLOBAL_SURFACE, {quality, true, compact});
+      auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+      rti->create_global_surface_tree();
+      rti->init();
+
+      auto hit = rti->ray_fire(volume_tree, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0});
+      REQUIRE_THAT(hit.first, Catch::Matchers::WithinAbs(5.0, 1e-6));
+      REQUIRE(rti->find_volume({0.0, 0.0, 0.0}, {0.0, 1.0, 0.0}) == mm->volumes()[0]);
+    }
+  }
+}
@@ -50,4 +50,30 @@ TEST_CASE("Config set threads")
   xdg::XDGConfig::config().reset();
   xdg::XDGConfig::config().set_n_threads(4);
   REQUIRE(xdg::XDGConfig::config().n_threads() == 4);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Config tree build settings")
+{
+  xdg::XDGConfig::config().reset();
+
+  // robust, high quality trees by default
+  for (auto tree_class : {xdg::TreeClass::VOLUME_SURFACE, xdg::TreeClass::GLOBAL_SURFACE, xdg::TreeClass::ELEMENT}) {
+    const auto& settings = xdg::XDGConfig::config().tree_build_settings(tree_class);
+    REQUIRE(settings.quality == xdg::BuildQuality::HIGH);
+    REQUIRE(settings.robust);
+    REQUIRE(!settings.compact);
+  }
+
+  // each class of tree has its own settings
+  xdg::XDGConfig::config().set_tree_build_settings(xdg::TreeClass::VOLUME_SURFACE, {xdg::BuildQuality::LOW, true, false});
+  xdg::XDGConfig::config().set_tree_build_settings(xdg::TreeClass::ELEMENT, {xdg::BuildQuality::MEDIUM, false, true});
+  REQUIRE(xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::VOLUME_SURFACE).quality == xdg::BuildQuality::LOW);
+  REQUIRE(xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::GLOBAL_SURFACE).quality == xdg::BuildQuality::HIGH);
+  REQUIRE(xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::ELEMENT).quality == xdg::BuildQuality::MEDIUM);
+  REQUIRE(xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::ELEMENT).compact);
+  REQUIRE(!xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::ELEMENT).robust);
+
+  xdg::XDGConfig::config().reset();
+  REQUIRE(xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::ELEMENT).quality == xdg::BuildQuality::HIGH);
+  REQUIRE(!xdg::XDGConfig::config().tree_build_settings(xdg::TreeClass::ELEMENT).compact);
+}
@@ -0,0 +1,75 @@
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/constants.h"
+#include "xdg/dense_map.h"
+
+using namespace xdg;
+
+TEST_CASE("Test DenseMap")
+{
+  DenseMap<MeshID, TreeID> map;
+  REQUIRE(map.empty());
+  REQUIRE(!map.contains(0));
+  REQUIRE(map.count(ID_NONE) == 0);
+  REQUIRE_THROWS_AS(map.at(0), std::out_of_range);
+
+  map[3] = 30;
+  map[0] = 0;
+  map[1] = 10;
+  REQUIRE(map.size() == 3);
+  REQUIRE(map.at(3) == 30);
+  REQUIRE(map.at(0) == 0);
+  REQUIRE(map.at(1) == 10);
+  REQUIRE(!map.contains(2));
+  REQUIRE(map.find(2) == map.end());
+  REQUIRE(map.find(1)->second == 10);
+
+  // existing entries are updated in place
+  map[3] = 31;
+  REQUIRE(map.size() == 3);
+  REQUIRE(map.at(3) == 31);
+
+  // entries are kept in insertion order
+  std::vector<MeshID> keys;
+  for (const auto& [key, value] : map) keys.push_back(key);
+  REQUIRE(keys == std::vector<MeshID>{3, 0, 1});
+
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(!map.contains(3));
+}
+
+TEST_CASE("Test DenseMap Sparse Keys")
+{
+  // negative keys and keys far beyond the number of entries are held in the
+  // sparse index and moved to the direct index once it covers them
+  DenseMap<MeshID, int> map;
+  std::map<MeshID, int> reference;
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<MeshID> small_keys(0, 5000);
+  std::uniform_int_distribution<MeshID> large_keys(-1000000, 1000000);
+  for (int i = 0; i < 2000; i++) {
+    MeshID key = i % 3 == 0 ? large_keys(rng) : small_keys(rng);
+    map[key] = i;
+    reference[key] = i;
+  }
+  map[ID_NONE] = -1;
+  reference[ID_NONE] = -1;
+
+  REQUIRE(map.size() == reference.size());
+  for (const auto& [key, value] : reference) {
+    REQUIRE(map.contains(key));
+    REQUIRE(map.at(key) == value);
+  }
+  for (MeshID key = -100; key < 6000; key++) {
+    REQUIRE(map.contains(key) == (reference.count(key) == 1));
+  }
+}
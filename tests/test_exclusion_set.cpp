@@ -0,0 +1,70 @@
+#include <vector>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/exclusion_set.h"
+
+using namespace xdg;
+
+TEST_CASE("Test ExclusionSet")
+{
+  ExclusionSet exclude;
+  REQUIRE(exclude.empty());
+  REQUIRE(!exclude.contains(0));
+  REQUIRE(!exclude.contains(ID_NONE));
+
+  REQUIRE(exclude.insert(5));
+  REQUIRE(exclude.insert(0));
+  REQUIRE(exclude.insert(60)); // collides with 5 in the hash table
+  REQUIRE(!exclude.insert(5));
+  REQUIRE(!exclude.insert(ID_NONE));
+  REQUIRE(exclude.size() == 3);
+  REQUIRE(exclude.back() == 60);
+
+  REQUIRE(exclude.contains(5));
+  REQUIRE(exclude.contains(0));
+  REQUIRE(exclude.contains(60));
+  REQUIRE(!exclude.contains(1));
+
+  // entries are kept in insertion order
+  std::vector<MeshID> entries(exclude.begin(), exclude.end());
+  REQUIRE(entries == std::vector<MeshID>{5, 0, 60});
+
+  exclude.clear();
+  REQUIRE(exclude.empty());
+  REQUIRE(!exclude.contains(5));
+  REQUIRE(!exclude.contains(60));
+
+  ExclusionSet from_list {3, 1, 3};
+  REQUIRE(from_list.size() == 2);
+  REQUIRE(from_list.back() == 1);
+}
+
+TEST_CASE("Test ExclusionSet Overflow")
+{
+  ExclusionSet exclude;
+  const MeshID n_ids = 3 * ExclusionSet::CAPACITY;
+  for (MeshID i = 0; i < n_ids; i++) {
+    REQUIRE(exclude.insert(7 * i));
+  }
+  REQUIRE(exclude.size() == n_ids);
+  REQUIRE(exclude.back() == 7 * (n_ids - 1));
+
+  for (MeshID i = 0; i < 7 * n_ids; i++) {
+    REQUIRE(exclude.contains(i) == (i % 7 == 0));
+  }
+
+  // entries remain contiguous and in insertion order once moved to the heap
+  for (size_t i = 0; i < exclude.size(); i++) {
+    REQUIRE(exclude.data()[i] == 7 * MeshID(i));
+  }
+
+  exclude.clear();
+  REQUIRE(exclude.empty());
+  exclude.insert(14);
+  REQUIRE(exclude.size() == 1);
+  REQUIRE(exclude.contains(14));
+  REQUIRE(!exclude.contains(7));
+}
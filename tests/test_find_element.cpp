@@ -1,10 +1,16 @@
+// stl includes
+#include <array>
+#include <vector>
+
 // for testing
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 
 // xdg includes
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/embree/ray_tracer.h"
+#include "xdg/xdg.h"
 
 #include "mesh_mock.h"
 
@@ -43,3 +49,77 @@ TEST_CASE("Test Find Volumetric Element")
 }
 
 
+
+TEST_CASE("Test Find Volumetric Element with Baked Elements")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+
+  auto baked_rti = std::make_shared<EmbreeRayTracer>();
+  baked_rti->set_bake_elements(true);
+  auto [baked_volume_tree, baked_element_tree] = baked_rti->register_volume(mm, mm->volumes()[0]);
+
+  for (const auto& [geometry, element_data] : baked_rti->volume_user_data_map_) {
+    REQUIRE(element_data->baked_elements.transforms.size() == BakedTetrahedronData::STRIDE * mm->num_volume_elements(1));
+  }
+  REQUIRE(baked_rti->memory_usage().baked_elements > 0);
+  REQUIRE(rti->memory_usage().baked_elements == 0);
+
+  // point location must be identical with and without the cached transforms
+  BoundingBox bbox = mm->volume_bounding_box(mm->volumes()[0]);
+  for (int i = 0; i <= 10; i++) {
+    for (int j = 0; j <= 10; j++) {
+      Position p = bbox.lower_left() + bbox.width() * Vec3da(0.1 * i - 0.05, 0.1 * j + 0.013, 0.37);
+      MeshID element = rti->find_element(element_tree, p);
+      REQUIRE(baked_rti->find_element(baked_element_tree, p) == element);
+    }
+  }
+}
+
+TEST_CASE("Test Locate Volumetric Element")
+{
+  std::shared_ptr<MeshManager> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  BoundingBox bbox = mm->volume_bounding_box(mm->volumes()[0]);
+  std::vector<Position> points;
+  for (int i = 0; i <= 10; i++) {
+    for (int j = 0; j <= 10; j++) {
+      points.push_back(bbox.lower_left() + bbox.width() * Vec3da(0.1 * i - 0.05, 0.1 * j + 0.013, 0.37));
+    }
+  }
+
+  std::vector<ElementLocation> locations(points.size());
+  xdg->locate(points.data(), points.size(), locations.data());
+
+  for (size_t i = 0; i < points.size(); i++) {
+    const auto& location = locations[i];
+    REQUIRE(location.element == xdg->find_element(points[i]));
+    REQUIRE(xdg->locate(points[i]).element == location.element);
+    if (location.element == ID_NONE) continue;
+
+    // the barycentric coordinates reproduce the point and interpolate linear fields exactly
+    auto vertices = mm->tet_vertices(location.element);
+    Position p {0.0, 0.0, 0.0};
+    double sum = 0.0;
+    for (int v = 0; v < 4; v++) {
+      p += location.barycentrics[v] * vertices[v];
+      sum += location.barycentrics[v];
+    }
+    REQUIRE_THAT(sum, Catch::Matchers::WithinAbs(1.0, 1e-12));
+    REQUIRE_THAT((p - points[i]).length(), Catch::Matchers::WithinAbs(0.0, 1e-12));
+
+    std::array<double, 4> field;
+    for (int v = 0; v < 4; v++) field[v] = 2.0 * vertices[v].x - vertices[v].y + 3.0 * vertices[v].z + 1.0;
+    double expected = 2.0 * points[i].x - points[i].y + 3.0 * points[i].z + 1.0;
+    REQUIRE_THAT(location.interpolate(field), Catch::Matchers::WithinAbs(expected, 1e-10));
+  }
+
+  // points outside of the mesh have no element
+  REQUIRE(xdg->locate({100.0, 100.0, 100.0}).element == ID_NONE);
+}
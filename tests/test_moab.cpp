@@ -1,6 +1,9 @@
 // stl includes
+#include <chrono>
+#include <filesystem>
 #include <memory>
 #include <numeric>
+#include <random>
 
 // testing includes
 #include <catch2/catch_template_test_macros.hpp>
@@ -11,6 +14,7 @@
 #include "xdg/error.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/moab/mesh_manager.h"
+#include "xdg/util/snapshot.h"
 #include "xdg/xdg.h"
 #include "util.h"
 
@@ -86,6 +90,104 @@ TEMPLATE_TEST_CASE("Test BVH Build", "[moab][bvh]",
   }
 }
 
+TEMPLATE_TEST_CASE("Test Batched BVH Build", "[moab][bvh]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  std::shared_ptr<MeshManager> mesh_manager = std::make_shared<MOABMeshManager>();
+
+  mesh_manager->load_file("pwr_pincell.h5m");
+  mesh_manager->init();
+
+  constexpr auto rt_backend = TestType::value;
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend)) {
+    check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+
+    // trees registered one volume at a time
+    auto serial_rti = create_raytracer(rt_backend);
+    std::vector<std::pair<TreeID, TreeID>> serial_trees;
+    for (const auto& volume : mesh_manager->volumes()) {
+      serial_trees.push_back(serial_rti->register_volume(mesh_manager, volume));
+    }
+    serial_rti->init();
+
+    // trees registered together
+    auto batch_rti = create_raytracer(rt_backend);
+    auto batch_trees = batch_rti->register_volumes(mesh_manager, mesh_manager->volumes());
+    batch_rti->init();
+
+    REQUIRE(batch_trees == serial_trees);
+    REQUIRE(batch_rti->num_registered_trees() == serial_rti->num_registered_trees());
+
+    // both sets of trees give the same results
+    BoundingBox bbox = mesh_manager->global_bounding_box();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int i = 0; i < 100; i++) {
+      Position point = bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng));
+      Direction direction = Direction(uniform(rng) - 0.5, uniform(rng) - 0.5, uniform(rng) - 0.5).normalize();
+      for (const auto& [surface_tree, element_tree] : serial_trees) {
+        bool serial_inside = serial_rti->point_in_volume(surface_tree, point, &direction);
+        REQUIRE(batch_rti->point_in_volume(surface_tree, point, &direction) == serial_inside);
+        if (!serial_inside) continue;
+        auto serial_hit = serial_rti->ray_fire(surface_tree, point, direction);
+        auto batch_hit = batch_rti->ray_fire(surface_tree, point, direction);
+        REQUIRE(batch_hit.second == serial_hit.second);
+        REQUIRE_THAT(batch_hit.first, Catch::Matchers::WithinAbs(serial_hit.first, 1e-10));
+      }
+    }
+  }
+}
+
+
+#ifdef XDG_ENABLE_EMBREE
+TEST_CASE("Test Low Memory BVH Build", "[moab][bvh][embree]")
+{
+  std::shared_ptr<MeshManager> mesh_manager = std::make_shared<MOABMeshManager>();
+
+  mesh_manager->load_file("pwr_pincell.h5m");
+  mesh_manager->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto trees = rti->register_volumes(mesh_manager, mesh_manager->volumes());
+  rti->create_global_surface_tree();
+  rti->init();
+
+  // surfaces of every volume share a single scene
+  auto low_memory_rti = std::make_shared<EmbreeRayTracer>();
+  low_memory_rti->set_low_memory(true);
+  auto low_memory_trees = low_memory_rti->register_volumes(mesh_manager, mesh_manager->volumes());
+  low_memory_rti->create_global_surface_tree();
+  low_memory_rti->init();
+
+  REQUIRE(low_memory_trees == trees);
+  REQUIRE(low_memory_rti->memory_usage().total() < rti->memory_usage().total());
+
+  // queries on a volume only see the surfaces of that volume
+  BoundingBox bbox = mesh_manager->global_bounding_box();
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (int i = 0; i < 100; i++) {
+    Position point = bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng));
+    Direction direction = Direction(uniform(rng) - 0.5, uniform(rng) - 0.5, uniform(rng) - 0.5).normalize();
+    REQUIRE(low_memory_rti->find_volume(point, direction) == rti->find_volume(point, direction));
+    for (const auto& [surface_tree, element_tree] : trees) {
+      bool inside = rti->point_in_volume(surface_tree, point, &direction);
+      REQUIRE(low_memory_rti->point_in_volume(surface_tree, point, &direction) == inside);
+      auto closest = rti->closest(surface_tree, point);
+      auto low_memory_closest = low_memory_rti->closest(surface_tree, point);
+      REQUIRE(low_memory_closest.second == closest.second);
+      REQUIRE_THAT(low_memory_closest.first, Catch::Matchers::WithinAbs(closest.first, 1e-10));
+      if (!inside) continue;
+      auto hit = rti->ray_fire(surface_tree, point, direction);
+      auto low_memory_hit = low_memory_rti->ray_fire(surface_tree, point, direction);
+      REQUIRE(low_memory_hit.second == hit.second);
+      REQUIRE_THAT(low_memory_hit.first, Catch::Matchers::WithinAbs(hit.first, 1e-10));
+    }
+  }
+}
+#endif
 
 TEMPLATE_TEST_CASE("Test Ray Fire MOAB (all built backends)", "[ray_tracer][moab]",
                    Embree_Raytracer,
@@ -124,6 +226,52 @@ TEMPLATE_TEST_CASE("Test Ray Fire MOAB (all built backends)", "[ray_tracer][moab
   }
 }
 
+TEMPLATE_TEST_CASE("Test Find Volume MOAB", "[ray_tracer][moab]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend)) {
+    check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+    auto xdg = XDG::create(MeshLibrary::MOAB, rt_backend);
+
+    const auto& mm = xdg->mesh_manager();
+    mm->load_file("pwr_pincell.h5m");
+    mm->init();
+    xdg->prepare_raytracer();
+
+    MeshID ipc = mm->implicit_complement();
+
+    // reference result from a point containment query on each volume
+    auto reference_volume = [&](const Position& point, const Direction& direction) {
+      for (auto volume : mm->volumes()) {
+        if (volume == ipc) continue;
+        if (xdg->point_in_volume(volume, point, &direction)) return volume;
+      }
+      return ipc;
+    };
+
+    // sample points in and around the model
+    BoundingBox bbox = mm->global_bounding_box();
+    Position lower_left = bbox.lower_left() - 0.1 * bbox.width();
+    Vec3da width = 1.2 * bbox.width();
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (int i = 0; i < 1000; i++) {
+      Position point = lower_left + width * Vec3da(uniform(rng), uniform(rng), uniform(rng));
+      Direction direction = Direction(uniform(rng) - 0.5, uniform(rng) - 0.5, uniform(rng) - 0.5).normalize();
+      REQUIRE(xdg->find_volume(point, direction) == reference_volume(point, direction));
+    }
+
+    // points well outside of the model are in the implicit complement
+    Position outside = bbox.upper_right() + bbox.width();
+    REQUIRE(xdg->find_volume(outside, {1.0, 0.0, 0.0}) == ipc);
+    REQUIRE(xdg->find_volume(outside, {-1.0, 0.0, 0.0}) == ipc);
+  }
+}
+
 TEST_CASE("MOAB Element Types")
 {
   std::shared_ptr<XDG> xdg = XDG::create(MeshLibrary::MOAB);
@@ -282,3 +430,120 @@ TEMPLATE_TEST_CASE("TEST MOAB Find Element Method", "[moab][elements]",
     }
   }
 }
+
+TEST_CASE("Test MOAB Snapshot Cache")
+{
+  std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "xdg_test_snapshot_cache";
+  std::filesystem::remove_all(cache_dir);
+  std::filesystem::create_directories(cache_dir);
+
+  // reference mesh manager without the cache
+  auto reference = std::make_shared<MOABMeshManager>();
+  reference->load_file("jezebel.h5m");
+  reference->init();
+
+  // the first initialization builds and writes the snapshot, the second reads it
+  for (int pass = 0; pass < 2; pass++) {
+    auto mesh_manager = std::make_shared<MOABMeshManager>();
+    mesh_manager->set_snapshot_cache(cache_dir.string());
+    mesh_manager->load_file("jezebel.h5m");
+    mesh_manager->init();
+
+    auto key = snapshot::hash_file("jezebel.h5m");
+    REQUIRE(std::filesystem::exists(snapshot::cache_path(cache_dir.string(), key)));
+
+    REQUIRE(mesh_manager->volumes() == reference->volumes());
+    for (auto volume : reference->volumes()) {
+      for (auto element : reference->get_volume_elements(volume)) {
+        REQUIRE(mesh_manager->tet_vertices(element) == reference->tet_vertices(element));
+        for (int face = 0; face < 4; face++) {
+          REQUIRE(mesh_manager->adjacent_element(element, face) == reference->adjacent_element(element, face));
+        }
+      }
+    }
+    for (auto surface : reference->surfaces()) {
+      for (auto face : reference->get_surface_faces(surface)) {
+        REQUIRE(mesh_manager->face_vertices(face) == reference->face_vertices(face));
+      }
+    }
+  }
+
+  std::filesystem::remove_all(cache_dir);
+}
+
+TEST_CASE("Test MOAB Element Reordering")
+{
+  auto reference = std::make_shared<MOABMeshManager>();
+  reference->load_file("jezebel.h5m");
+  reference->init();
+
+  auto mesh_manager = std::make_shared<MOABMeshManager>();
+  mesh_manager->set_element_reordering(true);
+  mesh_manager->load_file("jezebel.h5m");
+  mesh_manager->init();
+
+  // renumbering the internal structures must not change any query by MeshID
+  REQUIRE(mesh_manager->volumes() == reference->volumes());
+  for (auto volume : reference->volumes()) {
+    REQUIRE(mesh_manager->get_volume_elements(volume) == reference->get_volume_elements(volume));
+    for (auto element : reference->get_volume_elements(volume)) {
+      REQUIRE(mesh_manager->tet_vertices(element) == reference->tet_vertices(element));
+      REQUIRE(mesh_manager->element_volume(element) == reference->element_volume(element));
+      for (int face = 0; face < 4; face++) {
+        REQUIRE(mesh_manager->adjacent_element(element, face) == reference->adjacent_element(element, face));
+      }
+    }
+  }
+  for (auto surface : reference->surfaces()) {
+    for (auto face : reference->get_surface_faces(surface)) {
+      REQUIRE(mesh_manager->face_vertices(face) == reference->face_vertices(face));
+    }
+  }
+}
+
+TEST_CASE("Test MOAB Snapshot Cache with Element Reordering")
+{
+  std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "xdg_test_snapshot_cache_reorder";
+  std::filesystem::remove_all(cache_dir);
+  std::filesystem::create_directories(cache_dir);
+
+  auto key = snapshot::hash_file("jezebel.h5m");
+  std::string plain_path = snapshot::cache_path(cache_dir.string(), key);
+  std::string reordered_path = snapshot::cache_path(cache_dir.string(), key, "reordered");
+  REQUIRE(plain_path != reordered_path);
+
+  auto init_mesh = [&](bool reorder) {
+    auto mesh_manager = std::make_shared<MOABMeshManager>();
+    mesh_manager->set_snapshot_cache(cache_dir.string());
+    mesh_manager->set_element_reordering(reorder);
+    mesh_manager->load_file("jezebel.h5m");
+    mesh_manager->init();
+    return mesh_manager;
+  };
+
+  // the first run with each setting writes its own snapshot
+  auto reference = init_mesh(false);
+  init_mesh(true);
+  REQUIRE(std::filesystem::exists(plain_path));
+  REQUIRE(std::filesystem::exists(reordered_path));
+
+  // backdate the snapshots so that a rewrite would be detected
+  auto written = std::filesystem::file_time_type::clock::now() - std::chrono::hours(1);
+  std::filesystem::last_write_time(plain_path, written);
+  std::filesystem::last_write_time(reordered_path, written);
+
+  // alternating the setting reads each snapshot from the cache
+  for (bool reorder : {false, true, false, true}) {
+    auto mesh_manager = init_mesh(reorder);
+    REQUIRE(std::filesystem::last_write_time(plain_path) == written);
+    REQUIRE(std::filesystem::last_write_time(reordered_path) == written);
+
+    for (auto volume : reference->volumes()) {
+      for (auto element : reference->get_volume_elements(volume)) {
+        REQUIRE(mesh_manager->tet_vertices(element) == reference->tet_vertices(element));
+      }
+    }
+  }
+
+  std::filesystem::remove_all(cache_dir);
+}
@@ -0,0 +1,164 @@
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/constants.h"
+#include "xdg/geometry/plucker.h"
+#include "xdg/vec3da.h"
+
+using namespace xdg;
+
+// A triangle and a set of rays to test against it
+struct PluckerCase {
+  std::array<Position, 3> triangle;
+  std::vector<Position> origins;
+  std::vector<Direction> directions;
+
+  void add_ray(const Position& origin, const Direction& direction) {
+    origins.push_back(origin);
+    directions.push_back(direction);
+  }
+};
+
+// Cases covering interior hits, misses, rays through vertices and edges,
+// rays starting on the triangle, coplanar rays, axis aligned rays and
+// degenerate triangles
+std::vector<PluckerCase> generate_cases(size_t n)
+{
+  std::mt19937 rng(1234);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  auto random_vec = [&]() { return Position(uniform(rng), uniform(rng), uniform(rng)); };
+  // coordinates on a coarse grid produce exact zeros and ties in the edge tests
+  auto grid_vec = [&]() {
+    return Position(std::round(4.0 * uniform(rng)), std::round(4.0 * uniform(rng)), std::round(4.0 * uniform(rng)));
+  };
+
+  const std::array<Direction, 6> axes {Direction(1.0, 0.0, 0.0), Direction(-1.0, 0.0, 0.0),
+                                       Direction(0.0, 1.0, 0.0), Direction(0.0, -1.0, 0.0),
+                                       Direction(0.0, 0.0, 1.0), Direction(0.0, 0.0, -1.0)};
+
+  std::vector<PluckerCase> cases;
+  for (size_t i = 0; i < n; i++) {
+    PluckerCase c;
+    c.triangle = {random_vec(), random_vec(), random_vec()};
+    const auto& tri = c.triangle;
+    Position origin = 2.0 * random_vec();
+    Position centroid = (tri[0] + tri[1] + tri[2]) / 3.0;
+    double u = 0.5 * (uniform(rng) + 1.0), v = 0.5 * (uniform(rng) + 1.0);
+    if (u + v > 1.0) { u = 1.0 - u; v = 1.0 - v; }
+    Position target = tri[0] + u * (tri[1] - tri[0]) + v * (tri[2] - tri[0]);
+
+    // random ray, mostly misses
+    c.add_ray(origin, random_vec().normalize());
+    // rays toward a random point on the triangle and away from it
+    c.add_ray(origin, (target - origin).normalize());
+    c.add_ray(origin, (origin - target).normalize());
+    // rays through each vertex and edge midpoint
+    for (int j = 0; j < 3; j++) {
+      c.add_ray(origin, (tri[j] - origin).normalize());
+      c.add_ray(origin, (0.5 * (tri[j] + tri[(j + 1) % 3]) - origin).normalize());
+    }
+    // ray starting on the triangle
+    c.add_ray(target, random_vec().normalize());
+    // coplanar ray
+    c.add_ray(centroid, (tri[1] - tri[0]).normalize());
+    cases.push_back(c);
+
+    // axis aligned rays against a triangle on a grid
+    PluckerCase grid;
+    grid.triangle = {grid_vec(), grid_vec(), grid_vec()};
+    for (const auto& axis : axes) grid.add_ray(grid_vec(), axis);
+    for (const auto& axis : axes) grid.add_ray(grid.triangle[i % 3] - 4.0 * axis, axis);
+    cases.push_back(grid);
+
+    // degenerate triangle with a repeated vertex
+    PluckerCase degenerate;
+    degenerate.triangle = {tri[0], tri[1], tri[1]};
+    degenerate.add_ray(origin, (tri[0] - origin).normalize());
+    degenerate.add_ray(origin, (tri[1] - origin).normalize());
+    degenerate.add_ray(origin, (target - origin).normalize());
+    cases.push_back(degenerate);
+  }
+  return cases;
+}
+
+// compare hits and distances bit for bit
+bool same_result(bool hit, double dist, bool ref_hit, double ref_dist)
+{
+  if (!ref_hit) ref_dist = INFTY;
+  return hit == ref_hit && std::memcmp(&dist, &ref_dist, sizeof(double)) == 0;
+}
+
+TEST_CASE("Batched Plucker Kernels Match Scalar Kernel")
+{
+  const std::vector<PluckerCase> cases = generate_cases(1001);
+
+  // triangle data for the one ray, many triangles kernel. The number of
+  // triangles is not a multiple of the SIMD width so that the scalar
+  // remainder is exercised as well
+  std::vector<double> vertices;
+  for (const auto& c : cases) {
+    for (const auto& v : c.triangle) vertices.insert(vertices.end(), {v.x, v.y, v.z});
+  }
+  REQUIRE(cases.size() % 8 != 0);
+
+  const std::array<int, 2> senses {1, -1};
+  const std::array<double, 3> ray_lengths {INFTY, 0.75, 0.0};
+
+  std::unique_ptr<bool[]> hits(new bool[cases.size()]);
+  std::vector<double> dists(cases.size());
+
+  SIMDLevel original_level = simd_level();
+  for (int level = 0; level <= static_cast<int>(max_simd_level()); level++) {
+    set_simd_level(static_cast<SIMDLevel>(level));
+    INFO("SIMD level: " << level);
+
+    for (int o = -1; o < 2; o++) {
+      // no orientation, then entering and exiting hits only
+      const int* orientation = o < 0 ? nullptr : &senses[o];
+      for (double ray_length : ray_lengths) {
+        size_t mismatches = 0;
+
+        // many rays against one triangle
+        for (const auto& c : cases) {
+          size_t n_rays = c.origins.size();
+          plucker_rays_tri_intersect_batch(c.triangle, c.origins.data(), c.directions.data(), n_rays,
+                                           hits.get(), dists.data(), ray_length, orientation);
+          for (size_t i = 0; i < n_rays; i++) {
+            double ref_dist;
+            bool ref_hit = plucker_ray_tri_intersect(c.triangle, c.origins[i], c.directions[i],
+                                                     ref_dist, ray_length, nullptr, orientation);
+            if (!same_result(hits[i], dists[i], ref_hit, ref_dist)) mismatches++;
+          }
+        }
+
+        // one ray against many triangles
+        for (size_t r = 0; r < cases.size(); r += 97) {
+          const auto& ray_case = cases[r];
+          for (size_t j = 0; j < ray_case.origins.size(); j++) {
+            const Position& origin = ray_case.origins[j];
+            const Direction& direction = ray_case.directions[j];
+            plucker_ray_tri_intersect_batch(vertices.data(), cases.size(), origin, direction,
+                                            hits.get(), dists.data(), ray_length, orientation);
+            for (size_t i = 0; i < cases.size(); i++) {
+              double ref_dist;
+              bool ref_hit = plucker_ray_tri_intersect(cases[i].triangle, origin, direction,
+                                                       ref_dist, ray_length, nullptr, orientation);
+              if (!same_result(hits[i], dists[i], ref_hit, ref_dist)) mismatches++;
+            }
+          }
+        }
+        INFO("Orientation: " << o << ", ray length: " << ray_length);
+        REQUIRE(mismatches == 0);
+      }
+    }
+  }
+  set_simd_level(original_level);
+}
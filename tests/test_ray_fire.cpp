@@ -4,10 +4,14 @@
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/generators/catch_generators.hpp>
 
+#include <random>
+#include <thread>
+
 
 // xdg includes
 #include "xdg/constants.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/stats.h"
 #include "mesh_mock.h"
 #include "util.h"
 
@@ -109,4 +113,337 @@ TEMPLATE_TEST_CASE("Ray Fire on MeshMock (per-backend sections)", "[rayfire][moc
     intersection = rti->ray_fire(volume_tree, origin, direction, INFTY, HitOrientation::EXITING, &exclude_primitives);
     REQUIRE(intersection.second == ID_NONE);
   }
-}
\ No newline at end of file
+}
+
+TEMPLATE_TEST_CASE("Batched Ray Fire on MeshMock", "[rayfire][mock][batch]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+  check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend))
+  {
+    auto rti = create_raytracer(rt_backend);
+    REQUIRE(rti);
+
+    auto mm = std::make_shared<MeshMock>(false);
+    mm->init();
+
+    auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+    rti->init();
+
+    // use a number of rays that doesn't fill the last packet for any packet size
+    constexpr size_t n_rays = 37;
+    auto [origins, directions] = random_rays_in_mock(n_rays);
+
+    // reference results from single ray queries
+    std::vector<std::pair<double, MeshID>> expected;
+    for (size_t i = 0; i < n_rays; i++) {
+      expected.push_back(rti->ray_fire(volume_tree, origins[i], directions[i]));
+    }
+
+    std::vector<int> packet_sizes {1};
+#ifdef XDG_ENABLE_EMBREE
+    if (auto embree_rti = std::dynamic_pointer_cast<EmbreeRayTracer>(rti)) packet_sizes = {1, 4, 8, 16};
+#endif
+
+    for (int packet_size : packet_sizes) {
+#ifdef XDG_ENABLE_EMBREE
+      if (auto embree_rti = std::dynamic_pointer_cast<EmbreeRayTracer>(rti)) embree_rti->set_packet_size(packet_size);
+#endif
+      std::vector<std::pair<double, MeshID>> hits(n_rays);
+      rti->ray_fire(volume_tree, origins.data(), directions.data(), n_rays, hits.data());
+      for (size_t i = 0; i < n_rays; i++) {
+        REQUIRE(hits[i].second == expected[i].second);
+        REQUIRE_THAT(hits[i].first, Catch::Matchers::WithinAbs(expected[i].first, 1e-12));
+      }
+
+      // each ray records its hit primitive in its own exclusion set and
+      // should find no exiting hit once that primitive is excluded
+      std::vector<ExclusionSet> exclude_primitives(n_rays);
+      rti->ray_fire(volume_tree, origins.data(), directions.data(), n_rays, hits.data(),
+                    INFTY, HitOrientation::EXITING, exclude_primitives.data());
+      for (size_t i = 0; i < n_rays; i++) {
+        REQUIRE(exclude_primitives[i].size() == 1);
+      }
+
+      rti->ray_fire(volume_tree, origins.data(), directions.data(), n_rays, hits.data(),
+                    INFTY, HitOrientation::EXITING, exclude_primitives.data());
+      for (size_t i = 0; i < n_rays; i++) {
+        REQUIRE(hits[i].second == ID_NONE);
+      }
+    }
+  }
+}
+
+TEMPLATE_TEST_CASE("Concurrent Queries with Query Contexts on MeshMock", "[rayfire][mock][threads]",
+                   Embree_Raytracer,
+                   GPRT_Raytracer)
+{
+  constexpr auto rt_backend = TestType::value;
+  check_ray_tracer_supported(rt_backend); // skip if backend not enabled at configuration time
+
+  DYNAMIC_SECTION(fmt::format("Backend = {}", rt_backend))
+  {
+    auto rti = create_raytracer(rt_backend);
+    REQUIRE(rti);
+
+    auto mm = std::make_shared<MeshMock>(false);
+    mm->init();
+
+    auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+    rti->init();
+
+    constexpr size_t n_threads = 4;
+    constexpr size_t n_rays = 1000;
+    auto [origins, directions] = random_rays_in_mock(n_rays);
+
+    // reference results from serial queries without a context
+    std::vector<std::pair<double, MeshID>> expected_hits, expected_closest;
+    for (size_t i = 0; i < n_rays; i++) {
+      expected_hits.push_back(rti->ray_fire(volume_tree, origins[i], directions[i]));
+      expected_closest.push_back(rti->closest(volume_tree, origins[i]));
+    }
+
+    // each thread owns a context and repeats every query
+    auto counts_before = stats::snapshot();
+    std::vector<QueryContext> contexts(n_threads);
+    std::vector<size_t> mismatches(n_threads, 0);
+    auto run_queries = [&](size_t t) {
+      QueryContext& context = contexts[t];
+      for (size_t i = 0; i < n_rays; i++) {
+        context.clear();
+        if (!rti->point_in_volume(volume_tree, origins[i], &directions[i], context)) mismatches[t]++;
+        if (rti->closest(volume_tree, origins[i]) != expected_closest[i]) mismatches[t]++;
+        auto hit = rti->ray_fire(volume_tree, origins[i], directions[i], context);
+        if (hit != expected_hits[i]) mismatches[t]++;
+        // the hit primitive is now excluded for this context only
+        if (rti->ray_fire(volume_tree, origins[i], directions[i], context).second != ID_NONE) mismatches[t]++;
+      }
+      const auto& hits = rti->ray_fire(volume_tree, origins.data(), directions.data(), n_rays, context);
+      for (size_t i = 0; i < n_rays; i++) {
+        if (hits[i] != expected_hits[i]) mismatches[t]++;
+      }
+    };
+
+    if (rti->concurrent_queries()) {
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < n_threads; t++) threads.emplace_back(run_queries, t);
+      for (auto& thread : threads) thread.join();
+    } else {
+      for (size_t t = 0; t < n_threads; t++) run_queries(t);
+    }
+
+    for (size_t t = 0; t < n_threads; t++) {
+      REQUIRE(mismatches[t] == 0);
+      REQUIRE(contexts[t].hits.size() == n_rays);
+    }
+
+    // queries from every thread are counted by the statistics counters
+    if (stats::enabled() && rt_backend == RTLibrary::EMBREE) {
+      auto counts = stats::snapshot();
+      REQUIRE(counts[stats::Counter::RAY_FIRE] - counts_before[stats::Counter::RAY_FIRE] == 3 * n_threads * n_rays);
+      REQUIRE(counts[stats::Counter::POINT_IN_VOLUME] - counts_before[stats::Counter::POINT_IN_VOLUME] == n_threads * n_rays);
+      REQUIRE(counts[stats::Counter::CLOSEST] - counts_before[stats::Counter::CLOSEST] == n_threads * n_rays);
+    }
+  }
+}
+
+#ifdef XDG_ENABLE_EMBREE
+TEST_CASE("Ray Fire with baked triangles on MeshMock", "[rayfire][mock][embree]")
+{
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+
+  auto baked_rti = std::make_shared<EmbreeRayTracer>();
+  baked_rti->set_bake_triangles(true);
+  auto [baked_volume_tree, baked_element_tree] = baked_rti->register_volume(mm, mm->volumes()[0]);
+
+  for (const auto& [geometry, surface_data] : baked_rti->surface_user_data_map_) {
+    REQUIRE(!surface_data->baked_triangles.empty());
+  }
+
+  // results should be identical with and without the triangle cache
+  auto rays = random_rays_in_mock(100);
+  for (size_t i = 0; i < rays.size(); i++) {
+    const Position& origin = rays.origins[i];
+    const Direction& direction = rays.directions[i];
+
+    auto hit = rti->ray_fire(volume_tree, origin, direction);
+    auto baked_hit = baked_rti->ray_fire(baked_volume_tree, origin, direction);
+    REQUIRE(hit.second == baked_hit.second);
+    REQUIRE(hit.first == baked_hit.first);
+
+    auto closest = rti->closest(volume_tree, origin);
+    auto baked_closest = baked_rti->closest(baked_volume_tree, origin);
+    REQUIRE(closest.second == baked_closest.second);
+    REQUIRE(closest.first == baked_closest.first);
+  }
+}
+#endif
+
+#ifdef XDG_ENABLE_EMBREE
+TEST_CASE("Ray Fire with native triangle geometry on MeshMock", "[rayfire][mock][embree]")
+{
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+
+  auto native_rti = std::make_shared<EmbreeRayTracer>();
+  native_rti->set_native_triangles(true);
+  auto [native_volume_tree, native_element_tree] = native_rti->register_volume(mm, mm->volumes()[0]);
+
+  // the same checks as the user geometry path
+  Position origin {0.0, 0.0, 0.0};
+  auto intersection = native_rti->ray_fire(native_volume_tree, origin, {1.0, 0.0, 0.0});
+  REQUIRE_THAT(intersection.first, Catch::Matchers::WithinAbs(5.0, 1e-6));
+  intersection = native_rti->ray_fire(native_volume_tree, origin, {-1.0, 0.0, 0.0});
+  REQUIRE_THAT(intersection.first, Catch::Matchers::WithinAbs(2.0, 1e-6));
+  intersection = native_rti->ray_fire(native_volume_tree, origin, {1.0, 0.0, 0.0}, INFTY, HitOrientation::ENTERING);
+  REQUIRE(intersection.second == ID_NONE);
+  intersection = native_rti->ray_fire(native_volume_tree, origin, {0.0, 0.0, 1.0}, 4.5);
+  REQUIRE(intersection.second == ID_NONE);
+
+  std::vector<MeshID> exclude_primitives;
+  intersection = native_rti->ray_fire(native_volume_tree, origin, {0.0, 0.0, 1.0}, INFTY, HitOrientation::EXITING, &exclude_primitives);
+  REQUIRE_THAT(intersection.first, Catch::Matchers::WithinAbs(7.0, 1e-6));
+  REQUIRE(exclude_primitives.size() == 1);
+  intersection = native_rti->ray_fire(native_volume_tree, origin, {0.0, 0.0, 1.0}, INFTY, HitOrientation::EXITING, &exclude_primitives);
+  REQUIRE(intersection.second == ID_NONE);
+
+  REQUIRE(native_rti->point_in_volume(native_volume_tree, origin));
+  REQUIRE_FALSE(native_rti->point_in_volume(native_volume_tree, {0.0, 0.0, 100.0}));
+
+  double dist;
+  REQUIRE(native_rti->occluded(native_volume_tree, origin, {1.0, 0.0, 0.0}, dist));
+  REQUIRE_FALSE(native_rti->occluded(native_volume_tree, {0.0, 0.0, 100.0}, {0.0, 0.0, 1.0}, dist));
+
+  // hits should match the user geometry path
+  auto [origins, directions] = random_rays_in_mock(100);
+  for (size_t i = 0; i < origins.size(); i++) {
+    auto hit = rti->ray_fire(volume_tree, origins[i], directions[i]);
+    auto native_hit = native_rti->ray_fire(native_volume_tree, origins[i], directions[i]);
+    REQUIRE(hit.second == native_hit.second);
+    REQUIRE_THAT(native_hit.first, Catch::Matchers::WithinAbs(hit.first, 1e-10));
+  }
+
+  // packets are supported with native triangle geometry as well
+  std::vector<std::pair<double, MeshID>> hits(origins.size());
+  native_rti->ray_fire(native_volume_tree, origins.data(), directions.data(), origins.size(), hits.data());
+  for (size_t i = 0; i < origins.size(); i++) {
+    auto hit = rti->ray_fire(volume_tree, origins[i], directions[i]);
+    REQUIRE(hit.second == hits[i].second);
+    REQUIRE_THAT(hits[i].first, Catch::Matchers::WithinAbs(hit.first, 1e-10));
+  }
+}
+#endif
+
+#ifdef XDG_ENABLE_EMBREE
+TEST_CASE("Native triangle geometry on grazing edge rays", "[rayfire][mock][embree]")
+{
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+
+  auto native_rti = std::make_shared<EmbreeRayTracer>();
+  native_rti->set_native_triangles(true);
+  auto [native_volume_tree, native_element_tree] = native_rti->register_volume(mm, mm->volumes()[0]);
+
+  // fire rays from inside the box at points on and just off of each triangle
+  // edge, including the diagonals shared by the two triangles of each face
+  Position origin {0.0, 0.0, 0.0};
+  std::vector<double> offsets {0.0, 1e-15, -1e-15, 1e-12, -1e-12, 1e-9, -1e-9};
+  for (auto surface : mm->surfaces()) {
+    for (auto face : mm->get_surface_faces(surface)) {
+      auto vertices = mm->face_vertices(face);
+      Direction normal = mm->face_normal(face);
+      for (int j = 0; j < 3; j++) {
+        const Vertex& a = vertices[j];
+        const Vertex& b = vertices[(j + 1) % 3];
+        Direction in_plane = (b - a).cross(normal).normalize();
+        for (double t : {0.3, 0.5}) {
+          for (double offset : offsets) {
+            Position target = a + t * (b - a) + offset * in_plane;
+            Direction u = (target - origin).normalize();
+
+            auto hit = rti->ray_fire(volume_tree, origin, u);
+            auto native_hit = native_rti->ray_fire(native_volume_tree, origin, u);
+            REQUIRE(hit.second != ID_NONE);
+            REQUIRE(native_hit.second != ID_NONE);
+            REQUIRE_THAT(native_hit.first, Catch::Matchers::WithinAbs(hit.first, 1e-8));
+
+            // the occlusion filter should refine the same candidates
+            double dist, native_dist;
+            REQUIRE(rti->occluded(volume_tree, origin, u, dist));
+            REQUIRE(native_rti->occluded(native_volume_tree, origin, u, native_dist));
+            REQUIRE(dist == native_dist);
+          }
+        }
+      }
+    }
+  }
+
+  // rays that miss the geometry by more than single precision round-off are
+  // not occluded
+  double dist;
+  REQUIRE_FALSE(native_rti->occluded(native_volume_tree, {0.0, 0.0, 7.0 + 1e-3}, {0.0, 0.0, 1.0}, dist));
+  REQUIRE_FALSE(native_rti->occluded(native_volume_tree, {5.0 + 1e-3, 0.0, 0.0}, {0.0, 1.0, 0.0}, dist));
+}
+#endif
+
+#ifdef XDG_ENABLE_EMBREE
+TEST_CASE("Ray Fire with low memory mode on MeshMock", "[rayfire][mock][embree]")
+{
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+  rti->create_global_surface_tree();
+
+  auto low_memory_rti = std::make_shared<EmbreeRayTracer>();
+  low_memory_rti->set_low_memory(true);
+  REQUIRE_FALSE(low_memory_rti->volume_trees());
+  REQUIRE(low_memory_rti->tree_build_settings(TreeClass::VOLUME_SURFACE).compact);
+  auto [low_memory_volume_tree, low_memory_element_tree] = low_memory_rti->register_volume(mm, mm->volumes()[0]);
+  low_memory_rti->create_global_surface_tree();
+
+  // memory is only held by the shared surface scene
+  auto usage = low_memory_rti->memory_usage();
+  REQUIRE(usage.volume_surface_trees == 0);
+  REQUIRE(usage.primitive_refs == mm->num_volume_faces(mm->volumes()[0]) * sizeof(PrimitiveRef));
+  REQUIRE(usage.baked_triangles == 0);
+  REQUIRE(usage.total() > 0);
+  REQUIRE(rti->memory_usage().volume_surface_trees > 0);
+
+  // results should be identical to those of the per-volume trees
+  auto rays = random_rays_in_mock(100);
+  for (size_t i = 0; i < rays.size(); i++) {
+    const Position& origin = rays.origins[i];
+    const Direction& direction = rays.directions[i];
+
+    REQUIRE(rti->point_in_volume(volume_tree, origin) ==
+            low_memory_rti->point_in_volume(low_memory_volume_tree, origin));
+
+    auto hit = rti->ray_fire(volume_tree, origin, direction);
+    auto low_memory_hit = low_memory_rti->ray_fire(low_memory_volume_tree, origin, direction);
+    REQUIRE(hit.second == low_memory_hit.second);
+    REQUIRE_THAT(low_memory_hit.first, Catch::Matchers::WithinAbs(hit.first, 1e-10));
+
+    auto closest = rti->closest(volume_tree, origin);
+    auto low_memory_closest = low_memory_rti->closest(low_memory_volume_tree, origin);
+    REQUIRE(closest.second == low_memory_closest.second);
+    REQUIRE_THAT(low_memory_closest.first, Catch::Matchers::WithinAbs(closest.first, 1e-10));
+
+    REQUIRE(rti->find_volume(origin, direction) == low_memory_rti->find_volume(origin, direction));
+  }
+}
+#endif
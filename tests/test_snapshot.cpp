@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/util/snapshot.h"
+
+using namespace xdg;
+
+TEST_CASE("Test Snapshot Round Trip")
+{
+  std::string path = (std::filesystem::temp_directory_path() / "xdg_test_snapshot.xdgsnap").string();
+
+  std::vector<double> coords {0.0, 1.5, -2.25, 3.0, 4.125};
+  std::vector<int32_t> connectivity {0, 1, 2, 2, 3, 4, -1};
+  std::vector<int32_t> empty;
+  size_t extent = 42;
+
+  SnapshotWriter writer(1234);
+  writer.add("coords", coords);
+  writer.add("connectivity", connectivity);
+  writer.add("empty", empty);
+  writer.add_value("extent", extent);
+  REQUIRE(writer.write(path));
+
+  SnapshotReader reader;
+  REQUIRE(reader.open(path, 1234));
+  REQUIRE(reader.contains("coords"));
+  REQUIRE(!reader.contains("missing"));
+
+  std::vector<double> coords_in;
+  std::vector<int32_t> connectivity_in {7};
+  std::vector<int32_t> empty_in {7};
+  size_t extent_in = 0;
+  REQUIRE(reader.read("coords", coords_in));
+  REQUIRE(reader.read("connectivity", connectivity_in));
+  REQUIRE(reader.read("empty", empty_in));
+  REQUIRE(reader.read_value("extent", extent_in));
+  REQUIRE(coords_in == coords);
+  REQUIRE(connectivity_in == connectivity);
+  REQUIRE(empty_in.empty());
+  REQUIRE(extent_in == extent);
+
+  // sections are not read as values of the wrong size
+  std::vector<double> wrong_type;
+  int wrong_value;
+  REQUIRE(!reader.read("connectivity", wrong_type));
+  REQUIRE(!reader.read_value("extent", wrong_value));
+  REQUIRE(!reader.read("missing", coords_in));
+
+  // snapshots with another key are rejected
+  reader.close();
+  REQUIRE(!reader.is_open());
+  REQUIRE(!reader.open(path, 4321));
+
+  // truncated snapshots are rejected
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 16);
+  REQUIRE(!reader.open(path, 1234));
+
+  std::remove(path.c_str());
+  REQUIRE(!reader.open(path, 1234));
+}
+
+TEST_CASE("Test Snapshot File Hash")
+{
+  auto dir = std::filesystem::temp_directory_path();
+  std::string path_a = (dir / "xdg_test_hash_a.txt").string();
+  std::string path_b = (dir / "xdg_test_hash_b.txt").string();
+  std::ofstream(path_a) << "xdg mesh";
+  std::ofstream(path_b) << "xdg mesg";
+
+  REQUIRE(snapshot::hash_file(path_a) == snapshot::hash_file(path_a));
+  REQUIRE(snapshot::hash_file(path_a) != snapshot::hash_file(path_b));
+  REQUIRE(snapshot::cache_path("cache", 0xabc) == "cache/0000000000000abc.xdgsnap");
+  REQUIRE(snapshot::cache_path("cache", 0xabc, "reordered") == "cache/0000000000000abc-reordered.xdgsnap");
+
+  std::remove(path_a.c_str());
+  std::remove(path_b.c_str());
+}
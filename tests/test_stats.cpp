@@ -0,0 +1,76 @@
+#include <thread>
+#include <vector>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/stats.h"
+#include "xdg/embree/ray_tracer.h"
+
+#include "mesh_mock.h"
+
+using namespace xdg;
+using namespace xdg::stats;
+
+TEST_CASE("Test Statistics Counters")
+{
+  reset();
+  REQUIRE(snapshot()[Counter::RAY_FIRE] == 0);
+
+  // counters of threads that have exited are retained
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 1000; i++) detail::increment(Counter::RAY_FIRE);
+      detail::increment(Counter::TRIANGLE_TESTS, 10);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  detail::increment(Counter::SEGMENTS, 3);
+
+  Snapshot counts = snapshot();
+  REQUIRE(counts[Counter::RAY_FIRE] == 4000);
+  REQUIRE(counts[Counter::TRIANGLE_TESTS] == 40);
+  REQUIRE(counts[Counter::SEGMENTS] == 3);
+  REQUIRE(counts[Counter::CLOSEST] == 0);
+  REQUIRE(counts.to_json().find("\"ray_fire\": 4000") != std::string::npos);
+  REQUIRE(counts.to_json().find("\"segments\": 3") != std::string::npos);
+
+  // resetting clears the counters of both live and exited threads
+  reset();
+  counts = snapshot();
+  REQUIRE(counts[Counter::RAY_FIRE] == 0);
+  REQUIRE(counts[Counter::SEGMENTS] == 0);
+  detail::increment(Counter::SEGMENTS);
+  REQUIRE(snapshot()[Counter::SEGMENTS] == 1);
+  reset();
+}
+
+TEST_CASE("Test Statistics Hooks")
+{
+  auto mm = std::make_shared<MeshMock>(false);
+  mm->init();
+
+  auto rti = std::make_shared<EmbreeRayTracer>();
+  auto [volume_tree, element_tree] = rti->register_volume(mm, mm->volumes()[0]);
+  rti->init();
+
+  reset();
+  rti->ray_fire(volume_tree, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0});
+  rti->ray_fire(volume_tree, {0.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, INFTY, HitOrientation::ENTERING);
+  rti->closest(volume_tree, {0.0, 0.0, 0.0});
+
+  // hooks only count when enabled at configuration time
+  Snapshot counts = snapshot();
+  if (enabled()) {
+    REQUIRE(counts[Counter::RAY_FIRE] == 2);
+    REQUIRE(counts[Counter::CLOSEST] == 1);
+    REQUIRE(counts[Counter::TRIANGLE_TESTS] > 0);
+    REQUIRE(counts[Counter::TRIANGLE_HITS] >= 1);
+    REQUIRE(counts[Counter::ORIENTATION_CULLS] >= 1);
+  } else {
+    for (auto value : counts.values) REQUIRE(value == 0);
+  }
+  reset();
+}
@@ -1,11 +1,17 @@
 // stl includes
+#include <algorithm>
+#include <map>
 #include <memory>
+#include <random>
+#include <vector>
 
 // testing includes
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_approx.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
+#include "xdg/stats.h"
+#include "xdg/tally.h"
 #include "xdg/xdg.h"
 
 #include "mesh_mock.h"
@@ -70,3 +76,185 @@ TEST_CASE("Test Walk Elements") {
   REQUIRE(r.y == Catch::Approx(upper_right_corner.y).epsilon(1e-04));
   REQUIRE(r.z == Catch::Approx(upper_right_corner.z).epsilon(1e-04));
 }
+
+TEST_CASE("Test Batched Segments") {
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  // tracks between random points within the mesh
+  BoundingBox bbox = mm->bounding_box();
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uniform(0.01, 0.99);
+  size_t n_tracks = 200;
+  std::vector<Position> starts, ends;
+  for (size_t i = 0; i < n_tracks; i++) {
+    starts.push_back(bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng)));
+    ends.push_back(bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng)));
+  }
+
+  SegmentBatch batch;
+  // the batch is reused, so run it twice with a smaller batch in between
+  for (size_t n : {n_tracks, n_tracks / 3, n_tracks}) {
+    xdg->segments(starts.data(), ends.data(), n, batch);
+    REQUIRE(batch.n_tracks() == n);
+    REQUIRE(batch.offsets.front() == 0);
+    REQUIRE(batch.offsets.back() == batch.size());
+    REQUIRE(batch.lengths.size() == batch.size());
+
+    // segments should match those of each track computed on its own
+    for (size_t i = 0; i < n; i++) {
+      auto segments = xdg->segments(starts[i], ends[i]);
+      REQUIRE(batch.n_segments(i) == segments.size());
+      double length = 0.0;
+      for (size_t j = 0; j < segments.size(); j++) {
+        REQUIRE(batch.elements[batch.offsets[i] + j] == segments[j].first);
+        REQUIRE(batch.lengths[batch.offsets[i] + j] == segments[j].second);
+        length += segments[j].second;
+      }
+      REQUIRE_THAT(length, Catch::Matchers::WithinAbs((ends[i] - starts[i]).length(), 1e-6));
+    }
+  }
+
+  // an empty batch has no segments
+  xdg->segments(starts.data(), ends.data(), 0, batch);
+  REQUIRE(batch.n_tracks() == 0);
+  REQUIRE(batch.size() == 0);
+}
+
+TEST_CASE("Test Mesh Tally") {
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  int n_groups = 2;
+  MeshTally tally(xdg, n_groups);
+  REQUIRE(tally.elements().size() == 12);
+  REQUIRE(tally.n_bins() == 24);
+
+  BoundingBox bbox = mm->bounding_box();
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uniform(0.01, 0.99);
+  size_t n_tracks = 500;
+  std::vector<Position> starts, ends;
+  std::vector<double> weights;
+  std::vector<int> groups;
+  for (size_t i = 0; i < n_tracks; i++) {
+    starts.push_back(bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng)));
+    ends.push_back(bbox.lower_left() + bbox.width() * Vec3da(uniform(rng), uniform(rng), uniform(rng)));
+    weights.push_back(uniform(rng));
+    groups.push_back(i % n_groups);
+  }
+
+  // score the tracks in two batches
+  tally.score(starts.data(), ends.data(), weights.data(), groups.data(), n_tracks / 2);
+  tally.score(starts.data() + n_tracks / 2, ends.data() + n_tracks / 2, weights.data() + n_tracks / 2,
+              groups.data() + n_tracks / 2, n_tracks - n_tracks / 2);
+
+  // reference results accumulated one track at a time
+  std::map<std::pair<MeshID, int>, double> expected;
+  double total = 0.0;
+  for (size_t i = 0; i < n_tracks; i++) {
+    for (const auto& [element, length] : xdg->segments(starts[i], ends[i])) {
+      expected[{element, groups[i]}] += weights[i] * length;
+      total += weights[i] * length;
+    }
+  }
+
+  double tally_total = 0.0;
+  for (auto element : tally.elements()) {
+    for (int group = 0; group < n_groups; group++) {
+      double result = tally.result(element, group);
+      REQUIRE_THAT(result, Catch::Matchers::WithinRel(expected[{element, group}], 1e-12));
+      REQUIRE_THAT(tally.flux(element, group), Catch::Matchers::WithinRel(result / mm->element_volume(element), 1e-12));
+      tally_total += result;
+    }
+  }
+  REQUIRE_THAT(tally_total, Catch::Matchers::WithinRel(total, 1e-12));
+
+  tally.reset();
+  for (double result : tally.results()) REQUIRE(result == 0.0);
+}
+
+TEST_CASE("Test Face Elements") {
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  MeshID volume = mm->volumes().front();
+
+  // every boundary face of the mock is shared with exactly one element inside the volume
+  for (auto surface : mm->surfaces()) {
+    for (auto face : mm->get_surface_faces(surface)) {
+      MeshID element = xdg->face_element(face, Sense::FORWARD);
+      REQUIRE(element != ID_NONE);
+      REQUIRE(xdg->face_element(face, Sense::REVERSE) == ID_NONE);
+
+      auto element_vertices = mm->tet_vertices(element);
+      for (const auto& vertex : mm->face_vertices(face)) {
+        bool shared = std::any_of(element_vertices.begin(), element_vertices.end(),
+                                  [&](const Vertex& v) { return (v - vertex).length() == 0.0; });
+        REQUIRE(shared);
+      }
+    }
+  }
+
+  // a track entering the volume from outside starts in the element on the face it hits
+  BoundingBox bbox = mm->bounding_box();
+  Position start = bbox.lower_left() + bbox.width() * Vec3da(-0.5, 0.3, 0.4);
+  Position end = bbox.lower_left() + bbox.width() * Vec3da(0.7, 0.6, 0.45);
+  auto segments = xdg->segments(volume, start, end);
+  REQUIRE(segments.size() > 0);
+
+  double length = 0.0;
+  for (const auto& segment : segments) length += segment.second;
+  double inside_fraction = 0.7 / 1.2; // fraction of the track with x inside the box
+  REQUIRE_THAT(length, Catch::Matchers::WithinAbs(inside_fraction * (end - start).length(), 1e-6));
+}
+
+TEST_CASE("Test Segments Entering the Mesh") {
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init(); // this should do nothing
+  mm->create_implicit_complement();
+  std::shared_ptr<XDG> xdg = std::make_shared<XDG>(mm);
+  xdg->prepare_raytracer();
+
+  // a track starting outside of the mesh that crosses into it
+  BoundingBox bbox = mm->bounding_box();
+  Position start = bbox.lower_left() + bbox.width() * Vec3da(-0.5, 0.3, 0.4);
+  Position end = bbox.lower_left() + bbox.width() * Vec3da(0.7, 0.6, 0.45);
+  REQUIRE(xdg->find_element(start) == ID_NONE);
+
+  auto segments = xdg->segments(start, end);
+  REQUIRE(segments.size() > 0);
+
+  // the entry element should match a point location query just past the
+  // surface hit through the implicit complement
+  Direction u = (end - start).normalize();
+  auto hit = xdg->ray_fire(mm->implicit_complement(), start, u);
+  REQUIRE(hit.second != ID_NONE);
+  MeshID entry_element = xdg->find_element(start + u * (hit.first + TINY_BIT));
+  REQUIRE(segments.front().first == entry_element);
+
+  double length = 0.0;
+  for (const auto& segment : segments) length += segment.second;
+  REQUIRE_THAT(length, Catch::Matchers::WithinAbs((end - start).length() - hit.first, 1e-6));
+
+  // a track passing through the mesh leaves it through a model boundary face,
+  // which is recognized without a point location query at the exit point
+  Position exit_end = bbox.lower_left() + bbox.width() * Vec3da(1.5, 0.8, 0.5);
+  auto counts_before = stats::snapshot();
+  segments = xdg->segments(start, exit_end);
+  auto counts = stats::snapshot();
+  if (stats::enabled()) {
+    REQUIRE(counts[stats::Counter::FIND_ELEMENT] - counts_before[stats::Counter::FIND_ELEMENT] == 1);
+  }
+
+  length = 0.0;
+  for (const auto& segment : segments) length += segment.second;
+  double inside_fraction = 1.0 / 2.0; // fraction of the track with x inside the box
+  REQUIRE_THAT(length, Catch::Matchers::WithinAbs(inside_fraction * (exit_end - start).length(), 1e-6));
+}
@@ -1,5 +1,6 @@
 // stl includes
 #include <memory>
+#include <vector>
 
 // testing includes
 #include <catch2/catch_test_macros.hpp>
@@ -92,4 +93,24 @@ TEST_CASE("Tetrahedron Intersection Unit Test")
   // Test points that are in one tet but not the other
   CHECK(plucker_tet_containment_test(inside_point, v0_2, v1_2, v2_2, v3_2) == false);
   CHECK(plucker_tet_containment_test(inside_point_2, v0, v1, v2, v3) == false);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Tetrahedron Barycentric Transform Containment")
+{
+  Position v0(0.0, 0.0, 0.0);
+  Position v1(1.0, 0.0, 0.0);
+  Position v2(0.0, 1.0, 0.0);
+  Position v3(0.0, 0.0, 1.0);
+  TetTransform transform = tet_barycentric_transform(v0, v1, v2, v3);
+
+  // the precomputed transform gives the same result as the direct test
+  std::vector<Position> points {{0.1, 0.1, 0.1}, {2.0, 2.0, 2.0}, {0.0, 0.0, 0.5}, {-0.5, -0.5, 0.0},
+                                {0.3, 0.3, 0.3}, {0.4, 0.4, 0.4}, {0.3, 0.3, -0.1}, {0.25, 0.25, 0.25}};
+  for (const auto& p : points) {
+    CHECK(tet_transform_containment_test(p, transform.data()) == plucker_tet_containment_test(p, v0, v1, v2, v3));
+  }
+
+  // no point is inside a degenerate tetrahedron
+  TetTransform flat = tet_barycentric_transform(v0, v1, v2, {1.0, 1.0, 0.0});
+  CHECK(tet_transform_containment_test({0.1, 0.1, 0.0}, flat.data()) == false);
+}
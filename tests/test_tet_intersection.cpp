@@ -1,10 +1,13 @@
 // stl includes
+#include <algorithm>
 #include <memory>
+#include <random>
 
 // testing includes
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
 
+#include "xdg/geometry/plucker.h"
 #include "xdg/ray_tracing_interface.h"
 #include "xdg/tetrahedron_contain.h"
 #include "xdg/vec3da.h"
@@ -32,4 +35,70 @@ TEST_CASE("Tetrahedron Intersection Unit Test")
   // Check point that is co-planar with one of the faces, but outside the tet
   Position coplanar_exterior_point(-0.5, -0.5, 0.0);
   REQUIRE(plucker_tet_containment_test(coplanar_exterior_point, v0, v1, v2, v3) == false);
-}
\ No newline at end of file
+}
+
+// exit distance through each face of the tet, computed by testing the faces independently
+std::array<double, 4> reference_tet_exit(const std::array<Position, 4>& v,
+                                         const std::array<std::array<int, 3>, 4>& faces,
+                                         const Position& origin,
+                                         const Direction& direction)
+{
+  std::array<double, 4> dists;
+  for (int i = 0; i < 4; i++) {
+    int orientation = 1;
+    plucker_ray_tri_intersect({v[faces[i][0]], v[faces[i][1]], v[faces[i][2]]},
+                              origin, direction, dists[i], INFTY, nullptr, &orientation);
+    dists[i] = std::max(0.0, dists[i]);
+  }
+  return dists;
+}
+
+TEST_CASE("Tetrahedron Exit Face Matches Per-Face Plucker Tests")
+{
+  // MOAB canonical face ordering, normals pointing out of the element
+  const std::array<std::array<int, 3>, 4> faces {{{0, 1, 3}, {1, 2, 3}, {2, 0, 3}, {0, 2, 1}}};
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  auto random_vec = [&]() { return Position(uniform(rng), uniform(rng), uniform(rng)); };
+
+  // rays from inside and outside of the tetrahedron, along its edges and
+  // through its vertices
+  auto check = [&](const std::array<Position, 4>& v, const Position& origin, const Direction& direction) {
+    double dist;
+    int face = plucker_ray_tet_exit(v, faces, origin, direction, dist);
+    auto ref_dists = reference_tet_exit(v, faces, origin, direction);
+    double ref_dist = *std::min_element(ref_dists.begin(), ref_dists.end());
+    if (ref_dist == INFTY) {
+      REQUIRE(face == -1);
+      REQUIRE(dist == INFTY);
+    } else {
+      REQUIRE_THAT(dist, Catch::Matchers::WithinAbs(ref_dist, 1e-12));
+      // rays through a vertex or edge may exit through any face sharing it
+      REQUIRE(face >= 0);
+      REQUIRE_THAT(ref_dists[face], Catch::Matchers::WithinAbs(ref_dist, 1e-12));
+    }
+  };
+
+  std::array<Position, 4> unit_tet {Position(0.0, 0.0, 0.0), Position(1.0, 0.0, 0.0),
+                                    Position(0.0, 1.0, 0.0), Position(0.0, 0.0, 1.0)};
+  double dist;
+  REQUIRE(plucker_ray_tet_exit(unit_tet, faces, {0.1, 0.1, 0.1}, {0.0, 0.0, -1.0}, dist) == 3);
+  REQUIRE_THAT(dist, Catch::Matchers::WithinAbs(0.1, 1e-15));
+  REQUIRE(plucker_ray_tet_exit(unit_tet, faces, {0.1, 0.1, 0.1}, Direction(1.0, 1.0, 1.0).normalize(), dist) == 1);
+
+  for (int i = 0; i < 10000; i++) {
+    std::array<Position, 4> v {random_vec(), random_vec(), random_vec(), random_vec()};
+    // ensure the faces are wound with outward normals
+    if ((v[1] - v[0]).cross(v[2] - v[0]).dot(v[3] - v[0]) < 0.0) std::swap(v[1], v[2]);
+
+    Direction direction = random_vec().normalize();
+    Position centroid = 0.25 * (v[0] + v[1] + v[2] + v[3]);
+
+    check(v, centroid, direction);
+    check(v, random_vec(), direction);
+    check(v, v[i % 4], direction);
+    check(v, 0.5 * (v[i % 4] + v[(i + 1) % 4]), direction);
+    check(v, centroid, (v[i % 4] - centroid).normalize());
+  }
+}
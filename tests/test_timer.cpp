@@ -0,0 +1,74 @@
+#include <sstream>
+#include <string>
+
+// testing includes
+#include <catch2/catch_test_macros.hpp>
+
+// xdg includes
+#include "xdg/timer.h"
+
+using namespace xdg;
+
+// a query path instrumented with a sampled timer
+static void sampled_query()
+{
+  XDG_SAMPLED_TIMER("query");
+}
+
+TEST_CASE("Test Scoped Timers")
+{
+  reset_timers();
+
+  {
+    ScopedTimer outer("setup");
+    for (int i = 0; i < 3; i++) {
+      ScopedTimer inner("build");
+    }
+  }
+  {
+    ScopedTimer outer("setup");
+  }
+
+  auto records = timer_records();
+  REQUIRE(records.size() == 2);
+  // children follow their parent
+  REQUIRE(records[0].name() == "setup");
+  REQUIRE(records[0].calls == 2);
+  REQUIRE(records[0].samples == 2);
+  REQUIRE(records[1].name() == "setup/build");
+  REQUIRE(records[1].calls == 3);
+  REQUIRE(records[0].total() >= records[1].total());
+
+  std::stringstream summary;
+  print_timer_summary(summary);
+  REQUIRE(summary.str().find("  build") != std::string::npos);
+
+  reset_timers();
+  REQUIRE(timer_records().empty());
+}
+
+TEST_CASE("Test Sampled Timers")
+{
+  reset_timers();
+
+  // sampled scopes are not timed unless sampling is enabled
+  REQUIRE(timer_sample_interval() == 0);
+  for (int i = 0; i < 100; i++) sampled_query();
+  REQUIRE(timer_records().empty());
+
+  set_timer_sample_interval(10);
+  for (int i = 0; i < 100; i++) sampled_query();
+  set_timer_sample_interval(0);
+
+  auto records = timer_records();
+  REQUIRE(records.size() == 1);
+  REQUIRE(records[0].name() == "query");
+  REQUIRE(records[0].samples == 10);
+  REQUIRE(records[0].calls == 100);
+
+  std::stringstream summary;
+  print_timer_summary(summary);
+  REQUIRE(summary.str().find("query *") != std::string::npos);
+
+  reset_timers();
+}
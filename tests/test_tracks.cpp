@@ -112,4 +112,39 @@ TEST_CASE("Test Random Internal Tracks")
       });
     REQUIRE(total_length == Catch::Approx((start-end).length()).epsilon(0.00001));
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test Walk Elements Output Buffer and Visitor")
+{
+  std::shared_ptr<MeshMock> mm = std::make_shared<MeshMock>();
+  mm->init();
+
+  // the allocation-free vertex access should match element_vertices
+  for (MeshID element = 0; element < mm->num_volume_elements(1); element++) {
+    auto vertices = mm->element_vertices(element);
+    auto tet_vertices = mm->tet_vertices(element);
+    for (int i = 0; i < 4; i++) REQUIRE(tet_vertices[i] == vertices[i]);
+  }
+
+  Position start {0.0, 0.0, 0.0};
+  Direction u = Direction {1.0, 1.0, 1.0}.normalize();
+  double distance = 10.0;
+  MeshID element = 0;
+  auto expected = mm->walk_elements(element, start, u, distance);
+  REQUIRE(expected.size() > 0);
+
+  // segments appended to a reused buffer
+  std::vector<std::pair<MeshID, double>> buffer {{ID_NONE, 0.0}};
+  mm->walk_elements(element, start, u, distance, buffer);
+  REQUIRE(buffer.size() == expected.size() + 1);
+  for (size_t i = 0; i < expected.size(); i++) REQUIRE(buffer[i + 1] == expected[i]);
+
+  // segments passed to a visitor
+  size_t n_visited = 0;
+  mm->walk_elements(element, start, u, distance, [&](MeshID visited, double length) {
+    REQUIRE(visited == expected[n_visited].first);
+    REQUIRE(length == expected[n_visited].second);
+    n_visited++;
+  });
+  REQUIRE(n_visited == expected.size());
+}
@@ -1,6 +1,7 @@
 #include <random>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -17,6 +18,30 @@ using LibMesh_Interface = std::integral_constant<MeshLibrary, MeshLibrary::LIBME
 using Embree_Raytracer = std::integral_constant<RTLibrary, RTLibrary::EMBREE>;
 using GPRT_Raytracer = std::integral_constant<RTLibrary, RTLibrary::GPRT>;
 
+//! Origins and directions of a set of rays
+struct RandomRays {
+  std::vector<Position> origins;
+  std::vector<Direction> directions;
+
+  size_t size() const { return origins.size(); }
+};
+
+//! \brief Random rays with origins spread through and around the MeshMock
+//! bounding box and isotropic directions
+inline RandomRays random_rays_in_mock(size_t n_rays, unsigned int seed = 42)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+  RandomRays rays;
+  for (size_t i = 0; i < n_rays; i++) {
+    rays.origins.push_back({1.5 + 3.0 * dist(rng), 1.5 + 4.0 * dist(rng), 1.5 + 5.0 * dist(rng)});
+    Direction u {dist(rng), dist(rng), dist(rng)};
+    rays.directions.push_back(u.normalize());
+  }
+  return rays;
+}
+
 } // namespace xdg::test
 
 namespace Catch {
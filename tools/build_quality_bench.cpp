@@ -0,0 +1,179 @@
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xdg/config.h"
+#include "xdg/error.h"
+#include "xdg/mesh_managers.h"
+#include "xdg/ray_tracers.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+#include "argparse/argparse.hpp"
+
+using namespace xdg;
+
+// Build time, memory use and query throughput of one set of tree build settings
+struct BuildQualityResult {
+  TreeBuildSettings settings;
+  bool low_memory {false}; //!< Whether or not the ray tracer was in its low memory mode
+  double build_time {0.0}; //!< Time to build all trees [s]
+  size_t memory {0}; //!< Memory held by the ray tracer [bytes]
+  double volume_ray_fire_rate {0.0}; //!< Ray fire queries against volume surface trees [1/s]
+  double find_volume_rate {0.0}; //!< Find volume queries against the global surface tree [1/s]
+  double find_element_rate {0.0}; //!< Find element queries against the global element tree [1/s]
+
+  std::string name() const {
+    return fmt::format("{}{}{}{}", settings.quality, settings.compact ? "+compact" : "",
+                       settings.robust ? "" : "-robust", low_memory ? "+low-memory" : "");
+  }
+
+  std::string to_json() const {
+    return fmt::format("    {{\"name\": \"{}\", \"quality\": \"{}\", \"compact\": {}, \"robust\": {}, "
+                       "\"low_memory\": {}, \"build_ms\": {:.3f}, \"memory_bytes\": {}, \"volume_ray_fire_per_second\": {:.1f}, "
+                       "\"find_volume_per_second\": {:.1f}, \"find_element_per_second\": {:.1f}}}",
+                       name(), settings.quality, settings.compact, settings.robust, low_memory, 1e3 * build_time, memory,
+                       volume_ray_fire_rate, find_volume_rate, find_element_rate);
+  }
+};
+
+int main(int argc, char** argv) {
+
+  argparse::ArgumentParser args("XDG Tree Build Quality Benchmark", "1.0", argparse::default_arguments::help);
+
+  args.add_argument("filename")
+    .help("Path to the input file");
+
+  args.add_argument("-n", "--num-queries")
+    .help("Number of queries of each type to time for each build setting")
+    .default_value(100000)
+    .scan<'i', int>();
+
+  args.add_argument("--no-robust")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Build trees without the robust scene flag");
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  args.add_argument("-o", "--output")
+    .help("Write the results as JSON to this file");
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB")
+    mesh_lib = MeshLibrary::MOAB;
+  else if (mesh_str == "LIBMESH")
+    mesh_lib = MeshLibrary::LIBMESH;
+  else
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+
+  // build settings are specific to the Embree ray tracer
+  std::shared_ptr<XDG> xdg = XDG::create(mesh_lib, RTLibrary::EMBREE);
+  const auto& mm = xdg->mesh_manager();
+  mm->load_file(args.get<std::string>("filename"));
+  mm->init();
+  mm->parse_metadata();
+
+  // query points are sampled uniformly in the bounding box of the model
+  size_t n_queries = args.get<int>("--num-queries");
+  BoundingBox bbox = mm->global_bounding_box();
+  std::vector<Position> points(n_queries);
+  std::vector<Direction> directions(n_queries);
+  srand48(42);
+  for (size_t i = 0; i < n_queries; i++) {
+    points[i] = bbox.lower_left() + bbox.width() * Vec3da(drand48(), drand48(), drand48());
+    directions[i] = rand_dir();
+  }
+  const auto& volumes = mm->volumes();
+  bool has_elements = mm->num_volume_elements() > 0;
+
+  // compact settings are also run in the low memory mode, which builds all
+  // surfaces into a single scene
+  std::vector<BuildQualityResult> results;
+  for (auto quality : {BuildQuality::LOW, BuildQuality::MEDIUM, BuildQuality::HIGH}) {
+    for (bool compact : {false, true}) {
+      BuildQualityResult result;
+      result.settings = {quality, !args.get<bool>("--no-robust"), compact};
+      results.push_back(result);
+      if (compact) {
+        result.low_memory = true;
+        results.push_back(result);
+      }
+    }
+  }
+
+  for (auto& result : results) {
+    // the same settings are applied to all classes of tree
+    auto rti = std::make_shared<EmbreeRayTracer>();
+    for (auto tree_class : {TreeClass::VOLUME_SURFACE, TreeClass::GLOBAL_SURFACE, TreeClass::ELEMENT}) {
+      rti->set_tree_build_settings(tree_class, result.settings);
+    }
+    if (result.low_memory) rti->set_low_memory(true);
+    xdg->set_ray_tracing_interface(rti);
+
+    Timer timer;
+    timer.start();
+    xdg->prepare_raytracer();
+    timer.stop();
+    result.build_time = timer.elapsed();
+    result.memory = rti->memory_usage().total();
+
+    auto rate = [&](auto&& query) {
+      Timer query_timer;
+      query_timer.start();
+      for (size_t i = 0; i < n_queries; i++) query(i);
+      query_timer.stop();
+      return n_queries / query_timer.elapsed();
+    };
+
+    result.volume_ray_fire_rate = rate([&](size_t i) {
+      xdg->ray_fire(volumes[i % volumes.size()], points[i], directions[i]);
+    });
+    result.find_volume_rate = rate([&](size_t i) { xdg->find_volume(points[i], directions[i]); });
+    if (has_elements) {
+      result.find_element_rate = rate([&](size_t i) { xdg->find_element(points[i]); });
+    }
+  }
+
+  std::cout << fmt::format("{:<30} {:>12} {:>12} {:>20} {:>20} {:>20}", "settings", "build (ms)", "memory (MB)",
+                           "ray fire (1/s)", "find volume (1/s)", "find element (1/s)") << std::endl;
+  for (const auto& result : results) {
+    std::cout << fmt::format("{:<30} {:>12.2f} {:>12.2f} {:>20.0f} {:>20.0f} {:>20}", result.name(),
+                             1e3 * result.build_time, result.memory / 1048576.0,
+                             result.volume_ray_fire_rate, result.find_volume_rate,
+                             has_elements ? fmt::format("{:.0f}", result.find_element_rate) : "-")
+              << std::endl;
+  }
+
+  if (auto output = args.present<std::string>("--output")) {
+    std::string json = "{\n";
+    json += fmt::format("  \"model\": \"{}\",\n", args.get<std::string>("filename"));
+    json += fmt::format("  \"num_queries\": {},\n", n_queries);
+    json += "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      json += results[i].to_json();
+      json += i + 1 < results.size() ? ",\n" : "\n";
+    }
+    json += "  ]\n}\n";
+    std::ofstream out(*output);
+    if (!out) fatal_error("Failed to open output file {}", *output);
+    out << json;
+  }
+
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "xdg/error.h"
+#include "xdg/exclusion_set.h"
 #include "xdg/mesh_manager_interface.h"
 #include "xdg/vec3da.h"
 #include "xdg/xdg.h"
@@ -102,7 +103,9 @@ void cross_surface()
     // reset to last intersection
     if (history_.size() > 0) {
       log("Resetting particle history to last intersection");
-      history_ = {history_.back()};
+      MeshID last_intersection = history_.back();
+      history_.clear();
+      history_.insert(last_intersection);
     }
   } else if (boundary_condition.value == "vacuum") {
     log("Particle {} encounters vacuum boundary at surface {}", id_, surface_intersection_.second);
@@ -128,7 +131,7 @@ bool ipc_graveyard_ {false};
 Position r_;
 Direction u_;
 MeshID volume_ {ID_NONE};
-std::vector<MeshID> history_ {};
+ExclusionSet history_ {};
 std::pair<double, MeshID> surface_intersection_ {INFTY, ID_NONE};
 double collision_distance_ {INFTY};
 int32_t n_events_ {0};
@@ -0,0 +1,128 @@
+#include <array>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xdg/constants.h"
+#include "xdg/geometry/plucker.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+
+#include "argparse/argparse.hpp"
+
+using namespace xdg;
+
+// Micro-benchmark of the scalar and batched Plucker ray-triangle kernels
+
+static const std::array<std::string, 3> SIMD_LEVEL_NAMES {"scalar", "avx2", "avx512"};
+
+int main(int argc, char** argv) {
+
+  argparse::ArgumentParser args("XDG Plucker Kernel Benchmark", "1.0", argparse::default_arguments::help);
+
+  args.add_argument("-n", "--num-triangles")
+    .help("Number of triangles in the batch")
+    .default_value(4096)
+    .scan<'i', int>();
+
+  args.add_argument("-r", "--num-rays")
+    .help("Number of rays to test against the batch")
+    .default_value(1000)
+    .scan<'i', int>();
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  size_t n_tris = args.get<int>("--num-triangles");
+  size_t n_rays = args.get<int>("--num-rays");
+
+  // small random triangles scattered in a unit cube so that a fraction of the
+  // rays fired from the center of the cube hit each one
+  srand48(42);
+  std::vector<std::array<Position, 3>> triangles(n_tris);
+  std::vector<double> vertices;
+  vertices.reserve(9 * n_tris);
+  for (auto& tri : triangles) {
+    Position center(drand48(), drand48(), drand48());
+    for (auto& v : tri) {
+      v = center + 0.2 * rand_dir();
+      vertices.insert(vertices.end(), {v.x, v.y, v.z});
+    }
+  }
+
+  std::vector<Position> origins(n_rays, Position(0.5, 0.5, 0.5));
+  std::vector<Direction> directions(n_rays);
+  for (auto& direction : directions) direction = rand_dir();
+
+  size_t n_tests = n_tris * n_rays;
+  std::cout << fmt::format("Testing {} rays against {} triangles ({} tests), maximum SIMD level: {}",
+                           n_rays, n_tris, n_tests, SIMD_LEVEL_NAMES[static_cast<int>(max_simd_level())]) << std::endl;
+
+  // scalar reference results
+  std::vector<char> ref_hits(n_tests);
+  std::vector<double> ref_dists(n_tests);
+  Timer timer;
+  timer.start();
+  for (size_t r = 0; r < n_rays; r++) {
+    for (size_t t = 0; t < n_tris; t++) {
+      size_t idx = r * n_tris + t;
+      ref_hits[idx] = plucker_ray_tri_intersect(triangles[t], origins[r], directions[r], ref_dists[idx]);
+      if (!ref_hits[idx]) ref_dists[idx] = INFTY;
+    }
+  }
+  timer.stop();
+  double scalar_time = timer.elapsed();
+  std::cout << fmt::format("{:>24} {:>10.4f} s {:>14.0f} tests/s", "scalar", scalar_time, n_tests / scalar_time) << std::endl;
+
+  std::unique_ptr<bool[]> hits(new bool[n_tests]);
+  std::vector<double> dists(n_tests);
+
+  // results are stored by ray (ray_major) or by triangle
+  auto report = [&](const std::string& name, double time, bool ray_major) {
+    size_t mismatches = 0;
+    for (size_t r = 0; r < n_rays; r++) {
+      for (size_t t = 0; t < n_tris; t++) {
+        size_t ref_idx = r * n_tris + t;
+        size_t idx = ray_major ? ref_idx : t * n_rays + r;
+        if (hits[idx] != static_cast<bool>(ref_hits[ref_idx]) || dists[idx] != ref_dists[ref_idx]) mismatches++;
+      }
+    }
+    std::cout << fmt::format("{:>24} {:>10.4f} s {:>14.0f} tests/s {:>8.2f}x", name, time, n_tests / time, scalar_time / time);
+    if (mismatches > 0) std::cout << fmt::format(" ({} mismatched results)", mismatches);
+    std::cout << std::endl;
+  };
+
+  for (int level = 0; level <= static_cast<int>(max_simd_level()); level++) {
+    set_simd_level(static_cast<SIMDLevel>(level));
+    const std::string& level_name = SIMD_LEVEL_NAMES[level];
+
+    // one ray against many triangles
+    timer.reset();
+    timer.start();
+    for (size_t r = 0; r < n_rays; r++) {
+      plucker_ray_tri_intersect_batch(vertices.data(), n_tris, origins[r], directions[r],
+                                      hits.get() + r * n_tris, dists.data() + r * n_tris);
+    }
+    timer.stop();
+    report(fmt::format("ray-triangles {}", level_name), timer.elapsed(), true);
+
+    // many rays against one triangle
+    timer.reset();
+    timer.start();
+    for (size_t t = 0; t < n_tris; t++) {
+      plucker_rays_tri_intersect_batch(triangles[t], origins.data(), directions.data(), n_rays,
+                                       hits.get() + t * n_rays, dists.data() + t * n_rays);
+    }
+    timer.stop();
+    report(fmt::format("rays-triangle {}", level_name), timer.elapsed(), false);
+  }
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xdg/error.h"
+#include "xdg/mesh_managers.h"
+#include "xdg/ray_tracers.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+#include "argparse/argparse.hpp"
+
+using namespace xdg;
+
+int main(int argc, char** argv) {
+
+  argparse::ArgumentParser args("XDG Ray Fire Benchmark", "1.0", argparse::default_arguments::help);
+
+  args.add_argument("filename")
+    .help("Path to the input file");
+
+  args.add_argument("volume")
+    .help("Volume ID to fire rays in").scan<'i', int>();
+
+  args.add_argument("-n", "--num-rays")
+    .help("Number of rays to fire for each method")
+    .default_value(1000000)
+    .scan<'i', int>();
+
+  args.add_argument("-o", "-p", "--origin", "--position")
+    .help("Ray origin. Defaults to the center of the volume's bounding box")
+    .scan<'g', double>().nargs(3);
+
+  args.add_argument("-b", "--bake-triangles")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Cache triangle data in the ray tracer");
+
+  args.add_argument("--native-triangles")
+    .default_value(false)
+    .implicit_value(true)
+    .help("Use native Embree triangle geometry with double precision refinement");
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB")
+    mesh_lib = MeshLibrary::MOAB;
+  else if (mesh_str == "LIBMESH")
+    mesh_lib = MeshLibrary::LIBMESH;
+  else
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+
+  // packet queries are specific to the Embree ray tracer
+  std::shared_ptr<XDG> xdg = XDG::create(mesh_lib, RTLibrary::EMBREE);
+  const auto& mm = xdg->mesh_manager();
+  mm->load_file(args.get<std::string>("filename"));
+  mm->init();
+  mm->parse_metadata();
+
+  auto rti = std::dynamic_pointer_cast<EmbreeRayTracer>(xdg->ray_tracing_interface());
+  rti->set_bake_triangles(args.get<bool>("--bake-triangles"));
+  rti->set_native_triangles(args.get<bool>("--native-triangles"));
+
+  MeshID volume = args.get<int>("volume");
+  Timer timer;
+  timer.start();
+  xdg->prepare_volume_for_raytracing(volume);
+  timer.stop();
+  std::cout << fmt::format("Tree build time: {:.4f} s ({} geometry)", timer.elapsed(),
+                           rti->native_triangles() ? "native triangle" : "user") << std::endl;
+
+  Position origin = mm->volume_bounding_box(volume).center();
+  if (auto user_origin = args.present<std::vector<double>>("--origin")) origin = *user_origin;
+
+  size_t n_rays = args.get<int>("--num-rays");
+  std::vector<Position> origins(n_rays, origin);
+  std::vector<Direction> directions(n_rays);
+  srand48(42);
+  for (auto& direction : directions) direction = rand_dir();
+
+  std::cout << "Firing " << n_rays << " rays from (" << origin.x << ", " << origin.y << ", " << origin.z
+            << ") in volume " << volume << std::endl;
+
+  // single ray queries
+  std::vector<std::pair<double, MeshID>> single_hits(n_rays);
+  timer.reset();
+  timer.start();
+  for (size_t i = 0; i < n_rays; i++) {
+    single_hits[i] = xdg->ray_fire(volume, origins[i], directions[i]);
+  }
+  timer.stop();
+  double single_time = timer.elapsed();
+  std::cout << fmt::format("{:>12} {:>10.4f} s {:>14.0f} rays/s", "single", single_time, n_rays / single_time) << std::endl;
+
+  // batched queries for each packet size
+  std::vector<std::pair<double, MeshID>> batch_hits(n_rays);
+  for (int packet_size : {1, 4, 8, 16}) {
+    rti->set_packet_size(packet_size);
+    timer.reset();
+    timer.start();
+    xdg->ray_fire(volume, origins.data(), directions.data(), n_rays, batch_hits.data());
+    timer.stop();
+    double batch_time = timer.elapsed();
+
+    // the batched results should match the single ray results exactly
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n_rays; i++) {
+      if (batch_hits[i] != single_hits[i]) mismatches++;
+    }
+
+    std::cout << fmt::format("{:>12} {:>10.4f} s {:>14.0f} rays/s {:>8.2f}x", fmt::format("packet-{}", packet_size),
+                             batch_time, n_rays / batch_time, single_time / batch_time);
+    if (mismatches > 0) std::cout << fmt::format(" ({} mismatched hits)", mismatches);
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -11,6 +12,7 @@
 #include "xdg/vec3da.h"
 #include "xdg/timer.h"
 #include "xdg/bbox.h"
+#include "xdg/tally.h"
 
 #include "xdg/xdg.h"
 
@@ -44,46 +46,57 @@ void tally_segments(const TallyContext& context) {
     }
   #endif
 
-  int n_tracks_run = 0;
+  // tracks are generated and scored in batches, reusing the segment
+  // buffers between batches
+  constexpr int batch_size = 10000;
+  std::vector<Position> starts(batch_size);
+  std::vector<Position> ends(batch_size);
+  std::vector<double> weights(batch_size, 1.0);
+  MeshTally tally(xdg);
+  const SegmentBatch& batch = tally.segments();
 
   Timer timer;
   timer.start();
-  #pragma omp parallel shared(n_tracks_run)
-  {
-    #pragma omp for
-    for (int i = 0; i < context.n_tracks_; i++) {
+  for (int batch_start = 0; batch_start < context.n_tracks_; batch_start += batch_size) {
+    int n_batch = std::min(batch_size, context.n_tracks_ - batch_start);
+    for (int i = 0; i < n_batch; i++) {
       // sample a location within the bounding box
-      Position r1 = bbox.sample_location();
-      if (!bbox.contains(r1)) fatal_error(fmt::format("Point {} is not within the mesh bounding box", r1));
+      starts[i] = bbox.sample_location();
+      if (!bbox.contains(starts[i])) fatal_error(fmt::format("Point {} is not within the mesh bounding box", starts[i]));
 
-      Position r2 = bbox.sample_location();
-      if (!bbox.contains(r2)) fatal_error(fmt::format("Point {} is not within the mesh bounding box", r2));
-
-      auto segments = xdg->segments(r1, r2);
-      #pragma omp atomic
-      n_tracks_run++;
+      ends[i] = bbox.sample_location();
+      if (!bbox.contains(ends[i])) fatal_error(fmt::format("Point {} is not within the mesh bounding box", ends[i]));
+    }
 
-      if (context.quiet_) continue;
+    tally.score(starts.data(), ends.data(), weights.data(), nullptr, n_batch);
 
-      if (context.verbose_) {
-          std::cout << fmt::format("Track {}: {} segments", i, segments.size()) << "\n";
-      } else {
-          prog_bar.set_progress(100.0 * (double)n_tracks_run / (double)context.n_tracks_);
+    for (int i = 0; i < n_batch; i++) {
+      if (context.verbose_ && !context.quiet_) {
+        std::cout << fmt::format("Track {}: {} segments", batch_start + i, batch.n_segments(i)) << "\n";
       }
 
       if (context.check_tracks_) {
-        double track_length = (r2 - r1).length();
-        double segement_sum = std::accumulate(segments.begin(), segments.end(), 0.0, [](double v, const auto& s) { return v + s.second; });
-        double diff = fabs(track_length - segement_sum);
+        double track_length = (ends[i] - starts[i]).length();
+        double segment_sum = std::accumulate(batch.lengths.begin() + batch.offsets[i],
+                                             batch.lengths.begin() + batch.offsets[i + 1], 0.0);
+        double diff = fabs(track_length - segment_sum);
         if (diff > TINY_BIT) {
-          fatal_error(fmt::format("Track length check failed.\n Start: {}\n End: {}\n Diff: {}", r1, r2, diff));
+          fatal_error(fmt::format("Track length check failed.\n Start: {}\n End: {}\n Diff: {}", starts[i], ends[i], diff));
         }
       }
     }
+
+    if (!context.quiet_ && !context.verbose_) {
+      prog_bar.set_progress(100.0 * (double)(batch_start + n_batch) / (double)context.n_tracks_);
+    }
   }
   timer.stop();
 
   if (!context.quiet_) prog_bar.mark_as_completed();
 
   std::cout << fmt::format("Time elapsed: {} s", timer.elapsed()) << "\n";
+
+  double total = std::accumulate(tally.results().begin(), tally.results().end(), 0.0);
+  size_t n_scored = std::count_if(tally.results().begin(), tally.results().end(), [](double r) { return r > 0.0; });
+  std::cout << fmt::format("Total track length: {} ({} of {} elements scored)", total, n_scored, tally.n_bins()) << "\n";
 }
@@ -4,6 +4,7 @@
 
 #include "xdg/error.h"
 #include "xdg/mesh_manager_interface.h"
+#include "xdg/mesh_managers.h"
 #include "xdg/vec3da.h"
 #include "xdg/xdg.h"
 
@@ -45,6 +46,11 @@ int main(int argc, char** argv) {
       .implicit_value(true)
       .help("Minimize all output (for performance testing)");
 
+  args.add_argument("-r", "--reorder")
+      .default_value(false)
+      .implicit_value(true)
+      .help("Renumber the mesh along a space-filling curve (MOAB only)");
+
   args.add_argument("-m", "--mfp")
       .default_value(1.0)
       .help("Mean free path of the particles").scan<'g', double>();
@@ -71,6 +77,15 @@ int main(int argc, char** argv) {
     fatal_error("Invalid mesh library {} specified", args.get<std::string>("--library"));
 
   const auto& mm = xdg->mesh_manager();
+  if (args.get<bool>("--reorder")) {
+#ifdef XDG_ENABLE_MOAB
+    auto moab_mm = std::dynamic_pointer_cast<MOABMeshManager>(mm);
+    if (!moab_mm) fatal_error("Mesh renumbering is only supported for the MOAB mesh library");
+    moab_mm->set_element_reordering(true);
+#else
+    fatal_error("Mesh renumbering requires MOAB support");
+#endif
+  }
   mm->load_file(args.get<std::string>("filename"));
   mm->init();
   mm->parse_metadata();
@@ -7,6 +7,7 @@
 #include <indicators/block_progress_bar.hpp>
 
 #include "xdg/error.h"
+#include "xdg/exclusion_set.h"
 #include "xdg/util/progress_bars.h"
 #include "xdg/vec3da.h"
 #include "xdg/timer.h"
@@ -70,7 +71,7 @@ void walk_elements(const WalkElementsContext& context) {
 
       Direction u = rand_dir();
       u.normalize();
-      std::vector<MeshID> primitives;
+      ExclusionSet primitives;
       while (element != ID_NONE) {
         // determine the distace to the next element
         auto [next_element, exit_distance] = xdg->next_element(element, r, u);
@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <array>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "xdg/error.h"
+#include "xdg/geometry/plucker.h"
+#include "xdg/mesh_managers.h"
+#include "xdg/ray_tracers.h"
+#include "xdg/timer.h"
+#include "xdg/vec3da.h"
+#include "xdg/xdg.h"
+
+#ifdef XDG_ENABLE_MOAB
+#include "moab/Core.hpp"
+#endif
+
+#include "argparse/argparse.hpp"
+
+using namespace xdg;
+
+// Benchmark suite for the main XDG queries. Each model is loaded, its
+// acceleration structures are built and a fixed, seeded set of queries is
+// timed for each benchmark. Results are written as JSON so that runs can be
+// compared across releases and machines.
+
+static const std::array<std::string, 3> SIMD_LEVEL_NAMES {"scalar", "avx2", "avx512"};
+
+//! Peak resident set size of the process in MB
+double peak_rss_mb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // ru_maxrss is reported in kB on Linux
+}
+
+struct BenchmarkResult {
+  std::string model;          //!< Name of the model the benchmark was run on
+  std::string benchmark;      //!< Name of the benchmark
+  size_t n_queries {0};       //!< Number of queries timed (0 for build benchmarks)
+  double time {0.0};          //!< Total time [s]
+  double peak_rss {0.0};      //!< Peak resident set size of the process after the benchmark [MB]
+
+  std::string to_json() const {
+    std::string json = fmt::format("    {{\"name\": \"{}/{}\", \"model\": \"{}\", \"benchmark\": \"{}\", ",
+                                   model, benchmark, model, benchmark);
+    if (n_queries > 0) {
+      json += fmt::format("\"queries\": {}, \"time_s\": {:.6e}, \"ns_per_query\": {:.3f}, \"queries_per_second\": {:.1f}, ",
+                          n_queries, time, 1e9 * time / n_queries, n_queries / time);
+    } else {
+      json += fmt::format("\"build_ms\": {:.3f}, ", 1e3 * time);
+    }
+    json += fmt::format("\"peak_rss_mb\": {:.1f}}}", peak_rss);
+    return json;
+  }
+};
+
+#ifdef XDG_ENABLE_MOAB
+//! Structured tetrahedral mesh of a unit cube with n x n x n hexahedral cells,
+//! each split into six tetrahedra around the cell diagonal. The mesh has no
+//! geometry, so the mesh manager creates a single volume bounded by its skin.
+std::shared_ptr<MeshManager> synthetic_box_mesh(int n)
+{
+  auto mesh_manager = std::make_shared<MOABMeshManager>();
+  moab::Interface* mbi = mesh_manager->moab_interface();
+
+  int n_verts_1d = n + 1;
+  auto vertex_index = [&](int i, int j, int k) { return (k * n_verts_1d + j) * n_verts_1d + i; };
+
+  std::vector<double> coords;
+  coords.reserve(3 * n_verts_1d * n_verts_1d * n_verts_1d);
+  for (int k = 0; k < n_verts_1d; k++) {
+    for (int j = 0; j < n_verts_1d; j++) {
+      for (int i = 0; i < n_verts_1d; i++) {
+        coords.insert(coords.end(), {double(i) / n, double(j) / n, double(k) / n});
+      }
+    }
+  }
+  moab::Range vertex_range;
+  mbi->create_vertices(coords.data(), coords.size() / 3, vertex_range);
+  std::vector<moab::EntityHandle> vertices(vertex_range.begin(), vertex_range.end());
+
+  // cell corners are numbered with bit 0 along x, bit 1 along y and bit 2
+  // along z. Every tet contains the diagonal from corner 0 to corner 7, so
+  // the split of neighboring cells conforms.
+  constexpr int tets[6][4] = {{0, 1, 3, 7}, {0, 3, 2, 7}, {0, 2, 6, 7},
+                              {0, 6, 4, 7}, {0, 4, 5, 7}, {0, 5, 1, 7}};
+
+  for (int k = 0; k < n; k++) {
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+        std::array<int, 8> corners;
+        for (int c = 0; c < 8; c++) corners[c] = vertex_index(i + (c & 1), j + ((c >> 1) & 1), k + ((c >> 2) & 1));
+        for (const auto& tet : tets) {
+          std::array<int, 4> idx {corners[tet[0]], corners[tet[1]], corners[tet[2]], corners[tet[3]]};
+          // use a positive orientation for every element
+          auto vertex = [&](int v) { return Position(coords[3 * idx[v]], coords[3 * idx[v] + 1], coords[3 * idx[v] + 2]); };
+          if ((vertex(1) - vertex(0)).cross(vertex(2) - vertex(0)).dot(vertex(3) - vertex(0)) < 0.0)
+            std::swap(idx[1], idx[2]);
+          moab::EntityHandle conn[4] {vertices[idx[0]], vertices[idx[1]], vertices[idx[2]], vertices[idx[3]]};
+          moab::EntityHandle tet_handle;
+          mbi->create_element(moab::MBTET, conn, 4, tet_handle);
+        }
+      }
+    }
+  }
+  return mesh_manager;
+}
+#endif
+
+// Runs the benchmarks for a single model
+class ModelBenchmark {
+public:
+  ModelBenchmark(const std::string& name, std::shared_ptr<XDG> xdg, size_t n_queries)
+    : name_(name), xdg_(xdg), n_queries_(n_queries) {}
+
+  std::vector<BenchmarkResult> run() {
+    const auto& mm = xdg_->mesh_manager();
+
+    // acceleration structure construction
+    Timer timer;
+    timer.start();
+    xdg_->prepare_raytracer();
+    timer.stop();
+    record("bvh_build", 0, timer.elapsed());
+
+    // query the first volume of the model other than the implicit complement
+    MeshID volume = ID_NONE;
+    for (auto v : mm->volumes()) {
+      if (v != mm->implicit_complement()) { volume = v; break; }
+    }
+    if (volume == ID_NONE) {
+      warning("Model {} has no volumes to benchmark", name_);
+      return results_;
+    }
+
+    // seeded query data, sampled in the bounding box of the volume
+    srand48(42);
+    BoundingBox bbox = mm->volume_bounding_box(volume);
+    auto random_point = [&]() {
+      return bbox.lower_left() + bbox.width() * Vec3da(drand48(), drand48(), drand48());
+    };
+    std::vector<Position> points(n_queries_);
+    std::vector<Direction> directions(n_queries_);
+    for (size_t i = 0; i < n_queries_; i++) {
+      points[i] = random_point();
+      directions[i] = rand_dir();
+    }
+
+    // ray origins must be inside the volume
+    std::vector<Position> origins;
+    origins.reserve(n_queries_);
+    for (size_t attempt = 0; origins.size() < n_queries_ && attempt < 100 * n_queries_; attempt++) {
+      Position p = random_point();
+      if (xdg_->point_in_volume(volume, p)) origins.push_back(p);
+    }
+
+    time_queries("ray_fire", origins.size(), [&](size_t i) {
+      return xdg_->ray_fire(volume, origins[i], directions[i]).second;
+    });
+
+    time_queries("point_in_volume", n_queries_, [&](size_t i) {
+      return xdg_->point_in_volume(volume, points[i]);
+    });
+
+    time_queries("closest", n_queries_, [&](size_t i) {
+      return xdg_->closest(volume, points[i]).second;
+    });
+
+    // the remaining queries require a volumetric mesh
+    if (mm->num_volume_elements() == 0) return results_;
+
+    time_queries("find_element", n_queries_, [&](size_t i) {
+      return xdg_->find_element(points[i]);
+    });
+
+    time_queries("locate", n_queries_, [&](size_t i) {
+      return xdg_->locate(points[i]).element;
+    });
+
+    std::vector<std::pair<MeshID, Position>> start_elements;
+    for (const auto& p : points) {
+      MeshID element = xdg_->find_element(p);
+      if (element != ID_NONE) start_elements.emplace_back(element, p);
+    }
+    time_queries("next_element", start_elements.size(), [&](size_t i) {
+      return xdg_->next_element(start_elements[i].first, start_elements[i].second, directions[i]).first;
+    });
+
+    time_queries("segments", n_queries_, [&](size_t i) {
+      return xdg_->segments(points[i], points[(i + 1) % n_queries_]);
+    });
+
+    return results_;
+  }
+
+private:
+  void record(const std::string& benchmark, size_t n_queries, double time) {
+    results_.push_back({name_, benchmark, n_queries, time, peak_rss_mb()});
+    if (n_queries > 0)
+      std::cerr << fmt::format("{:>16} {:>16} {:>12.1f} ns/query", name_, benchmark, 1e9 * time / n_queries) << std::endl;
+    else
+      std::cerr << fmt::format("{:>16} {:>16} {:>12.3f} ms", name_, benchmark, 1e3 * time) << std::endl;
+  }
+
+  //! Time n calls of query(i)
+  template<typename F>
+  void time_queries(const std::string& benchmark, size_t n, const F& query) {
+    if (n == 0) {
+      warning("No valid queries for benchmark {} on model {}", benchmark, name_);
+      return;
+    }
+    Timer timer;
+    timer.start();
+    for (size_t i = 0; i < n; i++) query(i);
+    timer.stop();
+    record(benchmark, n, timer.elapsed());
+  }
+
+  std::string name_;
+  std::shared_ptr<XDG> xdg_;
+  size_t n_queries_;
+  std::vector<BenchmarkResult> results_;
+};
+
+int main(int argc, char** argv) {
+
+  argparse::ArgumentParser args("XDG Benchmark Suite", "1.0", argparse::default_arguments::help);
+
+  args.add_argument("models")
+    .help("Paths to the models to benchmark")
+    .nargs(argparse::nargs_pattern::any)
+    .default_value(std::vector<std::string>{});
+
+  args.add_argument("-s", "--synthetic")
+    .help("Number of cells along each side of the synthetic box meshes to benchmark (MOAB only)")
+    .nargs(argparse::nargs_pattern::any)
+    .default_value(std::vector<int>{10, 20})
+    .scan<'i', int>();
+
+  args.add_argument("-n", "--num-queries")
+    .help("Number of queries to time for each benchmark")
+    .default_value(100000)
+    .scan<'i', int>();
+
+  args.add_argument("-m", "--mesh-library")
+    .help("Mesh library to use. One of (MOAB, LIBMESH)")
+    .default_value("MOAB");
+
+  args.add_argument("-r", "--rt-library")
+    .help("Ray tracing library to use. One of (EMBREE, GPRT)")
+    .default_value("EMBREE");
+
+  args.add_argument("-o", "--output")
+    .help("Path of the JSON results file. Results are written to stdout if not provided");
+
+  args.add_argument("--reorder")
+    .help("Also run each MOAB model with its mesh renumbered along a space-filling curve")
+    .default_value(false)
+    .implicit_value(true);
+
+  args.add_argument("--bake-elements")
+    .help("Cache a barycentric transform for each element for point location (Embree only)")
+    .default_value(false)
+    .implicit_value(true);
+
+  args.add_argument("-p", "--profile")
+    .help("Print a profile of the setup and query timers, timing one in every N queries")
+    .scan<'i', int>();
+
+  try {
+    args.parse_args(argc, argv);
+  }
+  catch (const std::runtime_error& err) {
+    std::cout << err.what() << std::endl;
+    std::cout << args;
+    exit(0);
+  }
+
+  std::string mesh_str = args.get<std::string>("--mesh-library");
+  MeshLibrary mesh_lib;
+  if (mesh_str == "MOAB")
+    mesh_lib = MeshLibrary::MOAB;
+  else if (mesh_str == "LIBMESH")
+    mesh_lib = MeshLibrary::LIBMESH;
+  else
+    fatal_error("Invalid mesh library '{}' specified", mesh_str);
+
+  std::string rt_str = args.get<std::string>("--rt-library");
+  RTLibrary rt_lib;
+  if (rt_str == "EMBREE")
+    rt_lib = RTLibrary::EMBREE;
+  else if (rt_str == "GPRT")
+    rt_lib = RTLibrary::GPRT;
+  else
+    fatal_error("Invalid ray tracing library '{}' specified", rt_str);
+
+  size_t n_queries = args.get<int>("--num-queries");
+
+  auto profile_interval = args.present<int>("--profile");
+  if (profile_interval) set_timer_sample_interval(std::max(*profile_interval, 1));
+
+  std::vector<BenchmarkResult> results;
+  bool bake_elements = args.get<bool>("--bake-elements");
+  auto run_model = [&](const std::string& name, std::shared_ptr<XDG> xdg) {
+#ifdef XDG_ENABLE_EMBREE
+    auto embree = std::dynamic_pointer_cast<EmbreeRayTracer>(xdg->ray_tracing_interface());
+    if (embree) embree->set_bake_elements(bake_elements);
+#endif
+    ModelBenchmark benchmark(name, xdg, n_queries);
+    auto model_results = benchmark.run();
+    results.insert(results.end(), model_results.begin(), model_results.end());
+  };
+
+  // models renumbered along a space-filling curve are run after the
+  // originals, with a "-reordered" suffix
+  std::vector<bool> orderings {false};
+  if (args.get<bool>("--reorder")) {
+    if (mesh_lib == MeshLibrary::MOAB) orderings.push_back(true);
+    else warning("Mesh renumbering is only supported for the MOAB mesh library");
+  }
+
+  for (const auto& filename : args.get<std::vector<std::string>>("models")) {
+    for (bool reorder : orderings) {
+      std::shared_ptr<XDG> xdg = XDG::create(mesh_lib, rt_lib);
+      const auto& mm = xdg->mesh_manager();
+#ifdef XDG_ENABLE_MOAB
+      if (reorder) std::dynamic_pointer_cast<MOABMeshManager>(mm)->set_element_reordering(true);
+#endif
+      mm->load_file(filename);
+      mm->init();
+      mm->parse_metadata();
+      std::string name = filename.substr(filename.find_last_of('/') + 1);
+      run_model(reorder ? name + "-reordered" : name, xdg);
+    }
+  }
+
+  for (int n : args.get<std::vector<int>>("--synthetic")) {
+    if (n <= 0) continue;
+#ifdef XDG_ENABLE_MOAB
+    if (mesh_lib != MeshLibrary::MOAB) {
+      warning("Synthetic meshes are only generated for the MOAB mesh library");
+      break;
+    }
+    for (bool reorder : orderings) {
+      auto mm = synthetic_box_mesh(n);
+      std::dynamic_pointer_cast<MOABMeshManager>(mm)->set_element_reordering(reorder);
+      mm->init();
+      mm->parse_metadata();
+      std::string name = fmt::format("box-{}", n);
+      run_model(reorder ? name + "-reordered" : name, std::make_shared<XDG>(mm, rt_lib));
+    }
+#else
+    warning("Synthetic meshes require MOAB support");
+    break;
+#endif
+  }
+
+  if (profile_interval) print_timer_summary(std::cerr);
+
+  // JSON report
+  char hostname[256] {};
+  gethostname(hostname, sizeof(hostname) - 1);
+  char date[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+  std::string json = "{\n  \"context\": {\n";
+  json += fmt::format("    \"date\": \"{}\",\n", date);
+  json += fmt::format("    \"host_name\": \"{}\",\n", hostname);
+  json += fmt::format("    \"num_cpus\": {},\n", sysconf(_SC_NPROCESSORS_ONLN));
+  json += fmt::format("    \"mesh_library\": \"{}\",\n", mesh_lib);
+  json += fmt::format("    \"rt_library\": \"{}\",\n", rt_lib);
+  json += fmt::format("    \"simd_level\": \"{}\",\n", SIMD_LEVEL_NAMES[static_cast<int>(simd_level())]);
+  json += fmt::format("    \"bake_elements\": {},\n", bake_elements);
+  json += fmt::format("    \"num_queries\": {},\n", n_queries);
+  json += fmt::format("    \"peak_rss_mb\": {:.1f}\n", peak_rss_mb());
+  json += "  },\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    json += results[i].to_json();
+    json += i + 1 < results.size() ? ",\n" : "\n";
+  }
+  json += "  ]\n}\n";
+
+  if (auto output = args.present<std::string>("--output")) {
+    std::ofstream out(*output);
+    if (!out) fatal_error("Could not open {} for writing", *output);
+    out << json;
+  } else {
+    std::cout << json;
+  }
+
+  return 0;
+}